@@ -22,10 +22,23 @@
  * SOFTWARE.
  */
 
+/*
+ * On x86-64 hosts with AES-NI the functions at the end of this file use
+ * the hardware AES instructions instead of the constant-time bitsliced
+ * code (which stays the only implementation on all other targets).
+ * Both produce the same keystream; in the AES-NI case the first 30 words
+ * of sk_exp hold the 15 round keys instead of the bitsliced key schedule.
+ */
+
 #include <stdint.h>
 #include <string.h>
+#include "cpufeatures.h"
 #include "aes256ctr.h"
 
+#if KYBER_X86_64
+#include <immintrin.h>
+#endif
+
 static inline uint32_t br_dec32le(const uint8_t *src)
 {
 	return (uint32_t)src[0]
@@ -483,13 +496,24 @@ static void inc4_be(uint32_t *x)
   *x = br_swap32(*x);
 }
 
-static void aes_ctr4x(uint8_t out[64], uint32_t ivw[16], uint64_t sk_exp[120])
+static void br_aes_ctr_ivw_init(uint32_t ivw[16], const uint8_t *iv, uint32_t cc)
+{
+  br_range_dec32le(ivw, 3, iv);
+  memcpy(ivw +  4, ivw, 3 * sizeof(uint32_t));
+  memcpy(ivw +  8, ivw, 3 * sizeof(uint32_t));
+  memcpy(ivw + 12, ivw, 3 * sizeof(uint32_t));
+  ivw[ 3] = br_swap32(cc);
+  ivw[ 7] = br_swap32(cc + 1);
+  ivw[11] = br_swap32(cc + 2);
+  ivw[15] = br_swap32(cc + 3);
+}
+
+static void aes_ctr4x_words(uint32_t w[16], uint32_t ivw[16], uint64_t sk_exp[120])
 {
-  uint32_t w[16];
   uint64_t q[8];
   int i;
 
-  memcpy(w, ivw, sizeof(w));
+  memcpy(w, ivw, 16*sizeof(uint32_t));
   for (i = 0; i < 4; i++) {
     br_aes_ct64_interleave_in(&q[i], &q[i + 4], w + (i << 2));
   }
@@ -510,7 +534,6 @@ static void aes_ctr4x(uint8_t out[64], uint32_t ivw[16], uint64_t sk_exp[120])
   for (i = 0; i < 4; i ++) {
     br_aes_ct64_interleave_out(w + (i << 2), q[i], q[i + 4]);
   }
-  br_range_enc32le(out, w, 16);
 
   /* Increase counter for next 4 blocks */
   inc4_be(ivw+3);
@@ -519,6 +542,14 @@ static void aes_ctr4x(uint8_t out[64], uint32_t ivw[16], uint64_t sk_exp[120])
   inc4_be(ivw+15);
 }
 
+static void aes_ctr4x(uint8_t out[64], uint32_t ivw[16], uint64_t sk_exp[120])
+{
+  uint32_t w[16];
+
+  aes_ctr4x_words(w, ivw, sk_exp);
+  br_range_enc32le(out, w, 16);
+}
+
 static void br_aes_ct64_ctr_init(uint64_t sk_exp[120], const uint8_t *key)
 {
 	uint64_t skey[30];
@@ -532,14 +563,7 @@ static void br_aes_ct64_ctr_run(uint64_t sk_exp[120], const uint8_t *iv, uint32_
 	uint32_t ivw[16];
 	size_t i;
 
-	br_range_dec32le(ivw, 3, iv);
-	memcpy(ivw +  4, ivw, 3 * sizeof(uint32_t));
-	memcpy(ivw +  8, ivw, 3 * sizeof(uint32_t));
-	memcpy(ivw + 12, ivw, 3 * sizeof(uint32_t));
-	ivw[ 3] = br_swap32(cc);
-	ivw[ 7] = br_swap32(cc + 1);
-	ivw[11] = br_swap32(cc + 2);
-	ivw[15] = br_swap32(cc + 3);
+	br_aes_ctr_ivw_init(ivw, iv, cc);
 
 	while (len > 64) {
 		aes_ctr4x(data, ivw, sk_exp);
@@ -554,33 +578,572 @@ static void br_aes_ct64_ctr_run(uint64_t sk_exp[120], const uint8_t *iv, uint32_
 	}
 }
 
+#if KYBER_X86_64
+TARGET_AESNI
+static inline __m128i aesni_expand_word(__m128i k, __m128i t)
+{
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+  k = _mm_xor_si128(k, _mm_slli_si128(k, 8));
+  return _mm_xor_si128(k, t);
+}
+
+/* AES-256 key expansion; the 15 round keys go to rk[0..29] */
+TARGET_AESNI
+static void aesni_keysched(uint64_t rk[30], const uint8_t *key)
+{
+  __m128i k0, k1;
+  __m128i *r = (__m128i *)rk;
+
+  k0 = _mm_loadu_si128((const __m128i *)key);
+  k1 = _mm_loadu_si128((const __m128i *)(key + 16));
+  _mm_storeu_si128(r, k0);
+  _mm_storeu_si128(r + 1, k1);
+
+#define AESNI_EXPAND2(i, rcon) \
+  k0 = aesni_expand_word(k0, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, rcon), 0xff)); \
+  k1 = aesni_expand_word(k1, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k0, 0x00), 0xaa)); \
+  _mm_storeu_si128(r + i, k0); \
+  _mm_storeu_si128(r + i + 1, k1)
+
+  AESNI_EXPAND2( 2, 0x01);
+  AESNI_EXPAND2( 4, 0x02);
+  AESNI_EXPAND2( 6, 0x04);
+  AESNI_EXPAND2( 8, 0x08);
+  AESNI_EXPAND2(10, 0x10);
+  AESNI_EXPAND2(12, 0x20);
+  k0 = aesni_expand_word(k0, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, 0x40), 0xff));
+  _mm_storeu_si128(r + 14, k0);
+#undef AESNI_EXPAND2
+}
+
+/* Encrypt the n <= 8 counter blocks nonce || ctr+j (ctr big-endian) with
+ * all of them in flight, so the aesenc latency is hidden */
+TARGET_AESNI
+static inline void aesni_ctr_blocks(uint8_t *out, unsigned int n, const __m128i rk[15],
+                                    const uint32_t nonce[3], uint32_t ctr)
+{
+  __m128i b[8];
+  unsigned int i, j;
+
+  for (j = 0; j < n; j++) {
+    b[j] = _mm_set_epi32((int)br_swap32(ctr + j), (int)nonce[2], (int)nonce[1], (int)nonce[0]);
+    b[j] = _mm_xor_si128(b[j], rk[0]);
+  }
+  for (i = 1; i < 14; i++) {
+    for (j = 0; j < n; j++) {
+      b[j] = _mm_aesenc_si128(b[j], rk[i]);
+    }
+  }
+  for (j = 0; j < n; j++) {
+    _mm_storeu_si128((__m128i *)(out + 16*j), _mm_aesenclast_si128(b[j], rk[14]));
+  }
+}
+
+/* len bytes of keystream starting at the counter blocks described by ivw[0..3] */
+TARGET_AESNI
+static void aesni_ctr_run(const uint64_t rk64[30], const uint32_t ivw[4], uint8_t *data, size_t len)
+{
+  __m128i rk[15];
+  uint8_t tmp[16];
+  uint32_t ctr = br_swap32(ivw[3]);
+  size_t i;
+
+  for (i = 0; i < 15; i++) {
+    rk[i] = _mm_loadu_si128((const __m128i *)rk64 + i);
+  }
+
+  while (len >= 128) {
+    aesni_ctr_blocks(data, 8, rk, ivw, ctr);
+    ctr += 8;
+    data += 128;
+    len -= 128;
+  }
+  if (len >= 64) {
+    aesni_ctr_blocks(data, 4, rk, ivw, ctr);
+    ctr += 4;
+    data += 64;
+    len -= 64;
+  }
+  while (len >= 16) {
+    aesni_ctr_blocks(data, 1, rk, ivw, ctr);
+    ctr += 1;
+    data += 16;
+    len -= 16;
+  }
+  if (len > 0) {
+    aesni_ctr_blocks(tmp, 1, rk, ivw, ctr);
+    for (i = 0; i < len; i++) {
+      data[i] = tmp[i];
+    }
+  }
+}
+
+/* Advance the four counters of ivw by nblocks batches of 4 blocks */
+static void aesni_ctr_advance(uint32_t ivw[16], size_t nblocks)
+{
+  int i;
+
+  for (i = 3; i < 16; i += 4) {
+    ivw[i] = br_swap32(br_swap32(ivw[i]) + 4*(uint32_t)nblocks);
+  }
+}
+
+/*
+ * Wide bitsliced AES for hosts with AVX2 but without AES-NI: four
+ * independent ct64 states (4 blocks each) side by side in the 64-bit
+ * lanes of 256-bit vectors, so one pass of the constant-time circuit
+ * yields 16 counter blocks. bs4_t is a GCC vector type; the round
+ * functions are the ct64 ones with uint64_t replaced by bs4_t.
+ */
+typedef uint64_t bs4_t __attribute__((vector_size(32)));
+
+TARGET_AVX2
+static void br_aes_ct64x4_bitslice_Sbox(bs4_t *q)
+{
+	bs4_t x0, x1, x2, x3, x4, x5, x6, x7;
+	bs4_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	bs4_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	bs4_t y20, y21;
+	bs4_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	bs4_t z10, z11, z12, z13, z14, z15, z16, z17;
+	bs4_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	bs4_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	bs4_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	bs4_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	bs4_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	bs4_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	bs4_t t60, t61, t62, t63, t64, t65, t66, t67;
+	bs4_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/*
+	 * Top linear transformation.
+	 */
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	/*
+	 * Non-linear section.
+	 */
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	/*
+	 * Bottom linear transformation.
+	 */
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+TARGET_AVX2
+static void br_aes_ct64x4_ortho(bs4_t *q)
+{
+#define SWAPN4(cl, ch, s, x, y)   do { \
+		bs4_t a, b; \
+		a = (x); \
+		b = (y); \
+		(x) = (a & (uint64_t)cl) | ((b & (uint64_t)cl) << (s)); \
+		(y) = ((a & (uint64_t)ch) >> (s)) | (b & (uint64_t)ch); \
+	} while (0)
+
+	SWAPN4(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, q[0], q[1]);
+	SWAPN4(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, q[2], q[3]);
+	SWAPN4(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, q[4], q[5]);
+	SWAPN4(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, q[6], q[7]);
+
+	SWAPN4(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, q[0], q[2]);
+	SWAPN4(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, q[1], q[3]);
+	SWAPN4(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, q[4], q[6]);
+	SWAPN4(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, q[5], q[7]);
+
+	SWAPN4(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, q[0], q[4]);
+	SWAPN4(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, q[1], q[5]);
+	SWAPN4(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, q[2], q[6]);
+	SWAPN4(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, q[3], q[7]);
+#undef SWAPN4
+}
+
+TARGET_AVX2
+static inline void add_round_key4(bs4_t *q, const uint64_t *sk)
+{
+	int i;
+
+	for (i = 0; i < 8; i ++) {
+		q[i] ^= sk[i];
+	}
+}
+
+TARGET_AVX2
+static inline void shift_rows4(bs4_t *q)
+{
+	int i;
+
+	for (i = 0; i < 8; i ++) {
+		bs4_t x;
+
+		x = q[i];
+		q[i] = (x & (uint64_t)0x000000000000FFFF)
+			| ((x & (uint64_t)0x00000000FFF00000) >> 4)
+			| ((x & (uint64_t)0x00000000000F0000) << 12)
+			| ((x & (uint64_t)0x0000FF0000000000) >> 8)
+			| ((x & (uint64_t)0x000000FF00000000) << 8)
+			| ((x & (uint64_t)0xF000000000000000) >> 12)
+			| ((x & (uint64_t)0x0FFF000000000000) << 4);
+	}
+}
+
+TARGET_AVX2
+static inline void mix_columns4(bs4_t *q)
+{
+	bs4_t q0, q1, q2, q3, q4, q5, q6, q7;
+	bs4_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+	q0 = q[0];
+	q1 = q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = q[5];
+	q6 = q[6];
+	q7 = q[7];
+	r0 = (q0 >> 16) | (q0 << 48);
+	r1 = (q1 >> 16) | (q1 << 48);
+	r2 = (q2 >> 16) | (q2 << 48);
+	r3 = (q3 >> 16) | (q3 << 48);
+	r4 = (q4 >> 16) | (q4 << 48);
+	r5 = (q5 >> 16) | (q5 << 48);
+	r6 = (q6 >> 16) | (q6 << 48);
+	r7 = (q7 >> 16) | (q7 << 48);
+
+#define ROTR32_4(x) (((x) << 32) | ((x) >> 32))
+	q[0] = q7 ^ r7 ^ r0 ^ ROTR32_4(q0 ^ r0);
+	q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ ROTR32_4(q1 ^ r1);
+	q[2] = q1 ^ r1 ^ r2 ^ ROTR32_4(q2 ^ r2);
+	q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ ROTR32_4(q3 ^ r3);
+	q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ ROTR32_4(q4 ^ r4);
+	q[5] = q4 ^ r4 ^ r5 ^ ROTR32_4(q5 ^ r5);
+	q[6] = q5 ^ r5 ^ r6 ^ ROTR32_4(q6 ^ r6);
+	q[7] = q6 ^ r6 ^ r7 ^ ROTR32_4(q7 ^ r7);
+#undef ROTR32_4
+}
+
+/* 16 counter blocks (256 bytes) as little-endian words; ivw holds the
+ * counters of the first four and is advanced by 16 */
+TARGET_AVX2
+static void aes_ctr16x_words_avx2(uint32_t w[64], uint32_t ivw[16], const uint64_t sk_exp[120])
+{
+  uint64_t qs[8];
+  bs4_t q[8];
+  int g, i;
+
+  for (g = 0; g < 4; g++) {
+    for (i = 0; i < 4; i++) {
+      br_aes_ct64_interleave_in(&qs[i], &qs[i + 4], ivw + (i << 2));
+    }
+    for (i = 0; i < 8; i++) {
+      q[i][g] = qs[i];
+    }
+    inc4_be(ivw+3);
+    inc4_be(ivw+7);
+    inc4_be(ivw+11);
+    inc4_be(ivw+15);
+  }
+  br_aes_ct64x4_ortho(q);
+
+  add_round_key4(q, sk_exp);
+  for (i = 1; i < 14; i++) {
+    br_aes_ct64x4_bitslice_Sbox(q);
+    shift_rows4(q);
+    mix_columns4(q);
+    add_round_key4(q, sk_exp + (i << 3));
+  }
+  br_aes_ct64x4_bitslice_Sbox(q);
+  shift_rows4(q);
+  add_round_key4(q, sk_exp + 112);
+
+  br_aes_ct64x4_ortho(q);
+  for (g = 0; g < 4; g++) {
+    for (i = 0; i < 8; i++) {
+      qs[i] = q[i][g];
+    }
+    for (i = 0; i < 4; i++) {
+      br_aes_ct64_interleave_out(w + (g << 4) + (i << 2), qs[i], qs[i + 4]);
+    }
+  }
+}
+
+static void aes_ctr16x_avx2(uint8_t out[256], uint32_t ivw[16], const uint64_t sk_exp[120])
+{
+  uint32_t w[64];
+
+  aes_ctr16x_words_avx2(w, ivw, sk_exp);
+  br_range_enc32le(out, w, 64);
+}
+
+/* br_aes_ct64_ctr_run on the AVX2 code; a tail of more than
+ * AES_CTR16X_MINTAIL bytes still takes a full 16-block pass, which is
+ * cheaper than the 2 to 4 passes of aes_ctr4x it replaces */
+#define AES_CTR16X_MINTAIL 64
+static void aes_ctr16x_run(const uint64_t sk_exp[120], uint32_t ivw[16], uint8_t *data, size_t len)
+{
+  uint8_t tmp[256];
+  size_t i;
+
+  while (len >= 256) {
+    aes_ctr16x_avx2(data, ivw, sk_exp);
+    data += 256;
+    len -= 256;
+  }
+  if (len > AES_CTR16X_MINTAIL) {
+    aes_ctr16x_avx2(tmp, ivw, sk_exp);
+    for (i = 0; i < len; i++) {
+      data[i] = tmp[i];
+    }
+    return;
+  }
+  while (len > 0) {
+    aes_ctr4x(tmp, ivw, (uint64_t *)sk_exp);
+    for (i = 0; i < len && i < 64; i++) {
+      data[i] = tmp[i];
+    }
+    data += i;
+    len -= i;
+  }
+}
+#endif
+
 void aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], const uint8_t nonce[12])
 {
   uint64_t sk_exp[120];
 
+#if KYBER_X86_64
+  if(cpu_has_aesni()) {
+    uint32_t ivw[16];
+
+    aesni_keysched(sk_exp, key);
+    br_aes_ctr_ivw_init(ivw, nonce, 0);
+    aesni_ctr_run(sk_exp, ivw, out, outlen);
+    return;
+  }
+#endif
   br_aes_ct64_ctr_init(sk_exp, key);
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    uint32_t ivw[16];
+
+    br_aes_ctr_ivw_init(ivw, nonce, 0);
+    aes_ctr16x_run(sk_exp, ivw, out, outlen);
+    return;
+  }
+#endif
   br_aes_ct64_ctr_run(sk_exp, nonce, 0, out, outlen);
 }
 
-void aes256ctr_init(aes256ctr_ctx *s, const uint8_t key[32], const uint8_t nonce[12])
+void aes256ctr_setkey(aes256ctr_ctx *s, const uint8_t key[32])
 {
+#if KYBER_X86_64
+  if(cpu_has_aesni()) {
+    aesni_keysched(s->sk_exp, key);
+    return;
+  }
+#endif
   br_aes_ct64_ctr_init(s->sk_exp, key);
+}
 
-  br_range_dec32le(s->ivw, 3, nonce);
-  memcpy(s->ivw +  4, s->ivw, 3 * sizeof(uint32_t));
-  memcpy(s->ivw +  8, s->ivw, 3 * sizeof(uint32_t));
-  memcpy(s->ivw + 12, s->ivw, 3 * sizeof(uint32_t));
-  s->ivw[ 3] = br_swap32(0);
-  s->ivw[ 7] = br_swap32(1);
-  s->ivw[11] = br_swap32(2);
-  s->ivw[15] = br_swap32(3);
+void aes256ctr_setnonce(aes256ctr_ctx *s, const uint8_t nonce[12])
+{
+  br_aes_ctr_ivw_init(s->ivw, nonce, 0);
+  s->pos = 0;
+  s->nlanes = 0;
+}
+
+void aes256ctr_init(aes256ctr_ctx *s, const uint8_t key[32], const uint8_t nonce[12])
+{
+  aes256ctr_setkey(s, key);
+  aes256ctr_setnonce(s, nonce);
 }
 
 void aes256ctr_squeezeblocks(uint8_t *out, size_t nblocks, aes256ctr_ctx *s)
 {
+#if KYBER_X86_64
+  if(cpu_has_aesni()) {
+    aesni_ctr_run(s->sk_exp, s->ivw, out, 64*nblocks);
+    aesni_ctr_advance(s->ivw, nblocks);
+    return;
+  }
+  if(cpu_has_avx2()) {
+    while (nblocks >= 4) {
+      aes_ctr16x_avx2(out, s->ivw, s->sk_exp);
+      out += 256;
+      nblocks -= 4;
+    }
+  }
+#endif
   while (nblocks > 0) {
     aes_ctr4x(out, s->ivw, s->sk_exp);
     out += 64;
     nblocks--;
   }
 }
+
+/* Refill s->w with the next keystream bytes as little-endian words */
+static void aes256ctr_squeezewords(aes256ctr_ctx *s)
+{
+#if KYBER_X86_64
+  if(cpu_has_aesni()) {
+    /* x86 is little-endian, so the keystream bytes already are the words */
+    aesni_ctr_run(s->sk_exp, s->ivw, (uint8_t *)s->w, 64);
+    aesni_ctr_advance(s->ivw, 1);
+    s->nlanes = 8;
+    return;
+  }
+  if(cpu_has_avx2()) {
+    aes_ctr16x_words_avx2(s->w, s->ivw, s->sk_exp);
+    s->nlanes = 32;
+    return;
+  }
+#endif
+  aes_ctr4x_words(s->w, s->ivw, s->sk_exp);
+  s->nlanes = 8;
+}
+
+/* Next 8 keystream bytes as a little-endian lane, taken from the output
+ * words of aes_ctr4x without going through a byte buffer. Must not be
+ * mixed with aes256ctr_squeezeblocks on the same state. */
+uint64_t aes256ctr_squeezelane(aes256ctr_ctx *s)
+{
+  if(s->pos == s->nlanes) {
+    aes256ctr_squeezewords(s);
+    s->pos = 0;
+  }
+  s->pos += 1;
+  return (uint64_t)s->w[2*s->pos-1] << 32 | s->w[2*s->pos-2];
+}
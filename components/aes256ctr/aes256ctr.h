@@ -3,14 +3,26 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "cpufeatures.h"
 
 #define AES256CTR_BLOCKBYTES 64
 
+/* Keystream words buffered for aes256ctr_squeezelane: one 64-byte block,
+ * or on x86-64 the 256 bytes of one pass of the AVX2 bitsliced code */
+#if KYBER_X86_64
+#define AES256CTR_BUFWORDS 64
+#else
+#define AES256CTR_BUFWORDS 16
+#endif
+
 #define AES256CTR_NAMESPACE(s) pqcrystals_kyber_aes256ctr_ref_##s
 
 typedef struct {
   uint64_t sk_exp[120];
   uint32_t ivw[16];
+  uint32_t w[AES256CTR_BUFWORDS]; /* keystream read by aes256ctr_squeezelane */
+  unsigned int pos;    /* lanes of w already squeezed */
+  unsigned int nlanes; /* lanes of w filled */
 } aes256ctr_ctx;
 
 #define aes256ctr_prf AES256CTR_NAMESPACE(prf)
@@ -24,9 +36,21 @@ void aes256ctr_init(aes256ctr_ctx *state,
                     const uint8_t key[32],
                     const uint8_t nonce[12]);
 
+/* aes256ctr_init split in two: the key schedule from aes256ctr_setkey
+ * stays valid across any number of aes256ctr_setnonce calls, each of
+ * which restarts the keystream at counter 0 under the new nonce */
+#define aes256ctr_setkey AES256CTR_NAMESPACE(setkey)
+void aes256ctr_setkey(aes256ctr_ctx *state, const uint8_t key[32]);
+
+#define aes256ctr_setnonce AES256CTR_NAMESPACE(setnonce)
+void aes256ctr_setnonce(aes256ctr_ctx *state, const uint8_t nonce[12]);
+
 #define aes256ctr_squeezeblocks AES256CTR_NAMESPACE(squeezeblocks)
 void aes256ctr_squeezeblocks(uint8_t *out,
                              size_t nblocks,
                              aes256ctr_ctx *state);
 
+#define aes256ctr_squeezelane AES256CTR_NAMESPACE(squeezelane)
+uint64_t aes256ctr_squeezelane(aes256ctr_ctx *state);
+
 #endif
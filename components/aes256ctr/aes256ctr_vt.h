@@ -0,0 +1,41 @@
+#ifndef AES256CTR_VT_H
+#define AES256CTR_VT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes256ctr.h"
+
+/*
+ * Table-based AES-256-CTR. NOT constant time: the table lookups are
+ * indexed by key- and state-dependent bytes and leak them through the
+ * cache. Only built with AES_XOF_VARTIME=1, and then only used for the
+ * matrix expansion XOF, whose key is the public seed. The PRF on secret
+ * seeds always stays on the constant-time aes256ctr_* functions; the
+ * separate context type keeps the two apart and "make check_aes_vartime"
+ * verifies that nothing but gen_matrix links against this code.
+ * Meant for targets without AES instructions; on x86-64 hosts with AES-NI
+ * the constant-time aes256ctr_* functions are faster, leave it off there.
+ */
+typedef struct {
+  uint32_t rk[60];
+  uint32_t nonce[3];
+  uint32_t ctr;
+  uint32_t w[16];   /* last keystream block, read by aes256ctr_vt_squeezelane */
+  unsigned int pos; /* lanes of w already squeezed */
+} aes256ctr_vt_ctx;
+
+#define aes256ctr_vt_setkey AES256CTR_NAMESPACE(vt_setkey)
+void aes256ctr_vt_setkey(aes256ctr_vt_ctx *state, const uint8_t key[32]);
+
+#define aes256ctr_vt_setnonce AES256CTR_NAMESPACE(vt_setnonce)
+void aes256ctr_vt_setnonce(aes256ctr_vt_ctx *state, const uint8_t nonce[12]);
+
+#define aes256ctr_vt_squeezeblocks AES256CTR_NAMESPACE(vt_squeezeblocks)
+void aes256ctr_vt_squeezeblocks(uint8_t *out,
+                                size_t nblocks,
+                                aes256ctr_vt_ctx *state);
+
+#define aes256ctr_vt_squeezelane AES256CTR_NAMESPACE(vt_squeezelane)
+uint64_t aes256ctr_vt_squeezelane(aes256ctr_vt_ctx *state);
+
+#endif
@@ -1,6 +1,10 @@
 #include <stdint.h>
 #include "params.h"
 #include "cbd.h"
+#include "cpufeatures.h"
+#if KYBER_X86_64
+#include <immintrin.h>
+#endif
 
 /*************************************************
 * Name:        load32_littleendian
@@ -44,6 +48,100 @@ static uint32_t load24_littleendian(const uint8_t x[3])
 }
 #endif
 
+#if KYBER_X86_64
+/*************************************************
+* Name:        cbd2_avx2
+*
+* Description: AVX2 version of cbd2: 16 bytes give 32 coefficients per
+*              block, 16 per 256-bit store. Same output as cbd2.
+*
+* Arguments:   - int16_t *r: pointer to output coefficients
+*              - const uint8_t *buf: pointer to input byte array
+*              - unsigned int nblocks: number of 16-byte blocks
+**************************************************/
+TARGET_AVX2
+static void cbd2_avx2(int16_t *r, const uint8_t *buf, unsigned int nblocks)
+{
+  unsigned int i;
+  const __m128i mask55 = _mm_set1_epi8(0x55);
+  const __m128i mask33 = _mm_set1_epi8(0x33);
+  const __m128i mask0f = _mm_set1_epi8(0x0F);
+  const __m128i three = _mm_set1_epi8(3);
+  __m128i f, d, lo, hi;
+
+  for(i=0;i<nblocks;i++) {
+    f = _mm_loadu_si128((const __m128i *)&buf[16*i]);
+    d = _mm_add_epi8(_mm_and_si128(f, mask55),
+                     _mm_and_si128(_mm_srli_epi16(f, 1), mask55));
+
+    /* a+3-b per nibble: 1..5, so nothing borrows */
+    f = _mm_add_epi8(_mm_and_si128(d, mask33), mask33);
+    f = _mm_sub_epi8(f, _mm_and_si128(_mm_srli_epi16(d, 2), mask33));
+
+    lo = _mm_sub_epi8(_mm_and_si128(f, mask0f), three);
+    hi = _mm_sub_epi8(_mm_and_si128(_mm_srli_epi16(f, 4), mask0f), three);
+    _mm256_storeu_si256((__m256i *)&r[32*i],
+                        _mm256_cvtepi8_epi16(_mm_unpacklo_epi8(lo, hi)));
+    _mm256_storeu_si256((__m256i *)&r[32*i+16],
+                        _mm256_cvtepi8_epi16(_mm_unpackhi_epi8(lo, hi)));
+  }
+}
+
+/*************************************************
+* Name:        cbd3_avx2
+*
+* Description: AVX2 version of cbd3: 24 bytes give 32 coefficients per
+*              block, one 24-bit group per 32-bit lane, 16 per 256-bit
+*              store. Same output as cbd3.
+*              This function is only needed for Kyber-512
+*
+* Arguments:   - int16_t *r: pointer to output coefficients
+*              - const uint8_t *buf: pointer to input byte array
+*              - unsigned int nblocks: number of 24-byte blocks
+**************************************************/
+#if KYBER_ETA1 == 3
+TARGET_AVX2
+static void cbd3_avx2(int16_t *r, const uint8_t *buf, unsigned int nblocks)
+{
+  unsigned int i;
+  /* Groups 0-3 from bytes 0-11 of the low lane, 4-7 from bytes 4-15
+   * of the high lane, which holds bytes 8-23 */
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1,
+                                            4,5,6,-1,7,8,9,-1,10,11,12,-1,13,14,15,-1);
+  const __m256i mask249 = _mm256_set1_epi32(0x249249);
+  const __m256i mask3f = _mm256_set1_epi32(0x3F);
+  const __m256i mask3f16 = _mm256_set1_epi32(0x3F0000);
+  const __m256i mask7 = _mm256_set1_epi16(7);
+  __m256i f, d, p0, p1;
+
+  for(i=0;i<nblocks;i++) {
+    f = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&buf[24*i])),
+          _mm_loadu_si128((const __m128i *)&buf[24*i+8]), 1);
+    f = _mm256_shuffle_epi8(f, shufbidx);
+
+    d = _mm256_and_si256(f, mask249);
+    d = _mm256_add_epi32(d, _mm256_and_si256(_mm256_srli_epi32(f, 1), mask249));
+    d = _mm256_add_epi32(d, _mm256_and_si256(_mm256_srli_epi32(f, 2), mask249));
+
+    /* 16-bit halves hold (a,b) of coefficients 0,1 and 2,3 of a group */
+    p0 = _mm256_or_si256(_mm256_and_si256(d, mask3f),
+                         _mm256_and_si256(_mm256_slli_epi32(d, 10), mask3f16));
+    p1 = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(d, 12), mask3f),
+                         _mm256_and_si256(_mm256_srli_epi32(d, 2), mask3f16));
+    p0 = _mm256_sub_epi16(_mm256_and_si256(p0, mask7),
+                          _mm256_and_si256(_mm256_srli_epi16(p0, 3), mask7));
+    p1 = _mm256_sub_epi16(_mm256_and_si256(p1, mask7),
+                          _mm256_and_si256(_mm256_srli_epi16(p1, 3), mask7));
+
+    f = _mm256_unpacklo_epi32(p0, p1);
+    d = _mm256_unpackhi_epi32(p0, p1);
+    _mm256_storeu_si256((__m256i *)&r[32*i], _mm256_permute2x128_si256(f, d, 0x20));
+    _mm256_storeu_si256((__m256i *)&r[32*i+16], _mm256_permute2x128_si256(f, d, 0x31));
+  }
+}
+#endif
+#endif
 
 /*************************************************
 * Name:        cbd2
@@ -61,6 +159,13 @@ static void cbd2(poly *r, const uint8_t buf[2*KYBER_N/4])
   uint32_t t,d;
   int16_t a,b;
 
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    cbd2_avx2(r->coeffs, buf, KYBER_N/32);
+    return;
+  }
+#endif
+
   for(i=0;i<KYBER_N/8;i++) {
     t  = load32_littleendian(buf+4*i);
     d  = t & 0x55555555;
@@ -92,6 +197,13 @@ static void cbd3(poly *r, const uint8_t buf[3*KYBER_N/4])
   uint32_t t,d;
   int16_t a,b;
 
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    cbd3_avx2(r->coeffs, buf, KYBER_N/32);
+    return;
+  }
+#endif
+
   for(i=0;i<KYBER_N/4;i++) {
     t  = load24_littleendian(buf+3*i);
     d  = t & 0x00249249;
@@ -107,6 +219,89 @@ static void cbd3(poly *r, const uint8_t buf[3*KYBER_N/4])
 }
 #endif
 
+/*************************************************
+* Name:        cbd2_lanes
+*
+* Description: Same as cbd2 on 16 bytes given as two little-endian lanes;
+*              computes 32 coefficients
+*
+* Arguments:   - int16_t *r: pointer to output coefficients
+*              - const uint64_t *t: pointer to input lanes
+**************************************************/
+static void cbd2_lanes(int16_t r[32], const uint64_t t[2])
+{
+  unsigned int i,j;
+  uint64_t d;
+  int16_t a,b;
+
+#if KYBER_X86_64
+  /* Little-endian lanes are the input bytes */
+  if(cpu_has_avx2()) {
+    cbd2_avx2(r, (const uint8_t *)t, 1);
+    return;
+  }
+#endif
+
+  for(i=0;i<2;i++) {
+    d  = t[i] & 0x5555555555555555ULL;
+    d += (t[i]>>1) & 0x5555555555555555ULL;
+
+    for(j=0;j<16;j++) {
+      a = (d >> (4*j+0)) & 0x3;
+      b = (d >> (4*j+2)) & 0x3;
+      r[16*i+j] = a - b;
+    }
+  }
+}
+
+/*************************************************
+* Name:        cbd3_lanes
+*
+* Description: Same as cbd3 on 24 bytes given as three little-endian
+*              lanes; computes 32 coefficients.
+*              This function is only needed for Kyber-512
+*
+* Arguments:   - int16_t *r: pointer to output coefficients
+*              - const uint64_t *t: pointer to input lanes
+**************************************************/
+#if KYBER_ETA1 == 3
+static void cbd3_lanes(int16_t r[32], const uint64_t t[3])
+{
+  unsigned int i,j;
+  uint32_t w[8],d;
+  int16_t a,b;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    cbd3_avx2(r, (const uint8_t *)t, 1);
+    return;
+  }
+#endif
+
+  /* Eight 24-bit groups of four coefficients each */
+  w[0] = t[0];
+  w[1] = t[0] >> 24;
+  w[2] = t[0] >> 48 | t[1] << 16;
+  w[3] = t[1] >> 8;
+  w[4] = t[1] >> 32;
+  w[5] = t[1] >> 56 | t[2] << 8;
+  w[6] = t[2] >> 16;
+  w[7] = t[2] >> 40;
+
+  for(i=0;i<8;i++) {
+    d  = w[i] & 0x00249249;
+    d += (w[i]>>1) & 0x00249249;
+    d += (w[i]>>2) & 0x00249249;
+
+    for(j=0;j<4;j++) {
+      a = (d >> (6*j+0)) & 0x7;
+      b = (d >> (6*j+3)) & 0x7;
+      r[4*i+j] = a - b;
+    }
+  }
+}
+#endif
+
 void poly_cbd_eta1(poly *r, const uint8_t buf[KYBER_ETA1*KYBER_N/4])
 {
 #if KYBER_ETA1 == 2
@@ -126,3 +321,23 @@ void poly_cbd_eta2(poly *r, const uint8_t buf[KYBER_ETA2*KYBER_N/4])
 #error "This implementation requires eta2 = 2"
 #endif
 }
+
+void cbd_eta1_lanes(int16_t r[32], const uint64_t t[KYBER_ETA1])
+{
+#if KYBER_ETA1 == 2
+  cbd2_lanes(r, t);
+#elif KYBER_ETA1 == 3
+  cbd3_lanes(r, t);
+#else
+#error "This implementation requires eta1 in {2,3}"
+#endif
+}
+
+void cbd_eta2_lanes(int16_t r[32], const uint64_t t[KYBER_ETA2])
+{
+#if KYBER_ETA2 == 2
+  cbd2_lanes(r, t);
+#else
+#error "This implementation requires eta2 = 2"
+#endif
+}
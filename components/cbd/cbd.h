@@ -11,4 +11,12 @@ void poly_cbd_eta1(poly *r, const uint8_t buf[KYBER_ETA1*KYBER_N/4]);
 #define poly_cbd_eta2 KYBER_NAMESPACE(poly_cbd_eta2)
 void poly_cbd_eta2(poly *r, const uint8_t buf[KYBER_ETA2*KYBER_N/4]);
 
+/* Lane-wise samplers: KYBER_ETAx little-endian 64-bit lanes of PRF output
+ * give 32 coefficients, so the PRF can be read without a byte buffer */
+#define cbd_eta1_lanes KYBER_NAMESPACE(cbd_eta1_lanes)
+void cbd_eta1_lanes(int16_t r[32], const uint64_t t[KYBER_ETA1]);
+
+#define cbd_eta2_lanes KYBER_NAMESPACE(cbd_eta2_lanes)
+void cbd_eta2_lanes(int16_t r[32], const uint64_t t[KYBER_ETA2]);
+
 #endif
@@ -0,0 +1,55 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+/*
+ * Runtime CPU feature detection for the optional x86-64 backends used on
+ * Linux hosts. SIMD code is compiled with per-function target attributes,
+ * so the rest of the tree keeps building with plain -O2 and one binary runs
+ * on any x86-64 CPU. On every other target (in particular the ESP32) all
+ * queries are constant 0 and only the portable code is compiled.
+ *
+ * Define KYBER_NO_SIMD to force the portable code on x86-64 as well, or
+ * KYBER_NO_AESNI / KYBER_NO_SHANI to disable only the AES-NI / SHA-NI code
+ * (e.g. to exercise the AVX2 code it takes precedence over).
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(KYBER_NO_SIMD)
+#define KYBER_X86_64 1
+
+#include <cpuid.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AESNI __attribute__((target("aes")))
+#define TARGET_SHANI __attribute__((target("sha,sse4.1")))
+
+#define cpu_has_avx2() __builtin_cpu_supports("avx2")
+#if defined(KYBER_NO_AESNI)
+#define cpu_has_aesni() 0
+#else
+#define cpu_has_aesni() __builtin_cpu_supports("aes")
+#endif
+
+/* Older libgcc does not report "sha" to __builtin_cpu_supports, so read
+ * CPUID leaf 7 (EBX bit 29) once; CPUID is slow, in a VM it traps */
+#if defined(KYBER_NO_SHANI)
+#define cpu_has_shani() 0
+#else
+static inline int cpu_has_shani(void)
+{
+  static int has = -1;
+  unsigned int a, b, c, d;
+
+  if (has < 0) {
+    has = __get_cpuid_count(7, 0, &a, &b, &c, &d) && ((b >> 29) & 1);
+  }
+  return has;
+}
+#endif
+#else
+#define KYBER_X86_64 0
+
+#define cpu_has_avx2() 0
+#define cpu_has_aesni() 0
+#define cpu_has_shani() 0
+#endif
+
+#endif
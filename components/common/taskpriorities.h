@@ -1,2 +1,26 @@
+#include "params.h"
+
 #define MAIN_TASK_PRIORITY 11
-#define INDCPA_SUBTASK_PRIORITY 10
\ No newline at end of file
+#define INDCPA_SUBTASK_PRIORITY 10
+
+/* Task stack sizes in bytes, as passed to xTaskCreatePinnedToCore:
+ * the peak measured on a host (portable code, -O0 and -O2, Kyber and
+ * Kyber-90s, every INDCPA_*_DUAL and INDCPA_STREAM_MATRIX combination)
+ * plus 4 KB for register-window spills, interrupt frames, printf and the
+ * mbedtls drivers, rounded up to whole KB. The main task peaks at
+ * 15.9/22.0/29.5 KB for K=2/3/4 with single-core indcpa (the dual-core
+ * variants keep their working data in it too); an indcpa subtask at
+ * 3.0 KB. Check on the device with uxTaskGetStackHighWaterMark (main.c
+ * prints it; INDCPA_STACK_WATERMARK=1 records it for the subtasks) */
+#ifndef MAIN_TASK_STACK_SIZE
+#if (KYBER_K == 2)
+#define MAIN_TASK_STACK_SIZE 20480
+#elif (KYBER_K == 3)
+#define MAIN_TASK_STACK_SIZE 26624
+#else
+#define MAIN_TASK_STACK_SIZE 33792
+#endif
+#endif
+#ifndef INDCPA_SUBTASK_STACK_SIZE
+#define INDCPA_SUBTASK_STACK_SIZE 7168
+#endif
@@ -44,6 +44,645 @@ static void store64(uint8_t x[8], uint64_t u) {
     x[i] = u >> 8*i;
 }
 
+#if (KECCAK_INTERLEAVED == 1)
+/*
+ * Bit-interleaved backend for 32-bit cores. Every lane of the state is kept
+ * as two 32-bit words, the even-indexed bits in the low word and the
+ * odd-indexed bits in the high word of the uint64_t slot. A 64-bit rotation
+ * then becomes two 32-bit rotations, and the conversion from and to the
+ * byte-oriented lane format is done only when absorbing and squeezing.
+ */
+
+#define ROL32(a, offset) ((a << offset) ^ (a >> (32-offset)))
+
+/* Keccak round constants, bit-interleaved as {even bits, odd bits} */
+static const uint32_t KeccakF_RoundConstantsInterleaved[NROUNDS][2] = {
+  {0x00000001UL, 0x00000000UL},
+  {0x00000000UL, 0x00000089UL},
+  {0x00000000UL, 0x8000008bUL},
+  {0x00000000UL, 0x80008080UL},
+  {0x00000001UL, 0x0000008bUL},
+  {0x00000001UL, 0x00008000UL},
+  {0x00000001UL, 0x80008088UL},
+  {0x00000001UL, 0x80000082UL},
+  {0x00000000UL, 0x0000000bUL},
+  {0x00000000UL, 0x0000000aUL},
+  {0x00000001UL, 0x00008082UL},
+  {0x00000000UL, 0x00008003UL},
+  {0x00000001UL, 0x0000808bUL},
+  {0x00000001UL, 0x8000000bUL},
+  {0x00000001UL, 0x8000008aUL},
+  {0x00000001UL, 0x80000081UL},
+  {0x00000000UL, 0x80000081UL},
+  {0x00000000UL, 0x80000008UL},
+  {0x00000000UL, 0x00000083UL},
+  {0x00000000UL, 0x80008003UL},
+  {0x00000001UL, 0x80008088UL},
+  {0x00000000UL, 0x80000088UL},
+  {0x00000001UL, 0x00008000UL},
+  {0x00000000UL, 0x80008082UL}
+};
+
+/*************************************************
+* Name:        unshuffle32
+*
+* Description: Move the even-indexed bits of a 32-bit word to its low half
+*              and the odd-indexed bits to its high half
+*
+* Arguments:   - uint32_t x: input word
+*
+* Returns the permuted word
+**************************************************/
+static uint32_t unshuffle32(uint32_t x)
+{
+  uint32_t t;
+
+  t = (x ^ (x >> 1)) & 0x22222222UL; x ^= t ^ (t << 1);
+  t = (x ^ (x >> 2)) & 0x0C0C0C0CUL; x ^= t ^ (t << 2);
+  t = (x ^ (x >> 4)) & 0x00F000F0UL; x ^= t ^ (t << 4);
+  t = (x ^ (x >> 8)) & 0x0000FF00UL; x ^= t ^ (t << 8);
+  return x;
+}
+
+/*************************************************
+* Name:        shuffle32
+*
+* Description: Inverse of unshuffle32
+*
+* Arguments:   - uint32_t x: input word
+*
+* Returns the permuted word
+**************************************************/
+static uint32_t shuffle32(uint32_t x)
+{
+  uint32_t t;
+
+  t = (x ^ (x >> 8)) & 0x0000FF00UL; x ^= t ^ (t << 8);
+  t = (x ^ (x >> 4)) & 0x00F000F0UL; x ^= t ^ (t << 4);
+  t = (x ^ (x >> 2)) & 0x0C0C0C0CUL; x ^= t ^ (t << 2);
+  t = (x ^ (x >> 1)) & 0x22222222UL; x ^= t ^ (t << 1);
+  return x;
+}
+
+/*************************************************
+* Name:        keccak_lane_in
+*
+* Description: Convert a little-endian lane to the bit-interleaved
+*              state representation
+*
+* Arguments:   - uint64_t x: lane as loaded by load64
+*
+* Returns the lane with the even bits in the low and the odd bits
+* in the high 32-bit word
+**************************************************/
+uint64_t keccak_lane_in(uint64_t x)
+{
+  uint32_t lo = unshuffle32((uint32_t)x);
+  uint32_t hi = unshuffle32((uint32_t)(x >> 32));
+  uint32_t e = (lo & 0x0000FFFFUL) | (hi << 16);
+  uint32_t o = (lo >> 16) | (hi & 0xFFFF0000UL);
+
+  return (uint64_t)o << 32 | e;
+}
+
+/*************************************************
+* Name:        keccak_lane_out
+*
+* Description: Convert a bit-interleaved lane back to the little-endian
+*              lane format; inverse of keccak_lane_in
+*
+* Arguments:   - uint64_t x: bit-interleaved lane
+*
+* Returns the lane as expected by store64
+**************************************************/
+uint64_t keccak_lane_out(uint64_t x)
+{
+  uint32_t e = (uint32_t)x;
+  uint32_t o = (uint32_t)(x >> 32);
+  uint32_t lo = shuffle32((e & 0x0000FFFFUL) | (o << 16));
+  uint32_t hi = shuffle32((e >> 16) | (o & 0xFFFF0000UL));
+
+  return (uint64_t)hi << 32 | lo;
+}
+
+/*************************************************
+* Name:        keccak_xor_byte
+*
+* Description: XOR one byte into the state at byte position i of the
+*              rate. Byte b of a lane holds bits 8b..8b+7, i.e., bits
+*              4b..4b+3 of both the even and the odd word.
+*
+* Arguments:   - uint64_t *s: pointer to Keccak state
+*              - unsigned int i: byte position
+*              - uint8_t b: byte to absorb
+**************************************************/
+static void keccak_xor_byte(uint64_t s[25], unsigned int i, uint8_t b)
+{
+  uint32_t e = b & 0x55, o = (b >> 1) & 0x55;
+
+  e = (e | e >> 1) & 0x33; e = (e | e >> 2) & 0x0F;
+  o = (o | o >> 1) & 0x33; o = (o | o >> 2) & 0x0F;
+  s[i/8] ^= ((uint64_t)o << 32 | e) << 4*(i%8);
+}
+
+/*************************************************
+* Name:        keccak_extract_byte
+*
+* Description: Read the byte at byte position i of the rate
+*
+* Arguments:   - const uint64_t *s: pointer to Keccak state
+*              - unsigned int i: byte position
+*
+* Returns the byte
+**************************************************/
+static uint8_t keccak_extract_byte(const uint64_t s[25], unsigned int i)
+{
+  uint32_t e = (uint32_t)(s[i/8] >> 4*(i%8)) & 0x0F;
+  uint32_t o = (uint32_t)(s[i/8] >> (32 + 4*(i%8))) & 0x0F;
+
+  e = (e | e << 2) & 0x33; e = (e | e << 1) & 0x55;
+  o = (o | o << 2) & 0x33; o = (o | o << 1) & 0x55;
+  return e | o << 1;
+}
+
+#define LANE_IN(x) keccak_lane_in(x)
+#define LANE_OUT(x) keccak_lane_out(x)
+#define XOR_BYTE(s, i, b) keccak_xor_byte(s, i, b)
+#define EXTRACT_BYTE(s, i) keccak_extract_byte(s, i)
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute
+*
+* Description: The Keccak F1600 Permutation on a bit-interleaved state
+*
+* Arguments:   - uint64_t *state: pointer to input/output Keccak state
+**************************************************/
+void KeccakF1600_StatePermute(uint64_t state[25])
+{
+        int round;
+
+        uint32_t Aba0, Aba1, Abe0, Abe1, Abi0, Abi1, Abo0, Abo1, Abu0, Abu1;
+        uint32_t Aga0, Aga1, Age0, Age1, Agi0, Agi1, Ago0, Ago1, Agu0, Agu1;
+        uint32_t Aka0, Aka1, Ake0, Ake1, Aki0, Aki1, Ako0, Ako1, Aku0, Aku1;
+        uint32_t Ama0, Ama1, Ame0, Ame1, Ami0, Ami1, Amo0, Amo1, Amu0, Amu1;
+        uint32_t Asa0, Asa1, Ase0, Ase1, Asi0, Asi1, Aso0, Aso1, Asu0, Asu1;
+        uint32_t BCa0, BCa1, BCe0, BCe1, BCi0, BCi1, BCo0, BCo1, BCu0, BCu1;
+        uint32_t Da0, Da1, De0, De1, Di0, Di1, Do0, Do1, Du0, Du1;
+        uint32_t Eba0, Eba1, Ebe0, Ebe1, Ebi0, Ebi1, Ebo0, Ebo1, Ebu0, Ebu1;
+        uint32_t Ega0, Ega1, Ege0, Ege1, Egi0, Egi1, Ego0, Ego1, Egu0, Egu1;
+        uint32_t Eka0, Eka1, Eke0, Eke1, Eki0, Eki1, Eko0, Eko1, Eku0, Eku1;
+        uint32_t Ema0, Ema1, Eme0, Eme1, Emi0, Emi1, Emo0, Emo1, Emu0, Emu1;
+        uint32_t Esa0, Esa1, Ese0, Ese1, Esi0, Esi1, Eso0, Eso1, Esu0, Esu1;
+        //copyFromState(A, state)
+        Aba0 = (uint32_t)state[ 0];
+        Aba1 = (uint32_t)(state[ 0] >> 32);
+        Abe0 = (uint32_t)state[ 1];
+        Abe1 = (uint32_t)(state[ 1] >> 32);
+        Abi0 = (uint32_t)state[ 2];
+        Abi1 = (uint32_t)(state[ 2] >> 32);
+        Abo0 = (uint32_t)state[ 3];
+        Abo1 = (uint32_t)(state[ 3] >> 32);
+        Abu0 = (uint32_t)state[ 4];
+        Abu1 = (uint32_t)(state[ 4] >> 32);
+        Aga0 = (uint32_t)state[ 5];
+        Aga1 = (uint32_t)(state[ 5] >> 32);
+        Age0 = (uint32_t)state[ 6];
+        Age1 = (uint32_t)(state[ 6] >> 32);
+        Agi0 = (uint32_t)state[ 7];
+        Agi1 = (uint32_t)(state[ 7] >> 32);
+        Ago0 = (uint32_t)state[ 8];
+        Ago1 = (uint32_t)(state[ 8] >> 32);
+        Agu0 = (uint32_t)state[ 9];
+        Agu1 = (uint32_t)(state[ 9] >> 32);
+        Aka0 = (uint32_t)state[10];
+        Aka1 = (uint32_t)(state[10] >> 32);
+        Ake0 = (uint32_t)state[11];
+        Ake1 = (uint32_t)(state[11] >> 32);
+        Aki0 = (uint32_t)state[12];
+        Aki1 = (uint32_t)(state[12] >> 32);
+        Ako0 = (uint32_t)state[13];
+        Ako1 = (uint32_t)(state[13] >> 32);
+        Aku0 = (uint32_t)state[14];
+        Aku1 = (uint32_t)(state[14] >> 32);
+        Ama0 = (uint32_t)state[15];
+        Ama1 = (uint32_t)(state[15] >> 32);
+        Ame0 = (uint32_t)state[16];
+        Ame1 = (uint32_t)(state[16] >> 32);
+        Ami0 = (uint32_t)state[17];
+        Ami1 = (uint32_t)(state[17] >> 32);
+        Amo0 = (uint32_t)state[18];
+        Amo1 = (uint32_t)(state[18] >> 32);
+        Amu0 = (uint32_t)state[19];
+        Amu1 = (uint32_t)(state[19] >> 32);
+        Asa0 = (uint32_t)state[20];
+        Asa1 = (uint32_t)(state[20] >> 32);
+        Ase0 = (uint32_t)state[21];
+        Ase1 = (uint32_t)(state[21] >> 32);
+        Asi0 = (uint32_t)state[22];
+        Asi1 = (uint32_t)(state[22] >> 32);
+        Aso0 = (uint32_t)state[23];
+        Aso1 = (uint32_t)(state[23] >> 32);
+        Asu0 = (uint32_t)state[24];
+        Asu1 = (uint32_t)(state[24] >> 32);
+
+        for(round = 0; round < NROUNDS; round += 2) {
+            //    prepareTheta
+            BCa0 = Aba0^Aga0^Aka0^Ama0^Asa0;
+            BCa1 = Aba1^Aga1^Aka1^Ama1^Asa1;
+            BCe0 = Abe0^Age0^Ake0^Ame0^Ase0;
+            BCe1 = Abe1^Age1^Ake1^Ame1^Ase1;
+            BCi0 = Abi0^Agi0^Aki0^Ami0^Asi0;
+            BCi1 = Abi1^Agi1^Aki1^Ami1^Asi1;
+            BCo0 = Abo0^Ago0^Ako0^Amo0^Aso0;
+            BCo1 = Abo1^Ago1^Ako1^Amo1^Aso1;
+            BCu0 = Abu0^Agu0^Aku0^Amu0^Asu0;
+            BCu1 = Abu1^Agu1^Aku1^Amu1^Asu1;
+
+            //thetaRhoPiChiIotaPrepareTheta(round, A, E)
+            Da0 = BCu0^ROL32(BCe1, 1);
+            Da1 = BCu1^BCe0;
+            De0 = BCa0^ROL32(BCi1, 1);
+            De1 = BCa1^BCi0;
+            Di0 = BCe0^ROL32(BCo1, 1);
+            Di1 = BCe1^BCo0;
+            Do0 = BCi0^ROL32(BCu1, 1);
+            Do1 = BCi1^BCu0;
+            Du0 = BCo0^ROL32(BCa1, 1);
+            Du1 = BCo1^BCa0;
+
+            Aba0 ^= Da0;
+            Aba1 ^= Da1;
+            BCa0 = Aba0;
+            BCa1 = Aba1;
+            Age0 ^= De0;
+            Age1 ^= De1;
+            BCe0 = ROL32(Age0, 22);
+            BCe1 = ROL32(Age1, 22);
+            Aki0 ^= Di0;
+            Aki1 ^= Di1;
+            BCi0 = ROL32(Aki1, 22);
+            BCi1 = ROL32(Aki0, 21);
+            Amo0 ^= Do0;
+            Amo1 ^= Do1;
+            BCo0 = ROL32(Amo1, 11);
+            BCo1 = ROL32(Amo0, 10);
+            Asu0 ^= Du0;
+            Asu1 ^= Du1;
+            BCu0 = ROL32(Asu0,  7);
+            BCu1 = ROL32(Asu1,  7);
+            Eba0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Eba1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Eba0 ^= KeccakF_RoundConstantsInterleaved[round][0];
+            Eba1 ^= KeccakF_RoundConstantsInterleaved[round][1];
+            Ebe0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ebe1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Ebi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Ebi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Ebo0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Ebo1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Ebu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Ebu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Abo0 ^= Do0;
+            Abo1 ^= Do1;
+            BCa0 = ROL32(Abo0, 14);
+            BCa1 = ROL32(Abo1, 14);
+            Agu0 ^= Du0;
+            Agu1 ^= Du1;
+            BCe0 = ROL32(Agu0, 10);
+            BCe1 = ROL32(Agu1, 10);
+            Aka0 ^= Da0;
+            Aka1 ^= Da1;
+            BCi0 = ROL32(Aka1,  2);
+            BCi1 = ROL32(Aka0,  1);
+            Ame0 ^= De0;
+            Ame1 ^= De1;
+            BCo0 = ROL32(Ame1, 23);
+            BCo1 = ROL32(Ame0, 22);
+            Asi0 ^= Di0;
+            Asi1 ^= Di1;
+            BCu0 = ROL32(Asi1, 31);
+            BCu1 = ROL32(Asi0, 30);
+            Ega0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Ega1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Ege0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ege1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Egi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Egi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Ego0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Ego1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Egu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Egu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Abe0 ^= De0;
+            Abe1 ^= De1;
+            BCa0 = ROL32(Abe1,  1);
+            BCa1 = Abe0;
+            Agi0 ^= Di0;
+            Agi1 ^= Di1;
+            BCe0 = ROL32(Agi0,  3);
+            BCe1 = ROL32(Agi1,  3);
+            Ako0 ^= Do0;
+            Ako1 ^= Do1;
+            BCi0 = ROL32(Ako1, 13);
+            BCi1 = ROL32(Ako0, 12);
+            Amu0 ^= Du0;
+            Amu1 ^= Du1;
+            BCo0 = ROL32(Amu0,  4);
+            BCo1 = ROL32(Amu1,  4);
+            Asa0 ^= Da0;
+            Asa1 ^= Da1;
+            BCu0 = ROL32(Asa0,  9);
+            BCu1 = ROL32(Asa1,  9);
+            Eka0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Eka1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Eke0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Eke1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Eki0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Eki1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Eko0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Eko1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Eku0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Eku1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Abu0 ^= Du0;
+            Abu1 ^= Du1;
+            BCa0 = ROL32(Abu1, 14);
+            BCa1 = ROL32(Abu0, 13);
+            Aga0 ^= Da0;
+            Aga1 ^= Da1;
+            BCe0 = ROL32(Aga0, 18);
+            BCe1 = ROL32(Aga1, 18);
+            Ake0 ^= De0;
+            Ake1 ^= De1;
+            BCi0 = ROL32(Ake0,  5);
+            BCi1 = ROL32(Ake1,  5);
+            Ami0 ^= Di0;
+            Ami1 ^= Di1;
+            BCo0 = ROL32(Ami1,  8);
+            BCo1 = ROL32(Ami0,  7);
+            Aso0 ^= Do0;
+            Aso1 ^= Do1;
+            BCu0 = ROL32(Aso0, 28);
+            BCu1 = ROL32(Aso1, 28);
+            Ema0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Ema1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Eme0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Eme1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Emi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Emi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Emo0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Emo1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Emu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Emu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Abi0 ^= Di0;
+            Abi1 ^= Di1;
+            BCa0 = ROL32(Abi0, 31);
+            BCa1 = ROL32(Abi1, 31);
+            Ago0 ^= Do0;
+            Ago1 ^= Do1;
+            BCe0 = ROL32(Ago1, 28);
+            BCe1 = ROL32(Ago0, 27);
+            Aku0 ^= Du0;
+            Aku1 ^= Du1;
+            BCi0 = ROL32(Aku1, 20);
+            BCi1 = ROL32(Aku0, 19);
+            Ama0 ^= Da0;
+            Ama1 ^= Da1;
+            BCo0 = ROL32(Ama1, 21);
+            BCo1 = ROL32(Ama0, 20);
+            Ase0 ^= De0;
+            Ase1 ^= De1;
+            BCu0 = ROL32(Ase0,  1);
+            BCu1 = ROL32(Ase1,  1);
+            Esa0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Esa1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Ese0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ese1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Esi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Esi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Eso0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Eso1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Esu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Esu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            //    prepareTheta
+            BCa0 = Eba0^Ega0^Eka0^Ema0^Esa0;
+            BCa1 = Eba1^Ega1^Eka1^Ema1^Esa1;
+            BCe0 = Ebe0^Ege0^Eke0^Eme0^Ese0;
+            BCe1 = Ebe1^Ege1^Eke1^Eme1^Ese1;
+            BCi0 = Ebi0^Egi0^Eki0^Emi0^Esi0;
+            BCi1 = Ebi1^Egi1^Eki1^Emi1^Esi1;
+            BCo0 = Ebo0^Ego0^Eko0^Emo0^Eso0;
+            BCo1 = Ebo1^Ego1^Eko1^Emo1^Eso1;
+            BCu0 = Ebu0^Egu0^Eku0^Emu0^Esu0;
+            BCu1 = Ebu1^Egu1^Eku1^Emu1^Esu1;
+
+            //thetaRhoPiChiIotaPrepareTheta(round+1, E, A)
+            Da0 = BCu0^ROL32(BCe1, 1);
+            Da1 = BCu1^BCe0;
+            De0 = BCa0^ROL32(BCi1, 1);
+            De1 = BCa1^BCi0;
+            Di0 = BCe0^ROL32(BCo1, 1);
+            Di1 = BCe1^BCo0;
+            Do0 = BCi0^ROL32(BCu1, 1);
+            Do1 = BCi1^BCu0;
+            Du0 = BCo0^ROL32(BCa1, 1);
+            Du1 = BCo1^BCa0;
+
+            Eba0 ^= Da0;
+            Eba1 ^= Da1;
+            BCa0 = Eba0;
+            BCa1 = Eba1;
+            Ege0 ^= De0;
+            Ege1 ^= De1;
+            BCe0 = ROL32(Ege0, 22);
+            BCe1 = ROL32(Ege1, 22);
+            Eki0 ^= Di0;
+            Eki1 ^= Di1;
+            BCi0 = ROL32(Eki1, 22);
+            BCi1 = ROL32(Eki0, 21);
+            Emo0 ^= Do0;
+            Emo1 ^= Do1;
+            BCo0 = ROL32(Emo1, 11);
+            BCo1 = ROL32(Emo0, 10);
+            Esu0 ^= Du0;
+            Esu1 ^= Du1;
+            BCu0 = ROL32(Esu0,  7);
+            BCu1 = ROL32(Esu1,  7);
+            Aba0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Aba1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Aba0 ^= KeccakF_RoundConstantsInterleaved[round+1][0];
+            Aba1 ^= KeccakF_RoundConstantsInterleaved[round+1][1];
+            Abe0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Abe1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Abi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Abi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Abo0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Abo1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Abu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Abu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Ebo0 ^= Do0;
+            Ebo1 ^= Do1;
+            BCa0 = ROL32(Ebo0, 14);
+            BCa1 = ROL32(Ebo1, 14);
+            Egu0 ^= Du0;
+            Egu1 ^= Du1;
+            BCe0 = ROL32(Egu0, 10);
+            BCe1 = ROL32(Egu1, 10);
+            Eka0 ^= Da0;
+            Eka1 ^= Da1;
+            BCi0 = ROL32(Eka1,  2);
+            BCi1 = ROL32(Eka0,  1);
+            Eme0 ^= De0;
+            Eme1 ^= De1;
+            BCo0 = ROL32(Eme1, 23);
+            BCo1 = ROL32(Eme0, 22);
+            Esi0 ^= Di0;
+            Esi1 ^= Di1;
+            BCu0 = ROL32(Esi1, 31);
+            BCu1 = ROL32(Esi0, 30);
+            Aga0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Aga1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Age0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Age1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Agi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Agi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Ago0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Ago1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Agu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Agu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Ebe0 ^= De0;
+            Ebe1 ^= De1;
+            BCa0 = ROL32(Ebe1,  1);
+            BCa1 = Ebe0;
+            Egi0 ^= Di0;
+            Egi1 ^= Di1;
+            BCe0 = ROL32(Egi0,  3);
+            BCe1 = ROL32(Egi1,  3);
+            Eko0 ^= Do0;
+            Eko1 ^= Do1;
+            BCi0 = ROL32(Eko1, 13);
+            BCi1 = ROL32(Eko0, 12);
+            Emu0 ^= Du0;
+            Emu1 ^= Du1;
+            BCo0 = ROL32(Emu0,  4);
+            BCo1 = ROL32(Emu1,  4);
+            Esa0 ^= Da0;
+            Esa1 ^= Da1;
+            BCu0 = ROL32(Esa0,  9);
+            BCu1 = ROL32(Esa1,  9);
+            Aka0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Aka1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Ake0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ake1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Aki0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Aki1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Ako0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Ako1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Aku0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Aku1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Ebu0 ^= Du0;
+            Ebu1 ^= Du1;
+            BCa0 = ROL32(Ebu1, 14);
+            BCa1 = ROL32(Ebu0, 13);
+            Ega0 ^= Da0;
+            Ega1 ^= Da1;
+            BCe0 = ROL32(Ega0, 18);
+            BCe1 = ROL32(Ega1, 18);
+            Eke0 ^= De0;
+            Eke1 ^= De1;
+            BCi0 = ROL32(Eke0,  5);
+            BCi1 = ROL32(Eke1,  5);
+            Emi0 ^= Di0;
+            Emi1 ^= Di1;
+            BCo0 = ROL32(Emi1,  8);
+            BCo1 = ROL32(Emi0,  7);
+            Eso0 ^= Do0;
+            Eso1 ^= Do1;
+            BCu0 = ROL32(Eso0, 28);
+            BCu1 = ROL32(Eso1, 28);
+            Ama0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Ama1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Ame0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ame1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Ami0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Ami1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Amo0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Amo1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Amu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Amu1 =   BCu1 ^((~BCa1)&  BCe1 );
+
+            Ebi0 ^= Di0;
+            Ebi1 ^= Di1;
+            BCa0 = ROL32(Ebi0, 31);
+            BCa1 = ROL32(Ebi1, 31);
+            Ego0 ^= Do0;
+            Ego1 ^= Do1;
+            BCe0 = ROL32(Ego1, 28);
+            BCe1 = ROL32(Ego0, 27);
+            Eku0 ^= Du0;
+            Eku1 ^= Du1;
+            BCi0 = ROL32(Eku1, 20);
+            BCi1 = ROL32(Eku0, 19);
+            Ema0 ^= Da0;
+            Ema1 ^= Da1;
+            BCo0 = ROL32(Ema1, 21);
+            BCo1 = ROL32(Ema0, 20);
+            Ese0 ^= De0;
+            Ese1 ^= De1;
+            BCu0 = ROL32(Ese0,  1);
+            BCu1 = ROL32(Ese1,  1);
+            Asa0 =   BCa0 ^((~BCe0)&  BCi0 );
+            Asa1 =   BCa1 ^((~BCe1)&  BCi1 );
+            Ase0 =   BCe0 ^((~BCi0)&  BCo0 );
+            Ase1 =   BCe1 ^((~BCi1)&  BCo1 );
+            Asi0 =   BCi0 ^((~BCo0)&  BCu0 );
+            Asi1 =   BCi1 ^((~BCo1)&  BCu1 );
+            Aso0 =   BCo0 ^((~BCu0)&  BCa0 );
+            Aso1 =   BCo1 ^((~BCu1)&  BCa1 );
+            Asu0 =   BCu0 ^((~BCa0)&  BCe0 );
+            Asu1 =   BCu1 ^((~BCa1)&  BCe1 );
+        }
+
+
+        //copyToState(state, A)
+        state[ 0] = (uint64_t)Aba1 << 32 | Aba0;
+        state[ 1] = (uint64_t)Abe1 << 32 | Abe0;
+        state[ 2] = (uint64_t)Abi1 << 32 | Abi0;
+        state[ 3] = (uint64_t)Abo1 << 32 | Abo0;
+        state[ 4] = (uint64_t)Abu1 << 32 | Abu0;
+        state[ 5] = (uint64_t)Aga1 << 32 | Aga0;
+        state[ 6] = (uint64_t)Age1 << 32 | Age0;
+        state[ 7] = (uint64_t)Agi1 << 32 | Agi0;
+        state[ 8] = (uint64_t)Ago1 << 32 | Ago0;
+        state[ 9] = (uint64_t)Agu1 << 32 | Agu0;
+        state[10] = (uint64_t)Aka1 << 32 | Aka0;
+        state[11] = (uint64_t)Ake1 << 32 | Ake0;
+        state[12] = (uint64_t)Aki1 << 32 | Aki0;
+        state[13] = (uint64_t)Ako1 << 32 | Ako0;
+        state[14] = (uint64_t)Aku1 << 32 | Aku0;
+        state[15] = (uint64_t)Ama1 << 32 | Ama0;
+        state[16] = (uint64_t)Ame1 << 32 | Ame0;
+        state[17] = (uint64_t)Ami1 << 32 | Ami0;
+        state[18] = (uint64_t)Amo1 << 32 | Amo0;
+        state[19] = (uint64_t)Amu1 << 32 | Amu0;
+        state[20] = (uint64_t)Asa1 << 32 | Asa0;
+        state[21] = (uint64_t)Ase1 << 32 | Ase0;
+        state[22] = (uint64_t)Asi1 << 32 | Asi0;
+        state[23] = (uint64_t)Aso1 << 32 | Aso0;
+        state[24] = (uint64_t)Asu1 << 32 | Asu0;
+}
+#else
+#define LANE_IN(x) (x)
+#define LANE_OUT(x) (x)
+#define XOR_BYTE(s, i, b) ((s)[(i)/8] ^= (uint64_t)(b) << 8*((i)%8))
+#define EXTRACT_BYTE(s, i) ((uint8_t)((s)[(i)/8] >> 8*((i)%8)))
+
 /* Keccak round constants */
 static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
   (uint64_t)0x0000000000000001ULL,
@@ -79,7 +718,7 @@ static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
 *
 * Arguments:   - uint64_t *state: pointer to input/output Keccak state
 **************************************************/
-static void KeccakF1600_StatePermute(uint64_t state[25])
+void KeccakF1600_StatePermute(uint64_t state[25])
 {
         int round;
 
@@ -342,6 +981,7 @@ static void KeccakF1600_StatePermute(uint64_t state[25])
         state[23] = Aso;
         state[24] = Asu;
 }
+#endif
 
 /*************************************************
 * Name:        keccak_init
@@ -357,6 +997,59 @@ static void keccak_init(uint64_t s[25])
     s[i] = 0;
 }
 
+/*************************************************
+* Name:        keccak_xor_bytes
+*
+* Description: XOR len bytes into the state starting at byte position pos
+*              of the rate; bytes up to the next lane boundary are handled
+*              one at a time, the rest a whole lane at a time.
+*
+* Arguments:   - uint64_t *s: pointer to Keccak state
+*              - unsigned int pos: byte position in current block
+*              - const uint8_t *in: pointer to input
+*              - unsigned int len: number of bytes; pos+len must not exceed the rate
+**************************************************/
+static void keccak_xor_bytes(uint64_t s[25],
+                             unsigned int pos,
+                             const uint8_t *in,
+                             unsigned int len)
+{
+  unsigned int end = pos+len;
+
+  for(;pos < end && pos%8;pos++)
+    XOR_BYTE(s, pos, *in++);
+  for(;pos+8 <= end;pos+=8,in+=8)
+    s[pos/8] ^= LANE_IN(load64(in));
+  for(;pos < end;pos++)
+    XOR_BYTE(s, pos, *in++);
+}
+
+/*************************************************
+* Name:        keccak_extract_bytes
+*
+* Description: Copy len bytes out of the state starting at byte position
+*              pos of the rate; lane-wise where possible.
+*
+* Arguments:   - uint8_t *out: pointer to output
+*              - const uint64_t *s: pointer to Keccak state
+*              - unsigned int pos: byte position in current block
+*              - unsigned int len: number of bytes; pos+len must not exceed the rate
+**************************************************/
+static void keccak_extract_bytes(uint8_t *out,
+                                 const uint64_t s[25],
+                                 unsigned int pos,
+                                 unsigned int len)
+{
+  unsigned int end = pos+len;
+
+  for(;pos < end && pos%8;pos++)
+    *out++ = EXTRACT_BYTE(s, pos);
+  for(;pos+8 <= end;pos+=8,out+=8)
+    store64(out, LANE_OUT(s[pos/8]));
+  for(;pos < end;pos++)
+    *out++ = EXTRACT_BYTE(s, pos);
+}
+
 /*************************************************
 * Name:        keccak_absorb
 *
@@ -376,20 +1069,17 @@ static unsigned int keccak_absorb(uint64_t s[25],
                                   const uint8_t *in,
                                   size_t inlen)
 {
-  unsigned int i;
-
   while(pos+inlen >= r) {
-    for(i=pos;i<r;i++)
-      s[i/8] ^= (uint64_t)*in++ << 8*(i%8);
+    keccak_xor_bytes(s, pos, in, r-pos);
+    in += r-pos;
     inlen -= r-pos;
     KeccakF1600_StatePermute(s);
     pos = 0;
   }
 
-  for(i=pos;i<pos+inlen;i++)
-    s[i/8] ^= (uint64_t)*in++ << 8*(i%8);
+  keccak_xor_bytes(s, pos, in, inlen);
 
-  return i;
+  return pos+inlen;
 }
 
 /*************************************************
@@ -404,8 +1094,8 @@ static unsigned int keccak_absorb(uint64_t s[25],
 **************************************************/
 static void keccak_finalize(uint64_t s[25], unsigned int pos, unsigned int r, uint8_t p)
 {
-  s[pos/8] ^= (uint64_t)p << 8*(pos%8);
-  s[r/8-1] ^= 1ULL << 63;
+  XOR_BYTE(s, pos, p);
+  XOR_BYTE(s, r-1, 0x80);
 }
 
 /*************************************************
@@ -429,17 +1119,18 @@ static unsigned int keccak_squeeze(uint8_t *out,
                                    unsigned int pos,
                                    unsigned int r)
 {
-  unsigned int i;
+  unsigned int n;
 
   while(outlen) {
     if(pos == r) {
       KeccakF1600_StatePermute(s);
       pos = 0;
     }
-    for(i=pos;i < r && i < pos+outlen; i++)
-      *out++ = s[i/8] >> 8*(i%8);
-    outlen -= i-pos;
-    pos = i;
+    n = (r-pos < outlen) ? r-pos : outlen;
+    keccak_extract_bytes(out, s, pos, n);
+    out += n;
+    outlen -= n;
+    pos += n;
   }
 
   return pos;
@@ -458,7 +1149,7 @@ static unsigned int keccak_squeeze(uint8_t *out,
 *              - size_t inlen: length of input in bytes
 *              - uint8_t p: domain-separation byte for different Keccak-derived functions
 **************************************************/
-static void keccak_absorb_once(uint64_t s[25],
+static inline void keccak_absorb_once(uint64_t s[25],
                                unsigned int r,
                                const uint8_t *in,
                                size_t inlen,
@@ -471,17 +1162,16 @@ static void keccak_absorb_once(uint64_t s[25],
 
   while(inlen >= r) {
     for(i=0;i<r/8;i++)
-      s[i] ^= load64(in+8*i);
+      s[i] ^= LANE_IN(load64(in+8*i));
     in += r;
     inlen -= r;
     KeccakF1600_StatePermute(s);
   }
 
-  for(i=0;i<inlen;i++)
-    s[i/8] ^= (uint64_t)in[i] << 8*(i%8);
+  keccak_xor_bytes(s, 0, in, inlen);
 
-  s[i/8] ^= (uint64_t)p << 8*(i%8);
-  s[(r-1)/8] ^= 1ULL << 63;
+  XOR_BYTE(s, inlen, p);
+  XOR_BYTE(s, r-1, 0x80);
 }
 
 /*************************************************
@@ -507,12 +1197,36 @@ static void keccak_squeezeblocks(uint8_t *out,
   while(nblocks) {
     KeccakF1600_StatePermute(s);
     for(i=0;i<r/8;i++)
-      store64(out+8*i, s[i]);
+      store64(out+8*i, LANE_OUT(s[i]));
     out += r;
     nblocks -= 1;
   }
 }
 
+/*************************************************
+* Name:        keccak_squeezelane
+*
+* Description: Squeeze the next 8 output bytes, read straight from the
+*              state lane. Permutes when the current block is used up.
+*              Assumes the squeezed length so far is a multiple of 8.
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+*              - unsigned int *pos: pointer to number of bytes in current
+*                                   block already squeezed
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*
+* Returns the 8 bytes as a little-endian 64-bit integer
+**************************************************/
+static uint64_t keccak_squeezelane(uint64_t s[25], unsigned int *pos, unsigned int r)
+{
+  if(*pos == r) {
+    KeccakF1600_StatePermute(s);
+    *pos = 0;
+  }
+  *pos += 8;
+  return LANE_OUT(s[*pos/8-1]);
+}
+
 /*************************************************
 * Name:        shake128_init
 *
@@ -600,6 +1314,23 @@ void shake128_squeezeblocks(uint8_t *out, size_t nblocks, keccak_state *state)
   keccak_squeezeblocks(out, nblocks, state->s, SHAKE128_RATE);
 }
 
+/*************************************************
+* Name:        shake128_squeezelane
+*
+* Description: Squeeze the next 8 bytes of SHAKE128 output as one lane;
+*              lets samplers consume the output without a byte buffer.
+*              Can be called multiple times to keep squeezing; must not
+*              be mixed with squeezes of a length that is not a multiple of 8.
+*
+* Arguments:   - keccak_state *s: pointer to input/output Keccak state
+*
+* Returns the 8 bytes as a little-endian 64-bit integer
+**************************************************/
+uint64_t shake128_squeezelane(keccak_state *state)
+{
+  return keccak_squeezelane(state->s, &state->pos, SHAKE128_RATE);
+}
+
 /*************************************************
 * Name:        shake256_init
 *
@@ -687,6 +1418,21 @@ void shake256_squeezeblocks(uint8_t *out, size_t nblocks, keccak_state *state)
   keccak_squeezeblocks(out, nblocks, state->s, SHAKE256_RATE);
 }
 
+/*************************************************
+* Name:        shake256_squeezelane
+*
+* Description: Squeeze the next 8 bytes of SHAKE256 output as one lane;
+*              see shake128_squeezelane
+*
+* Arguments:   - keccak_state *s: pointer to input/output Keccak state
+*
+* Returns the 8 bytes as a little-endian 64-bit integer
+**************************************************/
+uint64_t shake256_squeezelane(keccak_state *state)
+{
+  return keccak_squeezelane(state->s, &state->pos, SHAKE256_RATE);
+}
+
 /*************************************************
 * Name:        shake128
 *
@@ -750,7 +1496,7 @@ void sha3_256(uint8_t h[32], const uint8_t *in, size_t inlen)
   keccak_absorb_once(s, SHA3_256_RATE, in, inlen, 0x06);
   KeccakF1600_StatePermute(s);
   for(i=0;i<4;i++)
-    store64(h+8*i,s[i]);
+    store64(h+8*i,LANE_OUT(s[i]));
 }
 
 /*************************************************
@@ -770,5 +1516,52 @@ void sha3_512(uint8_t h[64], const uint8_t *in, size_t inlen)
   keccak_absorb_once(s, SHA3_512_RATE, in, inlen, 0x06);
   KeccakF1600_StatePermute(s);
   for(i=0;i<8;i++)
-    store64(h+8*i,s[i]);
+    store64(h+8*i,LANE_OUT(s[i]));
+}
+
+/*************************************************
+* Name:        sha3_256_32
+*
+* Description: SHA3-256 of a 32-byte input; the message and padding fill
+*              fixed lanes of a single block
+*
+* Arguments:   - uint8_t *h: pointer to output (32 bytes)
+*              - const uint8_t *in: pointer to input (32 bytes)
+**************************************************/
+void sha3_256_32(uint8_t h[32], const uint8_t in[32])
+{
+  unsigned int i;
+  uint64_t s[25] = {0};
+
+  for(i=0;i<4;i++)
+    s[i] = LANE_IN(load64(in+8*i));
+  s[4] = LANE_IN(0x06);
+  s[SHA3_256_RATE/8-1] = LANE_IN(1ULL << 63);
+
+  KeccakF1600_StatePermute(s);
+  for(i=0;i<4;i++)
+    store64(h+8*i,LANE_OUT(s[i]));
+}
+
+/*************************************************
+* Name:        sha3_512_64
+*
+* Description: SHA3-512 of a 64-byte input; the message and padding fill
+*              fixed lanes of a single block
+*
+* Arguments:   - uint8_t *h: pointer to output (64 bytes)
+*              - const uint8_t *in: pointer to input (64 bytes)
+**************************************************/
+void sha3_512_64(uint8_t h[64], const uint8_t in[64])
+{
+  unsigned int i;
+  uint64_t s[25] = {0};
+
+  for(i=0;i<8;i++)
+    s[i] = LANE_IN(load64(in+8*i));
+  s[SHA3_512_RATE/8-1] = LANE_IN(0x06 | 1ULL << 63);
+
+  KeccakF1600_StatePermute(s);
+  for(i=0;i<8;i++)
+    store64(h+8*i,LANE_OUT(s[i]));
 }
@@ -11,11 +11,26 @@
 
 #define FIPS202_NAMESPACE(s) pqcrystals_kyber_fips202_ref_##s
 
+/*
+ * With KECCAK_INTERLEAVED=1 every lane of s is stored bit-interleaved
+ * (even bits in the low, odd bits in the high 32-bit word); see fips202.c.
+ * Code that touches s directly must go through keccak_lane_in/_out.
+ */
 typedef struct {
   uint64_t s[25];
   unsigned int pos;
 } keccak_state;
 
+#define KeccakF1600_StatePermute FIPS202_NAMESPACE(KeccakF1600_StatePermute)
+void KeccakF1600_StatePermute(uint64_t state[25]);
+
+#if (KECCAK_INTERLEAVED == 1)
+#define keccak_lane_in FIPS202_NAMESPACE(keccak_lane_in)
+uint64_t keccak_lane_in(uint64_t x);
+#define keccak_lane_out FIPS202_NAMESPACE(keccak_lane_out)
+uint64_t keccak_lane_out(uint64_t x);
+#endif
+
 #define shake128_init FIPS202_NAMESPACE(shake128_init)
 void shake128_init(keccak_state *state);
 #define shake128_absorb FIPS202_NAMESPACE(shake128_absorb)
@@ -28,6 +43,8 @@ void shake128_squeeze(uint8_t *out, size_t outlen, keccak_state *state);
 void shake128_absorb_once(keccak_state *state, const uint8_t *in, size_t inlen);
 #define shake128_squeezeblocks FIPS202_NAMESPACE(shake128_squeezeblocks)
 void shake128_squeezeblocks(uint8_t *out, size_t nblocks, keccak_state *state);
+#define shake128_squeezelane FIPS202_NAMESPACE(shake128_squeezelane)
+uint64_t shake128_squeezelane(keccak_state *state);
 
 #define shake256_init FIPS202_NAMESPACE(shake256_init)
 void shake256_init(keccak_state *state);
@@ -41,6 +58,8 @@ void shake256_squeeze(uint8_t *out, size_t outlen, keccak_state *state);
 void shake256_absorb_once(keccak_state *state, const uint8_t *in, size_t inlen);
 #define shake256_squeezeblocks FIPS202_NAMESPACE(shake256_squeezeblocks)
 void shake256_squeezeblocks(uint8_t *out, size_t nblocks,  keccak_state *state);
+#define shake256_squeezelane FIPS202_NAMESPACE(shake256_squeezelane)
+uint64_t shake256_squeezelane(keccak_state *state);
 
 #define shake128 FIPS202_NAMESPACE(shake128)
 void shake128(uint8_t *out, size_t outlen, const uint8_t *in, size_t inlen);
@@ -51,4 +70,10 @@ void sha3_256(uint8_t h[32], const uint8_t *in, size_t inlen);
 #define sha3_512 FIPS202_NAMESPACE(sha3_512)
 void sha3_512(uint8_t h[64], const uint8_t *in, size_t inlen);
 
+/* Fixed-length SHA3 for the KEM hashes */
+#define sha3_256_32 FIPS202_NAMESPACE(sha3_256_32)
+void sha3_256_32(uint8_t h[32], const uint8_t in[32]);
+#define sha3_512_64 FIPS202_NAMESPACE(sha3_512_64)
+void sha3_512_64(uint8_t h[64], const uint8_t in[64]);
+
 #endif
@@ -0,0 +1,689 @@
+/* 4-way parallel Keccak-f[1600] and the SHAKE functions built on it.
+ * The AVX2 permutation is a lane-wise vectorization of the scalar
+ * permutation in fips202.c; hosts without AVX2 (and all non-x86 targets)
+ * fall back to running the scalar permutation on each instance in turn.
+ * Output is bit-identical to four calls of the scalar functions.
+ * With KECCAK_INTERLEAVED=1 the scalar permutation works on bit-interleaved
+ * lanes, so the states here are kept in that format as well and the AVX2
+ * kernel, which expects plain lanes, is not built. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cpufeatures.h"
+#include "fips202.h"
+#include "fips202x4.h"
+
+#if (KECCAK_INTERLEAVED == 1)
+#define KECCAKX4_AVX2 0
+#define LANE_IN(x) keccak_lane_in(x)
+#define LANE_OUT(x) keccak_lane_out(x)
+#else
+#define KECCAKX4_AVX2 KYBER_X86_64
+#define LANE_IN(x) (x)
+#define LANE_OUT(x) (x)
+#endif
+
+#if KECCAKX4_AVX2
+#include <immintrin.h>
+#endif
+
+#define NROUNDS 24
+
+/*************************************************
+* Name:        load64
+*
+* Description: Load 8 bytes into uint64_t in little-endian order
+*
+* Arguments:   - const uint8_t *x: pointer to input byte array
+*
+* Returns the loaded 64-bit unsigned integer
+**************************************************/
+static uint64_t load64(const uint8_t x[8]) {
+  unsigned int i;
+  uint64_t r = 0;
+
+  for(i=0;i<8;i++)
+    r |= (uint64_t)x[i] << 8*i;
+
+  return r;
+}
+
+/*************************************************
+* Name:        store64
+*
+* Description: Store a 64-bit integer to array of 8 bytes in little-endian order
+*
+* Arguments:   - uint8_t *x: pointer to the output byte array (allocated)
+*              - uint64_t u: input 64-bit unsigned integer
+**************************************************/
+static void store64(uint8_t x[8], uint64_t u) {
+  unsigned int i;
+
+  for(i=0;i<8;i++)
+    x[i] = u >> 8*i;
+}
+
+#if KECCAKX4_AVX2
+/* Keccak round constants */
+static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
+  (uint64_t)0x0000000000000001ULL,
+  (uint64_t)0x0000000000008082ULL,
+  (uint64_t)0x800000000000808aULL,
+  (uint64_t)0x8000000080008000ULL,
+  (uint64_t)0x000000000000808bULL,
+  (uint64_t)0x0000000080000001ULL,
+  (uint64_t)0x8000000080008081ULL,
+  (uint64_t)0x8000000000008009ULL,
+  (uint64_t)0x000000000000008aULL,
+  (uint64_t)0x0000000000000088ULL,
+  (uint64_t)0x0000000080008009ULL,
+  (uint64_t)0x000000008000000aULL,
+  (uint64_t)0x000000008000808bULL,
+  (uint64_t)0x800000000000008bULL,
+  (uint64_t)0x8000000000008089ULL,
+  (uint64_t)0x8000000000008003ULL,
+  (uint64_t)0x8000000000008002ULL,
+  (uint64_t)0x8000000000000080ULL,
+  (uint64_t)0x000000000000800aULL,
+  (uint64_t)0x800000008000000aULL,
+  (uint64_t)0x8000000080008081ULL,
+  (uint64_t)0x8000000000008080ULL,
+  (uint64_t)0x0000000080000001ULL,
+  (uint64_t)0x8000000080008008ULL
+};
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define XOR5(a, b, c, d, e) XOR(XOR(XOR(a, b), XOR(c, d)), e)
+#define ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define ROL(a, offset) _mm256_or_si256(_mm256_slli_epi64(a, offset), \
+                                       _mm256_srli_epi64(a, 64-(offset)))
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute4x_avx2
+*
+* Description: Four Keccak F1600 permutations in parallel using AVX2;
+*              instance j lives in 64-bit element j of every vector
+*
+* Arguments:   - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+TARGET_AVX2
+static void KeccakF1600_StatePermute4x_avx2(keccakx4_state *state)
+{
+        int round;
+
+        __m256i Aba, Abe, Abi, Abo, Abu;
+        __m256i Aga, Age, Agi, Ago, Agu;
+        __m256i Aka, Ake, Aki, Ako, Aku;
+        __m256i Ama, Ame, Ami, Amo, Amu;
+        __m256i Asa, Ase, Asi, Aso, Asu;
+        __m256i BCa, BCe, BCi, BCo, BCu;
+        __m256i Da, De, Di, Do, Du;
+        __m256i Eba, Ebe, Ebi, Ebo, Ebu;
+        __m256i Ega, Ege, Egi, Ego, Egu;
+        __m256i Eka, Eke, Eki, Eko, Eku;
+        __m256i Ema, Eme, Emi, Emo, Emu;
+        __m256i Esa, Ese, Esi, Eso, Esu;
+
+        //copyFromState(A, state)
+        Aba = _mm256_loadu_si256((const __m256i *)state->s[ 0]);
+        Abe = _mm256_loadu_si256((const __m256i *)state->s[ 1]);
+        Abi = _mm256_loadu_si256((const __m256i *)state->s[ 2]);
+        Abo = _mm256_loadu_si256((const __m256i *)state->s[ 3]);
+        Abu = _mm256_loadu_si256((const __m256i *)state->s[ 4]);
+        Aga = _mm256_loadu_si256((const __m256i *)state->s[ 5]);
+        Age = _mm256_loadu_si256((const __m256i *)state->s[ 6]);
+        Agi = _mm256_loadu_si256((const __m256i *)state->s[ 7]);
+        Ago = _mm256_loadu_si256((const __m256i *)state->s[ 8]);
+        Agu = _mm256_loadu_si256((const __m256i *)state->s[ 9]);
+        Aka = _mm256_loadu_si256((const __m256i *)state->s[10]);
+        Ake = _mm256_loadu_si256((const __m256i *)state->s[11]);
+        Aki = _mm256_loadu_si256((const __m256i *)state->s[12]);
+        Ako = _mm256_loadu_si256((const __m256i *)state->s[13]);
+        Aku = _mm256_loadu_si256((const __m256i *)state->s[14]);
+        Ama = _mm256_loadu_si256((const __m256i *)state->s[15]);
+        Ame = _mm256_loadu_si256((const __m256i *)state->s[16]);
+        Ami = _mm256_loadu_si256((const __m256i *)state->s[17]);
+        Amo = _mm256_loadu_si256((const __m256i *)state->s[18]);
+        Amu = _mm256_loadu_si256((const __m256i *)state->s[19]);
+        Asa = _mm256_loadu_si256((const __m256i *)state->s[20]);
+        Ase = _mm256_loadu_si256((const __m256i *)state->s[21]);
+        Asi = _mm256_loadu_si256((const __m256i *)state->s[22]);
+        Aso = _mm256_loadu_si256((const __m256i *)state->s[23]);
+        Asu = _mm256_loadu_si256((const __m256i *)state->s[24]);
+
+        for(round = 0; round < NROUNDS; round += 2) {
+            //    prepareTheta
+            BCa = XOR5(Aba, Aga, Aka, Ama, Asa);
+            BCe = XOR5(Abe, Age, Ake, Ame, Ase);
+            BCi = XOR5(Abi, Agi, Aki, Ami, Asi);
+            BCo = XOR5(Abo, Ago, Ako, Amo, Aso);
+            BCu = XOR5(Abu, Agu, Aku, Amu, Asu);
+
+            //thetaRhoPiChiIotaPrepareTheta(round, A, E)
+            Da = XOR(BCu, ROL(BCe, 1));
+            De = XOR(BCa, ROL(BCi, 1));
+            Di = XOR(BCe, ROL(BCo, 1));
+            Do = XOR(BCi, ROL(BCu, 1));
+            Du = XOR(BCo, ROL(BCa, 1));
+
+            Aba = XOR(Aba, Da);
+            BCa = Aba;
+            Age = XOR(Age, De);
+            BCe = ROL(Age, 44);
+            Aki = XOR(Aki, Di);
+            BCi = ROL(Aki, 43);
+            Amo = XOR(Amo, Do);
+            BCo = ROL(Amo, 21);
+            Asu = XOR(Asu, Du);
+            BCu = ROL(Asu, 14);
+            Eba = XOR(BCa, ANDNOT(BCe, BCi));
+            Eba = XOR(Eba, _mm256_set1_epi64x(KeccakF_RoundConstants[round]));
+            Ebe = XOR(BCe, ANDNOT(BCi, BCo));
+            Ebi = XOR(BCi, ANDNOT(BCo, BCu));
+            Ebo = XOR(BCo, ANDNOT(BCu, BCa));
+            Ebu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Abo = XOR(Abo, Do);
+            BCa = ROL(Abo, 28);
+            Agu = XOR(Agu, Du);
+            BCe = ROL(Agu, 20);
+            Aka = XOR(Aka, Da);
+            BCi = ROL(Aka, 3);
+            Ame = XOR(Ame, De);
+            BCo = ROL(Ame, 45);
+            Asi = XOR(Asi, Di);
+            BCu = ROL(Asi, 61);
+            Ega = XOR(BCa, ANDNOT(BCe, BCi));
+            Ege = XOR(BCe, ANDNOT(BCi, BCo));
+            Egi = XOR(BCi, ANDNOT(BCo, BCu));
+            Ego = XOR(BCo, ANDNOT(BCu, BCa));
+            Egu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Abe = XOR(Abe, De);
+            BCa = ROL(Abe, 1);
+            Agi = XOR(Agi, Di);
+            BCe = ROL(Agi, 6);
+            Ako = XOR(Ako, Do);
+            BCi = ROL(Ako, 25);
+            Amu = XOR(Amu, Du);
+            BCo = ROL(Amu, 8);
+            Asa = XOR(Asa, Da);
+            BCu = ROL(Asa, 18);
+            Eka = XOR(BCa, ANDNOT(BCe, BCi));
+            Eke = XOR(BCe, ANDNOT(BCi, BCo));
+            Eki = XOR(BCi, ANDNOT(BCo, BCu));
+            Eko = XOR(BCo, ANDNOT(BCu, BCa));
+            Eku = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Abu = XOR(Abu, Du);
+            BCa = ROL(Abu, 27);
+            Aga = XOR(Aga, Da);
+            BCe = ROL(Aga, 36);
+            Ake = XOR(Ake, De);
+            BCi = ROL(Ake, 10);
+            Ami = XOR(Ami, Di);
+            BCo = ROL(Ami, 15);
+            Aso = XOR(Aso, Do);
+            BCu = ROL(Aso, 56);
+            Ema = XOR(BCa, ANDNOT(BCe, BCi));
+            Eme = XOR(BCe, ANDNOT(BCi, BCo));
+            Emi = XOR(BCi, ANDNOT(BCo, BCu));
+            Emo = XOR(BCo, ANDNOT(BCu, BCa));
+            Emu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Abi = XOR(Abi, Di);
+            BCa = ROL(Abi, 62);
+            Ago = XOR(Ago, Do);
+            BCe = ROL(Ago, 55);
+            Aku = XOR(Aku, Du);
+            BCi = ROL(Aku, 39);
+            Ama = XOR(Ama, Da);
+            BCo = ROL(Ama, 41);
+            Ase = XOR(Ase, De);
+            BCu = ROL(Ase, 2);
+            Esa = XOR(BCa, ANDNOT(BCe, BCi));
+            Ese = XOR(BCe, ANDNOT(BCi, BCo));
+            Esi = XOR(BCi, ANDNOT(BCo, BCu));
+            Eso = XOR(BCo, ANDNOT(BCu, BCa));
+            Esu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            //    prepareTheta
+            BCa = XOR5(Eba, Ega, Eka, Ema, Esa);
+            BCe = XOR5(Ebe, Ege, Eke, Eme, Ese);
+            BCi = XOR5(Ebi, Egi, Eki, Emi, Esi);
+            BCo = XOR5(Ebo, Ego, Eko, Emo, Eso);
+            BCu = XOR5(Ebu, Egu, Eku, Emu, Esu);
+
+            //thetaRhoPiChiIotaPrepareTheta(round+1, E, A)
+            Da = XOR(BCu, ROL(BCe, 1));
+            De = XOR(BCa, ROL(BCi, 1));
+            Di = XOR(BCe, ROL(BCo, 1));
+            Do = XOR(BCi, ROL(BCu, 1));
+            Du = XOR(BCo, ROL(BCa, 1));
+
+            Eba = XOR(Eba, Da);
+            BCa = Eba;
+            Ege = XOR(Ege, De);
+            BCe = ROL(Ege, 44);
+            Eki = XOR(Eki, Di);
+            BCi = ROL(Eki, 43);
+            Emo = XOR(Emo, Do);
+            BCo = ROL(Emo, 21);
+            Esu = XOR(Esu, Du);
+            BCu = ROL(Esu, 14);
+            Aba = XOR(BCa, ANDNOT(BCe, BCi));
+            Aba = XOR(Aba, _mm256_set1_epi64x(KeccakF_RoundConstants[round+1]));
+            Abe = XOR(BCe, ANDNOT(BCi, BCo));
+            Abi = XOR(BCi, ANDNOT(BCo, BCu));
+            Abo = XOR(BCo, ANDNOT(BCu, BCa));
+            Abu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Ebo = XOR(Ebo, Do);
+            BCa = ROL(Ebo, 28);
+            Egu = XOR(Egu, Du);
+            BCe = ROL(Egu, 20);
+            Eka = XOR(Eka, Da);
+            BCi = ROL(Eka, 3);
+            Eme = XOR(Eme, De);
+            BCo = ROL(Eme, 45);
+            Esi = XOR(Esi, Di);
+            BCu = ROL(Esi, 61);
+            Aga = XOR(BCa, ANDNOT(BCe, BCi));
+            Age = XOR(BCe, ANDNOT(BCi, BCo));
+            Agi = XOR(BCi, ANDNOT(BCo, BCu));
+            Ago = XOR(BCo, ANDNOT(BCu, BCa));
+            Agu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Ebe = XOR(Ebe, De);
+            BCa = ROL(Ebe, 1);
+            Egi = XOR(Egi, Di);
+            BCe = ROL(Egi, 6);
+            Eko = XOR(Eko, Do);
+            BCi = ROL(Eko, 25);
+            Emu = XOR(Emu, Du);
+            BCo = ROL(Emu, 8);
+            Esa = XOR(Esa, Da);
+            BCu = ROL(Esa, 18);
+            Aka = XOR(BCa, ANDNOT(BCe, BCi));
+            Ake = XOR(BCe, ANDNOT(BCi, BCo));
+            Aki = XOR(BCi, ANDNOT(BCo, BCu));
+            Ako = XOR(BCo, ANDNOT(BCu, BCa));
+            Aku = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Ebu = XOR(Ebu, Du);
+            BCa = ROL(Ebu, 27);
+            Ega = XOR(Ega, Da);
+            BCe = ROL(Ega, 36);
+            Eke = XOR(Eke, De);
+            BCi = ROL(Eke, 10);
+            Emi = XOR(Emi, Di);
+            BCo = ROL(Emi, 15);
+            Eso = XOR(Eso, Do);
+            BCu = ROL(Eso, 56);
+            Ama = XOR(BCa, ANDNOT(BCe, BCi));
+            Ame = XOR(BCe, ANDNOT(BCi, BCo));
+            Ami = XOR(BCi, ANDNOT(BCo, BCu));
+            Amo = XOR(BCo, ANDNOT(BCu, BCa));
+            Amu = XOR(BCu, ANDNOT(BCa, BCe));
+
+            Ebi = XOR(Ebi, Di);
+            BCa = ROL(Ebi, 62);
+            Ego = XOR(Ego, Do);
+            BCe = ROL(Ego, 55);
+            Eku = XOR(Eku, Du);
+            BCi = ROL(Eku, 39);
+            Ema = XOR(Ema, Da);
+            BCo = ROL(Ema, 41);
+            Ese = XOR(Ese, De);
+            BCu = ROL(Ese, 2);
+            Asa = XOR(BCa, ANDNOT(BCe, BCi));
+            Ase = XOR(BCe, ANDNOT(BCi, BCo));
+            Asi = XOR(BCi, ANDNOT(BCo, BCu));
+            Aso = XOR(BCo, ANDNOT(BCu, BCa));
+            Asu = XOR(BCu, ANDNOT(BCa, BCe));
+        }
+
+
+        //copyToState(state, A)
+        _mm256_storeu_si256((__m256i *)state->s[ 0], Aba);
+        _mm256_storeu_si256((__m256i *)state->s[ 1], Abe);
+        _mm256_storeu_si256((__m256i *)state->s[ 2], Abi);
+        _mm256_storeu_si256((__m256i *)state->s[ 3], Abo);
+        _mm256_storeu_si256((__m256i *)state->s[ 4], Abu);
+        _mm256_storeu_si256((__m256i *)state->s[ 5], Aga);
+        _mm256_storeu_si256((__m256i *)state->s[ 6], Age);
+        _mm256_storeu_si256((__m256i *)state->s[ 7], Agi);
+        _mm256_storeu_si256((__m256i *)state->s[ 8], Ago);
+        _mm256_storeu_si256((__m256i *)state->s[ 9], Agu);
+        _mm256_storeu_si256((__m256i *)state->s[10], Aka);
+        _mm256_storeu_si256((__m256i *)state->s[11], Ake);
+        _mm256_storeu_si256((__m256i *)state->s[12], Aki);
+        _mm256_storeu_si256((__m256i *)state->s[13], Ako);
+        _mm256_storeu_si256((__m256i *)state->s[14], Aku);
+        _mm256_storeu_si256((__m256i *)state->s[15], Ama);
+        _mm256_storeu_si256((__m256i *)state->s[16], Ame);
+        _mm256_storeu_si256((__m256i *)state->s[17], Ami);
+        _mm256_storeu_si256((__m256i *)state->s[18], Amo);
+        _mm256_storeu_si256((__m256i *)state->s[19], Amu);
+        _mm256_storeu_si256((__m256i *)state->s[20], Asa);
+        _mm256_storeu_si256((__m256i *)state->s[21], Ase);
+        _mm256_storeu_si256((__m256i *)state->s[22], Asi);
+        _mm256_storeu_si256((__m256i *)state->s[23], Aso);
+        _mm256_storeu_si256((__m256i *)state->s[24], Asu);
+}
+#endif
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute4x_ref
+*
+* Description: Portable fallback; applies the scalar Keccak F1600
+*              permutation to each of the four states in turn
+*
+* Arguments:   - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+static void KeccakF1600_StatePermute4x_ref(keccakx4_state *state)
+{
+  unsigned int i, j;
+  uint64_t t[25];
+
+  for(j=0;j<4;j++) {
+    for(i=0;i<25;i++)
+      t[i] = state->s[i][j];
+    KeccakF1600_StatePermute(t);
+    for(i=0;i<25;i++)
+      state->s[i][j] = t[i];
+  }
+}
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute4x
+*
+* Description: Four Keccak F1600 permutations; uses AVX2 when the CPU
+*              supports it and the portable code otherwise
+*
+* Arguments:   - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+void KeccakF1600_StatePermute4x(keccakx4_state *state)
+{
+#if KECCAKX4_AVX2
+  if(cpu_has_avx2()) {
+    KeccakF1600_StatePermute4x_avx2(state);
+    return;
+  }
+#endif
+  KeccakF1600_StatePermute4x_ref(state);
+}
+
+/*************************************************
+* Name:        keccakx4_absorb_once
+*
+* Description: Absorb step of four Keccak instances on equal-length inputs;
+*              non-incremental, starts by zeroeing the states.
+*
+* Arguments:   - keccakx4_state *state: pointer to (uninitialized) output Keccak states
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*              - const uint8_t *in0..in3: pointers to the four inputs
+*              - size_t inlen: length of each input in bytes
+*              - uint8_t p: domain-separation byte for different Keccak-derived functions
+**************************************************/
+static void keccakx4_absorb_once(keccakx4_state *state,
+                                 unsigned int r,
+                                 const uint8_t *in0,
+                                 const uint8_t *in1,
+                                 const uint8_t *in2,
+                                 const uint8_t *in3,
+                                 size_t inlen,
+                                 uint8_t p)
+{
+  unsigned int i, j;
+  size_t pos = 0;
+  const uint8_t *in[4];
+
+  in[0] = in0;
+  in[1] = in1;
+  in[2] = in2;
+  in[3] = in3;
+
+  for(i=0;i<25;i++)
+    for(j=0;j<4;j++)
+      state->s[i][j] = 0;
+
+  while(inlen >= r) {
+    for(i=0;i<r/8;i++)
+      for(j=0;j<4;j++)
+        state->s[i][j] ^= LANE_IN(load64(in[j]+pos+8*i));
+    pos += r;
+    inlen -= r;
+    KeccakF1600_StatePermute4x(state);
+  }
+
+  for(i=0;i<inlen;i++)
+    for(j=0;j<4;j++)
+      state->s[i/8][j] ^= LANE_IN((uint64_t)in[j][pos+i] << 8*(i%8));
+
+  for(j=0;j<4;j++) {
+    state->s[i/8][j] ^= LANE_IN((uint64_t)p << 8*(i%8));
+    state->s[(r-1)/8][j] ^= LANE_IN(1ULL << 63);
+  }
+  state->pos = r;
+}
+
+/*************************************************
+* Name:        keccakx4_squeezeblocks
+*
+* Description: Squeeze step of four Keccak instances. Squeezes full blocks
+*              of r bytes each from every instance. Can be called multiple
+*              times to keep squeezing.
+*
+* Arguments:   - uint8_t *out0..out3: pointers to output blocks
+*              - size_t nblocks: number of blocks to be squeezed per instance
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+static void keccakx4_squeezeblocks(uint8_t *out0,
+                                   uint8_t *out1,
+                                   uint8_t *out2,
+                                   uint8_t *out3,
+                                   size_t nblocks,
+                                   unsigned int r,
+                                   keccakx4_state *state)
+{
+  unsigned int i;
+
+  while(nblocks) {
+    KeccakF1600_StatePermute4x(state);
+    for(i=0;i<r/8;i++) {
+      store64(out0+8*i, LANE_OUT(state->s[i][0]));
+      store64(out1+8*i, LANE_OUT(state->s[i][1]));
+      store64(out2+8*i, LANE_OUT(state->s[i][2]));
+      store64(out3+8*i, LANE_OUT(state->s[i][3]));
+    }
+    out0 += r;
+    out1 += r;
+    out2 += r;
+    out3 += r;
+    nblocks -= 1;
+  }
+}
+
+/*************************************************
+* Name:        keccakx4_squeezelane
+*
+* Description: Squeeze the next 8 output bytes of each of the four
+*              instances, read straight from the state lanes. Permutes
+*              when the current block is used up.
+*
+* Arguments:   - uint64_t *lane: the four outputs as little-endian 64-bit integers
+*              - unsigned int r: rate in bytes (e.g., 168 for SHAKE128)
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+static void keccakx4_squeezelane(uint64_t lane[4], unsigned int r, keccakx4_state *state)
+{
+  unsigned int j;
+
+  if(state->pos == r) {
+    KeccakF1600_StatePermute4x(state);
+    state->pos = 0;
+  }
+  for(j=0;j<4;j++)
+    lane[j] = LANE_OUT(state->s[state->pos/8][j]);
+  state->pos += 8;
+}
+
+/*************************************************
+* Name:        shake128x4_absorb_once
+*
+* Description: Initialize, absorb into and finalize four SHAKE128 XOFs;
+*              non-incremental.
+*
+* Arguments:   - keccakx4_state *state: pointer to (uninitialized) output Keccak states
+*              - const uint8_t *in0..in3: pointers to the four inputs
+*              - size_t inlen: length of each input in bytes
+**************************************************/
+void shake128x4_absorb_once(keccakx4_state *state,
+                            const uint8_t *in0,
+                            const uint8_t *in1,
+                            const uint8_t *in2,
+                            const uint8_t *in3,
+                            size_t inlen)
+{
+  keccakx4_absorb_once(state, SHAKE128_RATE, in0, in1, in2, in3, inlen, 0x1F);
+}
+
+/*************************************************
+* Name:        shake128x4_squeezeblocks
+*
+* Description: Squeeze step of four SHAKE128 XOFs. Squeezes full blocks of
+*              SHAKE128_RATE bytes from each instance. Can be called multiple
+*              times to keep squeezing.
+*
+* Arguments:   - uint8_t *out0..out3: pointers to output blocks
+*              - size_t nblocks: number of blocks to be squeezed per instance
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+void shake128x4_squeezeblocks(uint8_t *out0,
+                              uint8_t *out1,
+                              uint8_t *out2,
+                              uint8_t *out3,
+                              size_t nblocks,
+                              keccakx4_state *state)
+{
+  keccakx4_squeezeblocks(out0, out1, out2, out3, nblocks, SHAKE128_RATE, state);
+}
+
+/*************************************************
+* Name:        shake128x4_squeezelane
+*
+* Description: Squeeze the next 8 bytes of each of four SHAKE128 XOFs as
+*              one lane per instance. Can be called multiple times to keep
+*              squeezing; must not be mixed with shake128x4_squeezeblocks.
+*
+* Arguments:   - uint64_t *lane: the four outputs as little-endian 64-bit integers
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+void shake128x4_squeezelane(uint64_t lane[4], keccakx4_state *state)
+{
+  keccakx4_squeezelane(lane, SHAKE128_RATE, state);
+}
+
+/*************************************************
+* Name:        shake256x4_absorb_once
+*
+* Description: Initialize, absorb into and finalize four SHAKE256 XOFs;
+*              non-incremental.
+*
+* Arguments:   - keccakx4_state *state: pointer to (uninitialized) output Keccak states
+*              - const uint8_t *in0..in3: pointers to the four inputs
+*              - size_t inlen: length of each input in bytes
+**************************************************/
+void shake256x4_absorb_once(keccakx4_state *state,
+                            const uint8_t *in0,
+                            const uint8_t *in1,
+                            const uint8_t *in2,
+                            const uint8_t *in3,
+                            size_t inlen)
+{
+  keccakx4_absorb_once(state, SHAKE256_RATE, in0, in1, in2, in3, inlen, 0x1F);
+}
+
+/*************************************************
+* Name:        shake256x4_squeezeblocks
+*
+* Description: Squeeze step of four SHAKE256 XOFs. Squeezes full blocks of
+*              SHAKE256_RATE bytes from each instance. Can be called multiple
+*              times to keep squeezing.
+*
+* Arguments:   - uint8_t *out0..out3: pointers to output blocks
+*              - size_t nblocks: number of blocks to be squeezed per instance
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+void shake256x4_squeezeblocks(uint8_t *out0,
+                              uint8_t *out1,
+                              uint8_t *out2,
+                              uint8_t *out3,
+                              size_t nblocks,
+                              keccakx4_state *state)
+{
+  keccakx4_squeezeblocks(out0, out1, out2, out3, nblocks, SHAKE256_RATE, state);
+}
+
+/*************************************************
+* Name:        shake256x4_squeezelane
+*
+* Description: Squeeze the next 8 bytes of each of four SHAKE256 XOFs as
+*              one lane per instance; see shake128x4_squeezelane
+*
+* Arguments:   - uint64_t *lane: the four outputs as little-endian 64-bit integers
+*              - keccakx4_state *state: pointer to input/output Keccak states
+**************************************************/
+void shake256x4_squeezelane(uint64_t lane[4], keccakx4_state *state)
+{
+  keccakx4_squeezelane(lane, SHAKE256_RATE, state);
+}
+
+/*************************************************
+* Name:        shake256x4
+*
+* Description: Four SHAKE256 XOFs on equal-length inputs with
+*              non-incremental API
+*
+* Arguments:   - uint8_t *out0..out3: pointers to the four outputs
+*              - size_t outlen: requested output length in bytes per instance
+*              - const uint8_t *in0..in3: pointers to the four inputs
+*              - size_t inlen: length of each input in bytes
+**************************************************/
+void shake256x4(uint8_t *out0,
+                uint8_t *out1,
+                uint8_t *out2,
+                uint8_t *out3,
+                size_t outlen,
+                const uint8_t *in0,
+                const uint8_t *in1,
+                const uint8_t *in2,
+                const uint8_t *in3,
+                size_t inlen)
+{
+  unsigned int i;
+  size_t nblocks = outlen/SHAKE256_RATE;
+  uint8_t t[4][SHAKE256_RATE];
+  keccakx4_state state;
+
+  shake256x4_absorb_once(&state, in0, in1, in2, in3, inlen);
+  shake256x4_squeezeblocks(out0, out1, out2, out3, nblocks, &state);
+
+  out0 += nblocks*SHAKE256_RATE;
+  out1 += nblocks*SHAKE256_RATE;
+  out2 += nblocks*SHAKE256_RATE;
+  out3 += nblocks*SHAKE256_RATE;
+  outlen -= nblocks*SHAKE256_RATE;
+
+  if(outlen) {
+    shake256x4_squeezeblocks(t[0], t[1], t[2], t[3], 1, &state);
+    for(i=0;i<outlen;i++) {
+      out0[i] = t[0][i];
+      out1[i] = t[1][i];
+      out2[i] = t[2][i];
+      out3[i] = t[3][i];
+    }
+  }
+}
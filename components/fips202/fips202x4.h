@@ -0,0 +1,72 @@
+#ifndef FIPS202X4_H
+#define FIPS202X4_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fips202.h"
+
+#define FIPS202X4_NAMESPACE(s) pqcrystals_kyber_fips202x4_ref_##s
+
+/*
+ * Four independent Keccak states, lane-interleaved: s[i][j] is lane i of
+ * instance j, so that s[i] maps directly onto one 256-bit vector.
+ */
+typedef struct {
+  uint64_t s[25][4];
+  unsigned int pos;
+} keccakx4_state;
+
+#define KeccakF1600_StatePermute4x FIPS202X4_NAMESPACE(KeccakF1600_StatePermute4x)
+void KeccakF1600_StatePermute4x(keccakx4_state *state);
+
+#define shake128x4_absorb_once FIPS202X4_NAMESPACE(shake128x4_absorb_once)
+void shake128x4_absorb_once(keccakx4_state *state,
+                            const uint8_t *in0,
+                            const uint8_t *in1,
+                            const uint8_t *in2,
+                            const uint8_t *in3,
+                            size_t inlen);
+
+#define shake128x4_squeezeblocks FIPS202X4_NAMESPACE(shake128x4_squeezeblocks)
+void shake128x4_squeezeblocks(uint8_t *out0,
+                              uint8_t *out1,
+                              uint8_t *out2,
+                              uint8_t *out3,
+                              size_t nblocks,
+                              keccakx4_state *state);
+
+#define shake128x4_squeezelane FIPS202X4_NAMESPACE(shake128x4_squeezelane)
+void shake128x4_squeezelane(uint64_t lane[4], keccakx4_state *state);
+
+#define shake256x4_absorb_once FIPS202X4_NAMESPACE(shake256x4_absorb_once)
+void shake256x4_absorb_once(keccakx4_state *state,
+                            const uint8_t *in0,
+                            const uint8_t *in1,
+                            const uint8_t *in2,
+                            const uint8_t *in3,
+                            size_t inlen);
+
+#define shake256x4_squeezeblocks FIPS202X4_NAMESPACE(shake256x4_squeezeblocks)
+void shake256x4_squeezeblocks(uint8_t *out0,
+                              uint8_t *out1,
+                              uint8_t *out2,
+                              uint8_t *out3,
+                              size_t nblocks,
+                              keccakx4_state *state);
+
+#define shake256x4_squeezelane FIPS202X4_NAMESPACE(shake256x4_squeezelane)
+void shake256x4_squeezelane(uint64_t lane[4], keccakx4_state *state);
+
+#define shake256x4 FIPS202X4_NAMESPACE(shake256x4)
+void shake256x4(uint8_t *out0,
+                uint8_t *out1,
+                uint8_t *out2,
+                uint8_t *out3,
+                size_t outlen,
+                const uint8_t *in0,
+                const uint8_t *in1,
+                const uint8_t *in2,
+                const uint8_t *in3,
+                size_t inlen);
+
+#endif
@@ -7,6 +7,10 @@
 #include "ntt.h"
 #include "symmetric.h"
 #include "randombytes.h"
+#include "cpufeatures.h"
+#if KYBER_X86_64
+#include <immintrin.h>
+#endif
 
 #if ((INDCPA_KEYPAIR_DUAL == 1) || (INDCPA_ENC_DUAL == 1) || (INDCPA_DEC_DUAL == 1))
 #include "freertos/FreeRTOS.h"
@@ -17,45 +21,81 @@
 SemaphoreHandle_t Semaphore_core_0 = NULL;
 SemaphoreHandle_t Semaphore_core_1 = NULL;
 SemaphoreHandle_t Semaphore_core_done = NULL;
+
+#if (INDCPA_STACK_WATERMARK == 1)
+uint32_t indcpa_stack_watermark[2] = {UINT32_MAX, UINT32_MAX};
 #endif
 
+/*************************************************
+* Name:        record_stack_watermark
+*
+* Description: With INDCPA_STACK_WATERMARK=1, lowers the stack high-water
+*              mark of the subtasks on the given core to that of the
+*              calling task (uxTaskGetStackHighWaterMark, the least free
+*              stack it has had). Called by each subtask just before it
+*              deletes itself; one slot per core, so the two subtasks of
+*              a call never write the same slot.
+*
+* Arguments:   - unsigned int core: core the calling task is pinned to
+**************************************************/
+static void record_stack_watermark(unsigned int core)
+{
+#if (INDCPA_STACK_WATERMARK == 1)
+  uint32_t free = uxTaskGetStackHighWaterMark(NULL);
+  if(free < indcpa_stack_watermark[core])
+    indcpa_stack_watermark[core] = free;
+#else
+  (void)core;
+#endif
+}
+#endif
+
+#if (INDCPA_STREAM_MATRIX != 1) || (INDCPA_KEYPAIR_DUAL == 1)
 /*************************************************
 * Name:        pack_pk
 *
-* Description: Serialize the public key as concatenation of the
-*              serialized vector of polynomials pk
+* Description: Compute and serialize the public key as concatenation of
+*              the serialized vector of polynomials pk = A*s + e
 *              and the public seed used to generate the matrix A.
+*              pk is serialized as it is computed and never stored
+*              (see polyvec_matvec_add_tobytes)
 *
 * Arguments:   uint8_t *r: pointer to the output serialized public key
-*              polyvec *pk: pointer to the input public-key polyvec
+*              const polyvec *a: rows of the matrix A
+*              const polyvec *skpv: pointer to the secret vector s (NTT domain)
+*              const polyvec_mulcache *skpvc: pointer to the cache of s
+*              const polyvec *e: pointer to the noise vector e (NTT domain)
 *              const uint8_t *seed: pointer to the input public seed
 **************************************************/
 static void pack_pk(uint8_t r[KYBER_INDCPA_PUBLICKEYBYTES],
-                    polyvec *pk,
+                    const polyvec a[KYBER_K],
+                    const polyvec *skpv,
+                    const polyvec_mulcache *skpvc,
+                    const polyvec *e,
                     const uint8_t seed[KYBER_SYMBYTES])
 {
   size_t i;
-  polyvec_tobytes(r, pk);
+  polyvec_matvec_add_tobytes(r, a, skpv, skpvc, e);
   for(i=0;i<KYBER_SYMBYTES;i++)
     r[i+KYBER_POLYVECBYTES] = seed[i];
 }
+#endif
 
 /*************************************************
 * Name:        unpack_pk
 *
-* Description: De-serialize public key from a byte array;
-*              approximate inverse of pack_pk
+* Description: Extract the seed from a serialized public key. The
+*              public-key polynomial vector is left packed in the first
+*              KYBER_POLYVECBYTES bytes and read from there by
+*              polyvec_basemul_acc_packed
 *
-* Arguments:   - polyvec *pk: pointer to output public-key polynomial vector
-*              - uint8_t *seed: pointer to output seed to generate matrix A
+* Arguments:   - uint8_t *seed: pointer to output seed to generate matrix A
 *              - const uint8_t *packedpk: pointer to input serialized public key
 **************************************************/
-static void unpack_pk(polyvec *pk,
-                      uint8_t seed[KYBER_SYMBYTES],
+static void unpack_pk(uint8_t seed[KYBER_SYMBYTES],
                       const uint8_t packedpk[KYBER_INDCPA_PUBLICKEYBYTES])
 {
   size_t i;
-  polyvec_frombytes(pk, packedpk);
   for(i=0;i<KYBER_SYMBYTES;i++)
     seed[i] = packedpk[i+KYBER_POLYVECBYTES];
 }
@@ -73,78 +113,86 @@ static void pack_sk(uint8_t r[KYBER_INDCPA_SECRETKEYBYTES], polyvec *sk)
   polyvec_tobytes(r, sk);
 }
 
-/*************************************************
-* Name:        unpack_sk
-*
-* Description: De-serialize the secret key; inverse of pack_sk
-*
-* Arguments:   - polyvec *sk: pointer to output vector of polynomials (secret key)
-*              - const uint8_t *packedsk: pointer to input serialized secret key
-**************************************************/
-static void unpack_sk(polyvec *sk, const uint8_t packedsk[KYBER_INDCPA_SECRETKEYBYTES])
-{
-  polyvec_frombytes(sk, packedsk);
-}
-
 /*************************************************
 * Name:        pack_ciphertext
 *
-* Description: Serialize the ciphertext as concatenation of the
-*              compressed and serialized vector of polynomials b
-*              and the compressed and serialized polynomial v
+* Description: Finish and serialize the ciphertext as concatenation of
+*              the compressed and serialized vector of polynomials
+*              invntt(b) + ep and the compressed and serialized
+*              polynomial invntt(v) + epp, one strip at a time
+*              (see polyvec_invntt_add_compress)
 *
 * Arguments:   uint8_t *r: pointer to the output serialized ciphertext
-*              poly *pk: pointer to the input vector of polynomials b
+*              polyvec *b: pointer to the input vector of polynomials b
+*                          (NTT domain; overwritten)
+*              const polyvec *ep: pointer to the noise added to b
 *              poly *v: pointer to the input polynomial v
+*                       (NTT domain; overwritten)
+*              const poly *epp: pointer to the noise and message added to v
 **************************************************/
-static void pack_ciphertext(uint8_t r[KYBER_INDCPA_BYTES], polyvec *b, poly *v)
+static void pack_ciphertext(uint8_t r[KYBER_INDCPA_BYTES],
+                            polyvec *b,
+                            const polyvec *ep,
+                            poly *v,
+                            const poly *epp)
 {
-  polyvec_compress(r, b);
-  poly_compress(r+KYBER_POLYVECCOMPRESSEDBYTES, v);
+  polyvec_invntt_add_compress(r, b, ep);
+  poly_invntt_add_compress(r+KYBER_POLYVECCOMPRESSEDBYTES, v, epp);
 }
 
 /*************************************************
 * Name:        unpack_ciphertext
 *
 * Description: De-serialize and decompress ciphertext from a byte array;
-*              approximate inverse of pack_ciphertext
+*              approximate inverse of pack_ciphertext. b is transformed
+*              to the NTT domain as it is decompressed
 *
 * Arguments:   - polyvec *b: pointer to the output vector of polynomials b
+*                            (NTT domain)
 *              - poly *v: pointer to the output polynomial v
 *              - const uint8_t *c: pointer to the input serialized ciphertext
 **************************************************/
 static void unpack_ciphertext(polyvec *b, poly *v, const uint8_t c[KYBER_INDCPA_BYTES])
 {
-  polyvec_decompress(b, c);
+  polyvec_decompress_ntt(b, c);
   poly_decompress(v, c+KYBER_POLYVECCOMPRESSEDBYTES);
 }
 
 /*************************************************
 * Name:        rej_uniform
 *
-* Description: Run rejection sampling on uniform random bytes to generate
-*              uniform random integers mod q
+* Description: Run rejection sampling on 24 uniform random bytes, given
+*              as three little-endian 64-bit lanes of XOF output, to
+*              generate uniform random integers mod q
 *
 * Arguments:   - int16_t *r: pointer to output buffer
 *              - unsigned int len: requested number of 16-bit integers (uniform mod q)
-*              - const uint8_t *buf: pointer to input buffer (assumed to be uniformly random bytes)
-*              - unsigned int buflen: length of input buffer in bytes
+*              - const uint64_t *t: three lanes of XOF output
 *
 * Returns number of sampled 16-bit integers (at most len)
 **************************************************/
 static unsigned int rej_uniform(int16_t *r,
                                 unsigned int len,
-                                const uint8_t *buf,
-                                unsigned int buflen)
+                                const uint64_t t[3])
 {
-  unsigned int ctr, pos;
+  unsigned int ctr, i;
+  uint32_t w[8];
   uint16_t val0, val1;
 
-  ctr = pos = 0;
-  while(ctr < len && pos + 3 <= buflen) {
-    val0 = ((buf[pos+0] >> 0) | ((uint16_t)buf[pos+1] << 8)) & 0xFFF;
-    val1 = ((buf[pos+1] >> 4) | ((uint16_t)buf[pos+2] << 4)) & 0xFFF;
-    pos += 3;
+  /* Eight 24-bit groups, each holding two 12-bit candidates */
+  w[0] = t[0];
+  w[1] = t[0] >> 24;
+  w[2] = t[0] >> 48 | t[1] << 16;
+  w[3] = t[1] >> 8;
+  w[4] = t[1] >> 32;
+  w[5] = t[1] >> 56 | t[2] << 8;
+  w[6] = t[2] >> 16;
+  w[7] = t[2] >> 40;
+
+  ctr = 0;
+  for(i=0;i<8 && ctr < len;i++) {
+    val0 = w[i] & 0xFFF;
+    val1 = (w[i] >> 12) & 0xFFF;
 
     if(val0 < KYBER_Q)
       r[ctr++] = val0;
@@ -155,52 +203,455 @@ static unsigned int rej_uniform(int16_t *r,
   return ctr;
 }
 
+#if KYBER_X86_64
+/* rej_idx[m] lists the byte offsets 2i of the 16-bit lanes i set in the
+ * 8-bit mask m, in order; _mm_shuffle_epi8 with it left-packs them */
+static const uint8_t rej_idx[256][8] = {
+  {255,255,255,255,255,255,255,255}, {  0,255,255,255,255,255,255,255},
+  {  2,255,255,255,255,255,255,255}, {  0,  2,255,255,255,255,255,255},
+  {  4,255,255,255,255,255,255,255}, {  0,  4,255,255,255,255,255,255},
+  {  2,  4,255,255,255,255,255,255}, {  0,  2,  4,255,255,255,255,255},
+  {  6,255,255,255,255,255,255,255}, {  0,  6,255,255,255,255,255,255},
+  {  2,  6,255,255,255,255,255,255}, {  0,  2,  6,255,255,255,255,255},
+  {  4,  6,255,255,255,255,255,255}, {  0,  4,  6,255,255,255,255,255},
+  {  2,  4,  6,255,255,255,255,255}, {  0,  2,  4,  6,255,255,255,255},
+  {  8,255,255,255,255,255,255,255}, {  0,  8,255,255,255,255,255,255},
+  {  2,  8,255,255,255,255,255,255}, {  0,  2,  8,255,255,255,255,255},
+  {  4,  8,255,255,255,255,255,255}, {  0,  4,  8,255,255,255,255,255},
+  {  2,  4,  8,255,255,255,255,255}, {  0,  2,  4,  8,255,255,255,255},
+  {  6,  8,255,255,255,255,255,255}, {  0,  6,  8,255,255,255,255,255},
+  {  2,  6,  8,255,255,255,255,255}, {  0,  2,  6,  8,255,255,255,255},
+  {  4,  6,  8,255,255,255,255,255}, {  0,  4,  6,  8,255,255,255,255},
+  {  2,  4,  6,  8,255,255,255,255}, {  0,  2,  4,  6,  8,255,255,255},
+  { 10,255,255,255,255,255,255,255}, {  0, 10,255,255,255,255,255,255},
+  {  2, 10,255,255,255,255,255,255}, {  0,  2, 10,255,255,255,255,255},
+  {  4, 10,255,255,255,255,255,255}, {  0,  4, 10,255,255,255,255,255},
+  {  2,  4, 10,255,255,255,255,255}, {  0,  2,  4, 10,255,255,255,255},
+  {  6, 10,255,255,255,255,255,255}, {  0,  6, 10,255,255,255,255,255},
+  {  2,  6, 10,255,255,255,255,255}, {  0,  2,  6, 10,255,255,255,255},
+  {  4,  6, 10,255,255,255,255,255}, {  0,  4,  6, 10,255,255,255,255},
+  {  2,  4,  6, 10,255,255,255,255}, {  0,  2,  4,  6, 10,255,255,255},
+  {  8, 10,255,255,255,255,255,255}, {  0,  8, 10,255,255,255,255,255},
+  {  2,  8, 10,255,255,255,255,255}, {  0,  2,  8, 10,255,255,255,255},
+  {  4,  8, 10,255,255,255,255,255}, {  0,  4,  8, 10,255,255,255,255},
+  {  2,  4,  8, 10,255,255,255,255}, {  0,  2,  4,  8, 10,255,255,255},
+  {  6,  8, 10,255,255,255,255,255}, {  0,  6,  8, 10,255,255,255,255},
+  {  2,  6,  8, 10,255,255,255,255}, {  0,  2,  6,  8, 10,255,255,255},
+  {  4,  6,  8, 10,255,255,255,255}, {  0,  4,  6,  8, 10,255,255,255},
+  {  2,  4,  6,  8, 10,255,255,255}, {  0,  2,  4,  6,  8, 10,255,255},
+  { 12,255,255,255,255,255,255,255}, {  0, 12,255,255,255,255,255,255},
+  {  2, 12,255,255,255,255,255,255}, {  0,  2, 12,255,255,255,255,255},
+  {  4, 12,255,255,255,255,255,255}, {  0,  4, 12,255,255,255,255,255},
+  {  2,  4, 12,255,255,255,255,255}, {  0,  2,  4, 12,255,255,255,255},
+  {  6, 12,255,255,255,255,255,255}, {  0,  6, 12,255,255,255,255,255},
+  {  2,  6, 12,255,255,255,255,255}, {  0,  2,  6, 12,255,255,255,255},
+  {  4,  6, 12,255,255,255,255,255}, {  0,  4,  6, 12,255,255,255,255},
+  {  2,  4,  6, 12,255,255,255,255}, {  0,  2,  4,  6, 12,255,255,255},
+  {  8, 12,255,255,255,255,255,255}, {  0,  8, 12,255,255,255,255,255},
+  {  2,  8, 12,255,255,255,255,255}, {  0,  2,  8, 12,255,255,255,255},
+  {  4,  8, 12,255,255,255,255,255}, {  0,  4,  8, 12,255,255,255,255},
+  {  2,  4,  8, 12,255,255,255,255}, {  0,  2,  4,  8, 12,255,255,255},
+  {  6,  8, 12,255,255,255,255,255}, {  0,  6,  8, 12,255,255,255,255},
+  {  2,  6,  8, 12,255,255,255,255}, {  0,  2,  6,  8, 12,255,255,255},
+  {  4,  6,  8, 12,255,255,255,255}, {  0,  4,  6,  8, 12,255,255,255},
+  {  2,  4,  6,  8, 12,255,255,255}, {  0,  2,  4,  6,  8, 12,255,255},
+  { 10, 12,255,255,255,255,255,255}, {  0, 10, 12,255,255,255,255,255},
+  {  2, 10, 12,255,255,255,255,255}, {  0,  2, 10, 12,255,255,255,255},
+  {  4, 10, 12,255,255,255,255,255}, {  0,  4, 10, 12,255,255,255,255},
+  {  2,  4, 10, 12,255,255,255,255}, {  0,  2,  4, 10, 12,255,255,255},
+  {  6, 10, 12,255,255,255,255,255}, {  0,  6, 10, 12,255,255,255,255},
+  {  2,  6, 10, 12,255,255,255,255}, {  0,  2,  6, 10, 12,255,255,255},
+  {  4,  6, 10, 12,255,255,255,255}, {  0,  4,  6, 10, 12,255,255,255},
+  {  2,  4,  6, 10, 12,255,255,255}, {  0,  2,  4,  6, 10, 12,255,255},
+  {  8, 10, 12,255,255,255,255,255}, {  0,  8, 10, 12,255,255,255,255},
+  {  2,  8, 10, 12,255,255,255,255}, {  0,  2,  8, 10, 12,255,255,255},
+  {  4,  8, 10, 12,255,255,255,255}, {  0,  4,  8, 10, 12,255,255,255},
+  {  2,  4,  8, 10, 12,255,255,255}, {  0,  2,  4,  8, 10, 12,255,255},
+  {  6,  8, 10, 12,255,255,255,255}, {  0,  6,  8, 10, 12,255,255,255},
+  {  2,  6,  8, 10, 12,255,255,255}, {  0,  2,  6,  8, 10, 12,255,255},
+  {  4,  6,  8, 10, 12,255,255,255}, {  0,  4,  6,  8, 10, 12,255,255},
+  {  2,  4,  6,  8, 10, 12,255,255}, {  0,  2,  4,  6,  8, 10, 12,255},
+  { 14,255,255,255,255,255,255,255}, {  0, 14,255,255,255,255,255,255},
+  {  2, 14,255,255,255,255,255,255}, {  0,  2, 14,255,255,255,255,255},
+  {  4, 14,255,255,255,255,255,255}, {  0,  4, 14,255,255,255,255,255},
+  {  2,  4, 14,255,255,255,255,255}, {  0,  2,  4, 14,255,255,255,255},
+  {  6, 14,255,255,255,255,255,255}, {  0,  6, 14,255,255,255,255,255},
+  {  2,  6, 14,255,255,255,255,255}, {  0,  2,  6, 14,255,255,255,255},
+  {  4,  6, 14,255,255,255,255,255}, {  0,  4,  6, 14,255,255,255,255},
+  {  2,  4,  6, 14,255,255,255,255}, {  0,  2,  4,  6, 14,255,255,255},
+  {  8, 14,255,255,255,255,255,255}, {  0,  8, 14,255,255,255,255,255},
+  {  2,  8, 14,255,255,255,255,255}, {  0,  2,  8, 14,255,255,255,255},
+  {  4,  8, 14,255,255,255,255,255}, {  0,  4,  8, 14,255,255,255,255},
+  {  2,  4,  8, 14,255,255,255,255}, {  0,  2,  4,  8, 14,255,255,255},
+  {  6,  8, 14,255,255,255,255,255}, {  0,  6,  8, 14,255,255,255,255},
+  {  2,  6,  8, 14,255,255,255,255}, {  0,  2,  6,  8, 14,255,255,255},
+  {  4,  6,  8, 14,255,255,255,255}, {  0,  4,  6,  8, 14,255,255,255},
+  {  2,  4,  6,  8, 14,255,255,255}, {  0,  2,  4,  6,  8, 14,255,255},
+  { 10, 14,255,255,255,255,255,255}, {  0, 10, 14,255,255,255,255,255},
+  {  2, 10, 14,255,255,255,255,255}, {  0,  2, 10, 14,255,255,255,255},
+  {  4, 10, 14,255,255,255,255,255}, {  0,  4, 10, 14,255,255,255,255},
+  {  2,  4, 10, 14,255,255,255,255}, {  0,  2,  4, 10, 14,255,255,255},
+  {  6, 10, 14,255,255,255,255,255}, {  0,  6, 10, 14,255,255,255,255},
+  {  2,  6, 10, 14,255,255,255,255}, {  0,  2,  6, 10, 14,255,255,255},
+  {  4,  6, 10, 14,255,255,255,255}, {  0,  4,  6, 10, 14,255,255,255},
+  {  2,  4,  6, 10, 14,255,255,255}, {  0,  2,  4,  6, 10, 14,255,255},
+  {  8, 10, 14,255,255,255,255,255}, {  0,  8, 10, 14,255,255,255,255},
+  {  2,  8, 10, 14,255,255,255,255}, {  0,  2,  8, 10, 14,255,255,255},
+  {  4,  8, 10, 14,255,255,255,255}, {  0,  4,  8, 10, 14,255,255,255},
+  {  2,  4,  8, 10, 14,255,255,255}, {  0,  2,  4,  8, 10, 14,255,255},
+  {  6,  8, 10, 14,255,255,255,255}, {  0,  6,  8, 10, 14,255,255,255},
+  {  2,  6,  8, 10, 14,255,255,255}, {  0,  2,  6,  8, 10, 14,255,255},
+  {  4,  6,  8, 10, 14,255,255,255}, {  0,  4,  6,  8, 10, 14,255,255},
+  {  2,  4,  6,  8, 10, 14,255,255}, {  0,  2,  4,  6,  8, 10, 14,255},
+  { 12, 14,255,255,255,255,255,255}, {  0, 12, 14,255,255,255,255,255},
+  {  2, 12, 14,255,255,255,255,255}, {  0,  2, 12, 14,255,255,255,255},
+  {  4, 12, 14,255,255,255,255,255}, {  0,  4, 12, 14,255,255,255,255},
+  {  2,  4, 12, 14,255,255,255,255}, {  0,  2,  4, 12, 14,255,255,255},
+  {  6, 12, 14,255,255,255,255,255}, {  0,  6, 12, 14,255,255,255,255},
+  {  2,  6, 12, 14,255,255,255,255}, {  0,  2,  6, 12, 14,255,255,255},
+  {  4,  6, 12, 14,255,255,255,255}, {  0,  4,  6, 12, 14,255,255,255},
+  {  2,  4,  6, 12, 14,255,255,255}, {  0,  2,  4,  6, 12, 14,255,255},
+  {  8, 12, 14,255,255,255,255,255}, {  0,  8, 12, 14,255,255,255,255},
+  {  2,  8, 12, 14,255,255,255,255}, {  0,  2,  8, 12, 14,255,255,255},
+  {  4,  8, 12, 14,255,255,255,255}, {  0,  4,  8, 12, 14,255,255,255},
+  {  2,  4,  8, 12, 14,255,255,255}, {  0,  2,  4,  8, 12, 14,255,255},
+  {  6,  8, 12, 14,255,255,255,255}, {  0,  6,  8, 12, 14,255,255,255},
+  {  2,  6,  8, 12, 14,255,255,255}, {  0,  2,  6,  8, 12, 14,255,255},
+  {  4,  6,  8, 12, 14,255,255,255}, {  0,  4,  6,  8, 12, 14,255,255},
+  {  2,  4,  6,  8, 12, 14,255,255}, {  0,  2,  4,  6,  8, 12, 14,255},
+  { 10, 12, 14,255,255,255,255,255}, {  0, 10, 12, 14,255,255,255,255},
+  {  2, 10, 12, 14,255,255,255,255}, {  0,  2, 10, 12, 14,255,255,255},
+  {  4, 10, 12, 14,255,255,255,255}, {  0,  4, 10, 12, 14,255,255,255},
+  {  2,  4, 10, 12, 14,255,255,255}, {  0,  2,  4, 10, 12, 14,255,255},
+  {  6, 10, 12, 14,255,255,255,255}, {  0,  6, 10, 12, 14,255,255,255},
+  {  2,  6, 10, 12, 14,255,255,255}, {  0,  2,  6, 10, 12, 14,255,255},
+  {  4,  6, 10, 12, 14,255,255,255}, {  0,  4,  6, 10, 12, 14,255,255},
+  {  2,  4,  6, 10, 12, 14,255,255}, {  0,  2,  4,  6, 10, 12, 14,255},
+  {  8, 10, 12, 14,255,255,255,255}, {  0,  8, 10, 12, 14,255,255,255},
+  {  2,  8, 10, 12, 14,255,255,255}, {  0,  2,  8, 10, 12, 14,255,255},
+  {  4,  8, 10, 12, 14,255,255,255}, {  0,  4,  8, 10, 12, 14,255,255},
+  {  2,  4,  8, 10, 12, 14,255,255}, {  0,  2,  4,  8, 10, 12, 14,255},
+  {  6,  8, 10, 12, 14,255,255,255}, {  0,  6,  8, 10, 12, 14,255,255},
+  {  2,  6,  8, 10, 12, 14,255,255}, {  0,  2,  6,  8, 10, 12, 14,255},
+  {  4,  6,  8, 10, 12, 14,255,255}, {  0,  4,  6,  8, 10, 12, 14,255},
+  {  2,  4,  6,  8, 10, 12, 14,255}, {  0,  2,  4,  6,  8, 10, 12, 14}
+};
+
+/*************************************************
+* Name:        rej_uniform_avx2
+*
+* Description: AVX2 rejection sampling on 48 uniform random bytes: all
+*              32 12-bit candidates are compared with q at once, and the
+*              accepted ones of each group of 8 are left-packed by a
+*              shuffle from rej_idx. Same output as rej_uniform on the
+*              same bytes, as long as there is room for all of them.
+*
+* Arguments:   - int16_t *r: pointer to output buffer (room for 32 integers)
+*              - const uint8_t *buf: 48 bytes of XOF output
+*
+* Returns number of sampled 16-bit integers (at most 32)
+**************************************************/
+TARGET_AVX2
+static unsigned int rej_uniform_avx2(int16_t *r, const uint8_t buf[48])
+{
+  unsigned int ctr, good;
+  const __m256i bound = _mm256_set1_epi16(KYBER_Q);
+  const __m256i mask = _mm256_set1_epi16(0xFFF);
+  const __m256i ones = _mm256_set1_epi8(1);
+  /* Two candidates per 3 bytes; the upper lane holds its 12 bytes at 4-15 */
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,1,2,3,4,4,5,6,7,7,8,9,10,10,11,
+                                            4,5,5,6,7,8,8,9,10,11,11,12,13,14,14,15);
+  __m256i f0, f1, g0, g1;
+
+  /* bytes 0-15 | 8-23 and 24-39 | 32-47 */
+  f0 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)buf), 0x94);
+  f1 = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)&buf[16]), 0xE9);
+  f0 = _mm256_shuffle_epi8(f0, shufbidx);
+  f1 = _mm256_shuffle_epi8(f1, shufbidx);
+  f0 = _mm256_and_si256(_mm256_blend_epi16(f0, _mm256_srli_epi16(f0, 4), 0xAA), mask);
+  f1 = _mm256_and_si256(_mm256_blend_epi16(f1, _mm256_srli_epi16(f1, 4), 0xAA), mask);
+
+  /* bits 0-7: candidates 0-7, 8-15: 16-23, 16-23: 8-15, 24-31: 24-31 */
+  g0 = _mm256_packs_epi16(_mm256_cmpgt_epi16(bound, f0), _mm256_cmpgt_epi16(bound, f1));
+  good = _mm256_movemask_epi8(g0);
+
+  g0 = _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i *)rej_idx[good & 0xFF]));
+  g1 = _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i *)rej_idx[(good >> 8) & 0xFF]));
+  g0 = _mm256_inserti128_si256(g0, _mm_loadl_epi64((const __m128i *)rej_idx[(good >> 16) & 0xFF]), 1);
+  g1 = _mm256_inserti128_si256(g1, _mm_loadl_epi64((const __m128i *)rej_idx[good >> 24]), 1);
+  g0 = _mm256_unpacklo_epi8(g0, _mm256_add_epi8(g0, ones));
+  g1 = _mm256_unpacklo_epi8(g1, _mm256_add_epi8(g1, ones));
+  f0 = _mm256_shuffle_epi8(f0, g0);
+  f1 = _mm256_shuffle_epi8(f1, g1);
+
+  ctr = 0;
+  _mm_storeu_si128((__m128i *)&r[ctr], _mm256_castsi256_si128(f0));
+  ctr += __builtin_popcount(good & 0xFF);
+  _mm_storeu_si128((__m128i *)&r[ctr], _mm256_extracti128_si256(f0, 1));
+  ctr += __builtin_popcount((good >> 16) & 0xFF);
+  _mm_storeu_si128((__m128i *)&r[ctr], _mm256_castsi256_si128(f1));
+  ctr += __builtin_popcount((good >> 8) & 0xFF);
+  _mm_storeu_si128((__m128i *)&r[ctr], _mm256_extracti128_si256(f1, 1));
+  ctr += __builtin_popcount(good >> 24);
+
+  return ctr;
+}
+
+#define REJ_LANES 6
+#else
+#define REJ_LANES 3
+#endif
+
+/*************************************************
+* Name:        rej_uniform_lanes
+*
+* Description: Rejection sampling on REJ_LANES lanes of XOF output: 48
+*              bytes for rej_uniform_avx2 on x86-64, else the 24 of
+*              rej_uniform. Consumes the lanes in order either way, so
+*              the output is the same.
+*
+* Arguments:   - int16_t *r: pointer to output buffer
+*              - unsigned int len: requested number of 16-bit integers (uniform mod q)
+*              - const uint64_t *t: REJ_LANES lanes of XOF output
+*
+* Returns number of sampled 16-bit integers (at most len)
+**************************************************/
+static unsigned int rej_uniform_lanes(int16_t *r,
+                                      unsigned int len,
+                                      const uint64_t t[REJ_LANES])
+{
+#if KYBER_X86_64
+  unsigned int ctr;
+
+  /* The lanes are little-endian, so t is the XOF output as bytes */
+  if(cpu_has_avx2() && len >= 32)
+    return rej_uniform_avx2(r, (const uint8_t *)t);
+
+  ctr = rej_uniform(r, len, t);
+  return ctr + rej_uniform(r + ctr, len - ctr, t + 3);
+#else
+  return rej_uniform(r, len, t);
+#endif
+}
+
 #define gen_a(A,B)  gen_matrix(A,B,0)
 #define gen_at(A,B) gen_matrix(A,B,1)
 
+/*************************************************
+* Name:        gen_matrix_entry
+*
+* Description: Sample a single matrix entry by rejection sampling on the
+*              output of an XOF already seeded with seed || x || y. The XOF
+*              output is consumed a lane at a time straight from the XOF
+*              state, without an intermediate byte buffer.
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - xof_state *state: pointer to the seeded XOF state
+**************************************************/
+static void gen_matrix_entry(poly *r, xof_state *state)
+{
+  unsigned int ctr = 0, i;
+  uint64_t t[REJ_LANES];
+
+  while(ctr < KYBER_N) {
+    for(i=0;i<REJ_LANES;i++)
+      t[i] = xof_squeezelane(state);
+    ctr += rej_uniform_lanes(r->coeffs + ctr, KYBER_N - ctr, t);
+  }
+}
+
+/*************************************************
+* Name:        gen_matrix_xy
+*
+* Description: Sample the matrix entry seeded with seed || x || y. In the
+*              90s variant state already holds the AES key (the seed) and
+*              only the nonce is set.
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - xof_state *state: pointer to the XOF state
+*              - const uint8_t *seed: pointer to input seed
+*              - uint8_t x, y: domain-separation bytes
+**************************************************/
+static void gen_matrix_xy(poly *r,
+                          xof_state *state,
+                          const uint8_t seed[KYBER_SYMBYTES],
+                          uint8_t x,
+                          uint8_t y)
+{
+#ifdef KYBER_90S
+  (void)seed;
+  xof_setnonce(state, x, y);
+#else
+  xof_absorb(state, seed, x, y);
+#endif
+  gen_matrix_entry(r, state);
+}
+
+#ifndef KYBER_90S
+/*************************************************
+* Name:        gen_matrix_entry4x
+*
+* Description: Sample four matrix entries in parallel; entry k is seeded
+*              with seed || x[k] || y[k]. Same output as four calls of
+*              gen_matrix_entry, but the four SHAKE128 instances share each
+*              Keccak permutation.
+*
+* Arguments:   - poly **r: pointers to the four output polynomials
+*              - const uint8_t *seed: pointer to input seed
+*              - const uint8_t *x: first domain-separation byte of each entry
+*              - const uint8_t *y: second domain-separation byte of each entry
+**************************************************/
+static void gen_matrix_entry4x(poly *r[4],
+                               const uint8_t seed[KYBER_SYMBYTES],
+                               const uint8_t x[4],
+                               const uint8_t y[4])
+{
+  unsigned int ctr[4] = {0}, i, k;
+  uint64_t lane[REJ_LANES][4], t[REJ_LANES];
+  xof4x_state state;
+
+  xof4x_absorb(&state, seed, x, y);
+
+  while(ctr[0] < KYBER_N || ctr[1] < KYBER_N || ctr[2] < KYBER_N || ctr[3] < KYBER_N) {
+    for(i=0;i<REJ_LANES;i++)
+      xof4x_squeezelane(lane[i], &state);
+    for(k=0;k<4;k++) {
+      for(i=0;i<REJ_LANES;i++)
+        t[i] = lane[i][k];
+      ctr[k] += rej_uniform_lanes(r[k]->coeffs + ctr[k], KYBER_N - ctr[k], t);
+    }
+  }
+}
+#endif
+
 /*************************************************
 * Name:        gen_matrix
 *
 * Description: Deterministically generate matrix A (or the transpose of A)
 *              from a seed. Entries of the matrix are polynomials that look
 *              uniformly random. Performs rejection sampling on output of
-*              a XOF
+*              a XOF. In the 90s variant all entries share one AES key
+*              (the seed), so it is expanded once and only the nonce
+*              changes from entry to entry.
 *
 * Arguments:   - polyvec *a: pointer to ouptput matrix A
 *              - const uint8_t *seed: pointer to input seed
 *              - int transposed: boolean deciding whether A or A^T is generated
 **************************************************/
-#define GEN_MATRIX_NBLOCKS ((12*KYBER_N/8*(1 << 12)/KYBER_Q + XOF_BLOCKBYTES)/XOF_BLOCKBYTES)
 // Not static for benchmarking
 void gen_matrix(polyvec *a, const uint8_t seed[KYBER_SYMBYTES], int transposed)
 {
-  unsigned int ctr, i, j, k;
-  unsigned int buflen, off;
-  uint8_t buf[GEN_MATRIX_NBLOCKS*XOF_BLOCKBYTES+2];
+  unsigned int i, j, n = 0;
   xof_state state;
 
-  for(i=0;i<KYBER_K;i++) {
-    for(j=0;j<KYBER_K;j++) {
-      if(transposed)
-        xof_absorb(&state, seed, i, j);
-      else
-        xof_absorb(&state, seed, j, i);
-
-      xof_squeezeblocks(buf, GEN_MATRIX_NBLOCKS, &state);
-      buflen = GEN_MATRIX_NBLOCKS*XOF_BLOCKBYTES;
-      ctr = rej_uniform(a[i].vec[j].coeffs, KYBER_N, buf, buflen);
-
-      while(ctr < KYBER_N) {
-        off = buflen % 3;
-        for(k = 0; k < off; k++)
-          buf[k] = buf[buflen - off + k];
-        xof_squeezeblocks(buf + off, 1, &state);
-        buflen = off + XOF_BLOCKBYTES;
-        ctr += rej_uniform(a[i].vec[j].coeffs + ctr, KYBER_N - ctr, buf, buflen);
-      }
+#ifdef KYBER_90S
+  xof_setkey(&state, seed);
+#else
+  unsigned int k;
+  poly *r[4];
+  uint8_t x[4], y[4];
+
+  for(;n+4<=KYBER_K*KYBER_K;n+=4) {
+    for(k=0;k<4;k++) {
+      i = (n+k)/KYBER_K;
+      j = (n+k)%KYBER_K;
+      r[k] = &a[i].vec[j];
+      x[k] = transposed ? i : j;
+      y[k] = transposed ? j : i;
     }
+    gen_matrix_entry4x(r, seed, x, y);
+  }
+#endif
+
+  for(;n<KYBER_K*KYBER_K;n++) {
+    i = n/KYBER_K;
+    j = n%KYBER_K;
+    if(transposed)
+      gen_matrix_xy(&a[i].vec[j], &state, seed, i, j);
+    else
+      gen_matrix_xy(&a[i].vec[j], &state, seed, j, i);
+  }
+}
+
+/*************************************************
+* Name:        gen_matrix_row_mul
+*
+* Description: Row i of the product of the matrix A (or A^T) with b,
+*              multiplied by 2^-16, without storing the matrix: each
+*              entry is sampled into a single polynomial and multiplied
+*              into r before the next one is generated. The output is
+*              reduced (|r| <= q/2) and equal mod q to row i of
+*              polyvec_matvec on the output of gen_matrix.
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - const uint8_t *seed: pointer to input seed
+*              - unsigned int i: row index
+*              - int transposed: boolean deciding whether A or A^T is used
+*              - const polyvec *b: pointer to input vector (NTT domain,
+*                                  |b| <= q/2)
+*              - const polyvec_mulcache *bc: pointer to cache of b
+**************************************************/
+static void gen_matrix_row_mul(poly *r,
+                               const uint8_t seed[KYBER_SYMBYTES],
+                               unsigned int i,
+                               int transposed,
+                               const polyvec *b,
+                               const polyvec_mulcache *bc)
+{
+  unsigned int j;
+  xof_state state;
+  poly a;
+
+#ifdef KYBER_90S
+  xof_setkey(&state, seed);
+#endif
+
+  for(j=0;j<KYBER_N;j++)
+    r->coeffs[j] = 0;
+  // |r| < KYBER_K*q after the last product
+  for(j=0;j<KYBER_K;j++) {
+    if(transposed)
+      gen_matrix_xy(&a, &state, seed, i, j);
+    else
+      gen_matrix_xy(&a, &state, seed, j, i);
+    poly_basemul_acc_cached(r, &a, &b->vec[j], &bc->vec[j]);
+  }
+  poly_reduce(r);
+}
+
+#if (INDCPA_STREAM_MATRIX == 1) && (INDCPA_KEYPAIR_DUAL != 1)
+/*************************************************
+* Name:        pack_pk_stream
+*
+* Description: pack_pk with the matrix A generated row by row from the
+*              seed (gen_matrix_row_mul); same output
+*
+* Arguments:   uint8_t *r: pointer to the output serialized public key
+*              const polyvec *skpv: pointer to the secret vector s (NTT domain)
+*              const polyvec_mulcache *skpvc: pointer to the cache of s
+*              const polyvec *e: pointer to the noise vector e (NTT domain)
+*              const uint8_t *seed: pointer to the input public seed
+**************************************************/
+static void pack_pk_stream(uint8_t r[KYBER_INDCPA_PUBLICKEYBYTES],
+                           const polyvec *skpv,
+                           const polyvec_mulcache *skpvc,
+                           const polyvec *e,
+                           const uint8_t seed[KYBER_SYMBYTES])
+{
+  size_t i;
+  poly t;
+
+  for(i=0;i<KYBER_K;i++) {
+    gen_matrix_row_mul(&t, seed, i, 0, skpv, skpvc);
+    poly_tomont(&t);
+    poly_add(&t, &t, &e->vec[i]);
+    poly_reduce(&t);
+    poly_tobytes(r+i*KYBER_POLYBYTES, &t);
   }
+  for(i=0;i<KYBER_SYMBYTES;i++)
+    r[i+KYBER_POLYVECBYTES] = seed[i];
 }
+#endif
 
 /*************************************************
 * Name:        indcpa_keypair
@@ -213,14 +664,38 @@ void gen_matrix(polyvec *a, const uint8_t seed[KYBER_SYMBYTES], int transposed)
 *              - uint8_t *sk: pointer to output private key
                               (of length KYBER_INDCPA_SECRETKEYBYTES bytes)
 **************************************************/
+void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
+                    uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES])
+{
+  uint8_t coins[KYBER_SYMBYTES];
+
+  esp_randombytes(coins, KYBER_SYMBYTES);
+  indcpa_keypair_derand(pk, sk, coins);
+}
+
+/*************************************************
+* Name:        indcpa_keypair_derand
+*
+* Description: Deterministic indcpa_keypair: the key pair is a function
+*              of the coins only
+*
+* Arguments:   - uint8_t *pk: pointer to output public key
+*                             (of length KYBER_INDCPA_PUBLICKEYBYTES bytes)
+*              - uint8_t *sk: pointer to output private key
+*                             (of length KYBER_INDCPA_SECRETKEYBYTES bytes)
+*              - const uint8_t *coins: pointer to input randomness
+*                                      (of length KYBER_SYMBYTES bytes)
+**************************************************/
 #if (INDCPA_KEYPAIR_DUAL == 1)
 
 typedef struct IndcpaKeypairData_t
 {
   uint8_t * pk;
   uint8_t * sk;
+  const uint8_t *coins;
   uint8_t buf[2*KYBER_SYMBYTES];
-  polyvec a[KYBER_K], e, pkpv, skpv;
+  polyvec a[KYBER_K], e, skpv;
+  polyvec_mulcache skpvc;
 } GenericIndcpaKeypairData_t;
 
 TaskFunction_t indcpa_keypair_dual_0(void *xStruct) {
@@ -229,34 +704,16 @@ TaskFunction_t indcpa_keypair_dual_0(void *xStruct) {
   const uint8_t *noiseseed = data->buf+KYBER_SYMBYTES;
 
   while(1) {
-    esp_randombytes(data->buf, KYBER_SYMBYTES);
-    hash_g(data->buf, data->buf, KYBER_SYMBYTES);
+    hash_g(data->buf, data->coins, KYBER_SYMBYTES);
     xSemaphoreGive(Semaphore_core_0); //give sign that core_1 can run
 
     gen_a(data->a, publicseed);
 
-    // uint8_t nonce = 0;
-    // for(unsigned int i=0;i<KYBER_K;i++)
-    //   poly_getnoise_eta1(&data->skpv.vec[i], noiseseed, nonce++);
-    // for(unsigned int i=0;i<KYBER_K;i++)
-    //   poly_getnoise_eta1(&data->e.vec[i], noiseseed, nonce++);
-
-    //polyvec_ntt(&skpv);
-    //polyvec_ntt(&e);
-
     xSemaphoreTake(Semaphore_core_1, portMAX_DELAY); //wait until core_1 finish
 
-    // matrix-vector multiplication
-    for(unsigned int i=0;i<KYBER_K;i++) {
-      polyvec_basemul_acc_montgomery(&data->pkpv.vec[i], &data->a[i], &data->skpv);
-      poly_tomont(&data->pkpv.vec[i]);
-    }
-
-    polyvec_add(&data->pkpv, &data->pkpv, &data->e);
-    polyvec_reduce(&data->pkpv);
-
-    // pack_sk(data->sk, &data->skpv);
-    pack_pk(data->pk, &data->pkpv, publicseed);
+    // matrix-vector multiplication, serialized as computed
+    pack_pk(data->pk, data->a, &data->skpv, &data->skpvc, &data->e, publicseed);
+    record_stack_watermark(0);
     xSemaphoreGive(Semaphore_core_done); //give sign, that task is done
     vTaskDelete(NULL);    // Delete the task using the xHandle_0
   }
@@ -269,46 +726,45 @@ TaskFunction_t indcpa_keypair_dual_1(void *xStruct) {
 
   while(1) {
     xSemaphoreTake(Semaphore_core_0, portMAX_DELAY); //wait until core_0 finish its job
-    // esp_randombytes(data->buf, KYBER_SYMBYTES);
-    // hash_g(data->buf, data->buf, KYBER_SYMBYTES);
-    
-    // gen_a(data->a, publicseed);
 
     uint8_t nonce = 0;
+#ifdef KYBER_90S
+    prf_key key;
+    prf_key_init(&key, noiseseed);
+    for(unsigned int i=0;i<KYBER_K;i++)
+      poly_getnoise_eta1_keyed(&data->skpv.vec[i], &key, nonce++);
+    for(unsigned int i=0;i<KYBER_K;i++)
+      poly_getnoise_eta1_keyed(&data->e.vec[i], &key, nonce++);
+    prf_key_free(&key);
+#else
     for(unsigned int i=0;i<KYBER_K;i++)
       poly_getnoise_eta1(&data->skpv.vec[i], noiseseed, nonce++);
     for(unsigned int i=0;i<KYBER_K;i++)
       poly_getnoise_eta1(&data->e.vec[i], noiseseed, nonce++);
+#endif
 
     polyvec_ntt(&data->skpv);
     polyvec_ntt(&data->e);
+    polyvec_mulcache_compute(&data->skpvc, &data->skpv);
 
     xSemaphoreGive(Semaphore_core_1); //give sign core_0 can run
 
-    // matrix-vector multiplication
-    // for(unsigned int i=0;i<KYBER_K;i++) {
-    //   polyvec_basemul_acc_montgomery(&data->pkpv.vec[i], &data->a[i], &data->skpv);
-    //   poly_tomont(&data->pkpv.vec[i]);
-    // }
-
-    // polyvec_add(&data->pkpv, &data->pkpv, &data->e);
-    // polyvec_reduce(&data->pkpv);
-
     pack_sk(data->sk, &data->skpv);
-    // pack_pk(data->pk, &data->pkpv, publicseed);
+    record_stack_watermark(1);
     xSemaphoreGive(Semaphore_core_done); //give sign, that task is done
     vTaskDelete(NULL);    // Delete the task using the xHandle_1
   }
 }
 
-void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
-                    uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES])
+void indcpa_keypair_derand(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
+                           uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES],
+                           const uint8_t coins[KYBER_SYMBYTES])
 {
   Semaphore_core_0 = xSemaphoreCreateCounting(1, 0);
   Semaphore_core_1 = xSemaphoreCreateCounting(1, 0);
   Semaphore_core_done = xSemaphoreCreateCounting(2, 0);
 
-  GenericIndcpaKeypairData_t xStruct = { .pk = pk, .sk = sk};
+  GenericIndcpaKeypairData_t xStruct = { .pk = pk, .sk = sk, .coins = coins };
 
   TaskHandle_t xHandle_0 = NULL;
   TaskHandle_t xHandle_1 = NULL;
@@ -318,7 +774,7 @@ void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
   xReturned_0 = xTaskCreatePinnedToCore(
                   indcpa_keypair_dual_0,       /* Function that implements the task. */
                   "indcpa_keypair_dual_0",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_0, /* Used to pass out the created task's handle. */
@@ -327,7 +783,7 @@ void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
   xReturned_1 = xTaskCreatePinnedToCore(
                   indcpa_keypair_dual_1,       /* Function that implements the task. */
                   "indcpa_keypair_dual_1",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_1, /* Used to pass out the created task's handle. */
@@ -346,43 +802,140 @@ void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
   // }
 }
 #else
-void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
-                    uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES])
+void indcpa_keypair_derand(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
+                           uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES],
+                           const uint8_t coins[KYBER_SYMBYTES])
 {
-  unsigned int i;
   uint8_t buf[2*KYBER_SYMBYTES];
   const uint8_t *publicseed = buf;
   const uint8_t *noiseseed = buf+KYBER_SYMBYTES;
+#ifdef KYBER_90S
+  unsigned int i;
   uint8_t nonce = 0;
-  polyvec a[KYBER_K], e, pkpv, skpv;
+  prf_key key;
+#endif
+#if (INDCPA_STREAM_MATRIX != 1)
+  polyvec a[KYBER_K];
+#endif
+  polyvec e, skpv;
+  polyvec_mulcache skpvc;
 
-  esp_randombytes(buf, KYBER_SYMBYTES);
-  hash_g(buf, buf, KYBER_SYMBYTES);
-  
-  gen_a(a, publicseed);
+  hash_g(buf, coins, KYBER_SYMBYTES);
 
+#ifdef KYBER_90S
+  prf_key_init(&key, noiseseed);
   for(i=0;i<KYBER_K;i++)
-    poly_getnoise_eta1(&skpv.vec[i], noiseseed, nonce++);
+    poly_getnoise_eta1_keyed(&skpv.vec[i], &key, nonce++);
   for(i=0;i<KYBER_K;i++)
-    poly_getnoise_eta1(&e.vec[i], noiseseed, nonce++);
+    poly_getnoise_eta1_keyed(&e.vec[i], &key, nonce++);
+  prf_key_free(&key);
+#elif (KYBER_K == 2)
+  poly_getnoise_eta1_4x(skpv.vec+0, skpv.vec+1, e.vec+0, e.vec+1, noiseseed, 0, 1, 2, 3);
+#elif (KYBER_K == 3)
+  /* a[0].vec[0..1] only serve as scratch for the unused fourth samples */
+  poly_getnoise_eta1_4x(skpv.vec+0, skpv.vec+1, skpv.vec+2, e.vec+0, noiseseed, 0, 1, 2, 3);
+#if (INDCPA_STREAM_MATRIX == 1)
+  {
+    /* No matrix to borrow; both unused samples go to one polynomial */
+    poly scratch;
+    poly_getnoise_eta1_4x(e.vec+1, e.vec+2, &scratch, &scratch, noiseseed, 4, 5, 6, 7);
+  }
+#else
+  poly_getnoise_eta1_4x(e.vec+1, e.vec+2, a[0].vec+0, a[0].vec+1, noiseseed, 4, 5, 6, 7);
+#endif
+#elif (KYBER_K == 4)
+  poly_getnoise_eta1_4x(skpv.vec+0, skpv.vec+1, skpv.vec+2, skpv.vec+3, noiseseed, 0, 1, 2, 3);
+  poly_getnoise_eta1_4x(e.vec+0, e.vec+1, e.vec+2, e.vec+3, noiseseed, 4, 5, 6, 7);
+#endif
 
   polyvec_ntt(&skpv);
   polyvec_ntt(&e);
-
-  // matrix-vector multiplication
-  for(i=0;i<KYBER_K;i++) {
-    polyvec_basemul_acc_montgomery(&pkpv.vec[i], &a[i], &skpv);
-    poly_tomont(&pkpv.vec[i]);
-  }
-
-  polyvec_add(&pkpv, &pkpv, &e);
-  polyvec_reduce(&pkpv);
+  polyvec_mulcache_compute(&skpvc, &skpv);
 
   pack_sk(sk, &skpv);
-  pack_pk(pk, &pkpv, publicseed);
+#if (INDCPA_STREAM_MATRIX == 1)
+  // matrix-vector multiplication, A generated one entry at a time
+  pack_pk_stream(pk, &skpv, &skpvc, &e, publicseed);
+#else
+  gen_a(a, publicseed);
+  // matrix-vector multiplication, serialized as computed
+  pack_pk(pk, a, &skpv, &skpvc, &e, publicseed);
+#endif
 }
 #endif
 
+/*************************************************
+* Name:        enc_at
+*
+* Description: indcpa_enc after unpacking the public key and generating
+*              the matrix A^T (shared with indcpa_enc_prepared)
+*
+* Arguments:   - uint8_t *c: pointer to output ciphertext
+*              - const uint8_t *m: pointer to input message
+*              - const polyvec *at: pointer to the matrix A^T (NTT domain),
+*                                   or NULL to generate A^T one entry at
+*                                   a time from seed (gen_matrix_row_mul)
+*              - const uint8_t *seed: pointer to the public seed (only
+*                                     read if at is NULL)
+*              - const uint8_t *t: pointer to the packed public-key
+*                                  vector (of length KYBER_POLYVECBYTES)
+*              - const uint8_t *coins: pointer to input random coins
+**************************************************/
+static void enc_at(uint8_t c[KYBER_INDCPA_BYTES],
+                   const uint8_t m[KYBER_INDCPA_MSGBYTES],
+                   const polyvec at[KYBER_K],
+                   const uint8_t seed[KYBER_SYMBYTES],
+                   const uint8_t t[KYBER_POLYVECBYTES],
+                   const uint8_t coins[KYBER_SYMBYTES])
+{
+  unsigned int i;
+#ifdef KYBER_90S
+  uint8_t nonce = 0;
+  prf_key key;
+#endif
+  polyvec sp, ep, b;
+  polyvec_mulcache spc;
+  poly v, k, epp;
+
+  poly_frommsg(&k, m);
+
+#ifdef KYBER_90S
+  prf_key_init(&key, coins);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta1_keyed(sp.vec+i, &key, nonce++);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta2_keyed(ep.vec+i, &key, nonce++);
+  poly_getnoise_eta2_keyed(&epp, &key, nonce++);
+  prf_key_free(&key);
+#elif (KYBER_K == 2)
+  poly_getnoise_eta1122_4x(sp.vec+0, sp.vec+1, ep.vec+0, ep.vec+1, coins, 0, 1, 2, 3);
+  poly_getnoise_eta2(&epp, coins, 4);
+#elif (KYBER_K == 3)
+  /* KYBER_ETA1 == KYBER_ETA2; b.vec[0] is scratch for the unused eighth sample */
+  poly_getnoise_eta1_4x(sp.vec+0, sp.vec+1, sp.vec+2, ep.vec+0, coins, 0, 1, 2, 3);
+  poly_getnoise_eta1_4x(ep.vec+1, ep.vec+2, &epp, b.vec+0, coins, 4, 5, 6, 7);
+#elif (KYBER_K == 4)
+  /* KYBER_ETA1 == KYBER_ETA2 */
+  poly_getnoise_eta1_4x(sp.vec+0, sp.vec+1, sp.vec+2, sp.vec+3, coins, 0, 1, 2, 3);
+  poly_getnoise_eta1_4x(ep.vec+0, ep.vec+1, ep.vec+2, ep.vec+3, coins, 4, 5, 6, 7);
+  poly_getnoise_eta2(&epp, coins, 8);
+#endif
+
+  polyvec_ntt(&sp);
+  polyvec_mulcache_compute(&spc, &sp);
+
+  // matrix-vector multiplication
+  if(at != NULL)
+    polyvec_matvec(&b, at, &sp, &spc);
+  else
+    for(i=0;i<KYBER_K;i++)
+      gen_matrix_row_mul(&b.vec[i], seed, i, 1, &sp, &spc);
+  polyvec_basemul_acc_packed(&v, t, &sp, &spc);
+
+  poly_add(&epp, &epp, &k);
+  pack_ciphertext(c, &b, &ep, &v, &epp);
+}
+
 /*************************************************
 * Name:        indcpa_enc
 *
@@ -407,55 +960,29 @@ typedef struct IndcpaEncData_t
   const uint8_t *pk;
   const uint8_t *coins;
   uint8_t seed[KYBER_SYMBYTES];
-  polyvec sp, pkpv, ep, at[KYBER_K], b;
+  polyvec sp, ep, at[KYBER_K], b;
+  polyvec_mulcache spc;
   poly v, k, epp;
 } GenericIndcpaEncData_t;
 
 TaskFunction_t indcpa_enc_dual_0(void *xStruct) {
   GenericIndcpaEncData_t * data = (GenericIndcpaEncData_t *) xStruct;
   while(1) {
-    unpack_pk(&data->pkpv, data->seed, data->pk);
-
-    xSemaphoreGive(Semaphore_core_0);
+    unpack_pk(data->seed, data->pk);
     gen_at(data->at, data->seed);
 
-    // uint8_t nonce = 0;
-    // for(unsigned int i=0;i<KYBER_K;i++)
-    //   poly_getnoise_eta1(data->sp.vec+i, data->coins, nonce++);
-    // polyvec_ntt(&data->sp);
-
-    xSemaphoreTake(Semaphore_core_1, 1);
+    xSemaphoreTake(Semaphore_core_1, portMAX_DELAY); //wait until core_1 has sp
 
     // matrix-vector multiplication
-    for(unsigned int i=0;i<KYBER_K;i++)
-      polyvec_basemul_acc_montgomery(&data->b.vec[i], &data->at[i], &data->sp);
-
-    polyvec_invntt_tomont(&data->b);
-
-    // for(unsigned int i=0;i<KYBER_K;i++)
-    //   poly_getnoise_eta2(data->ep.vec+i, data->coins, nonce++);
+    polyvec_matvec(&data->b, data->at, &data->sp, &data->spc);
 
-    xSemaphoreTake(Semaphore_core_1, 1);
+    xSemaphoreTake(Semaphore_core_1, portMAX_DELAY); //wait until core_1 has ep
 
-    polyvec_add(&data->b, &data->b, &data->ep);
-    polyvec_reduce(&data->b);
+    // invntt, add ep, reduce and compress b into c in one pass
+    polyvec_invntt_add_compress(data->c, &data->b, &data->ep);
+    // v is compressed into c by core 1
 
-
-    // poly_getnoise_eta2(&data->epp, data->coins, nonce++);
-
-    // poly_frommsg(&data->k, data->m);
-    // poly_add(&data->epp, &data->epp, &data->k);
-
-    // polyvec_basemul_acc_montgomery(&data->v, &data->pkpv, &data->sp);
-    // poly_invntt_tomont(&data->v);
-
-    // poly_add(&data->v, &data->v, &data->epp);
-    // poly_reduce(&data->v);
-
-    xSemaphoreTake(Semaphore_core_1, 1);
-
-    pack_ciphertext(data->c, &data->b, &data->v);
-    
+    record_stack_watermark(0);
     xSemaphoreGive(Semaphore_core_done); //give sign, that task is done
     vTaskDelete(NULL);    // Delete the task using the xHandle_1
   }
@@ -465,47 +992,47 @@ TaskFunction_t indcpa_enc_dual_1(void *xStruct) {
   GenericIndcpaEncData_t * data = (GenericIndcpaEncData_t *) xStruct;
   while(1) {
     uint8_t nonce = 0;
+#ifdef KYBER_90S
+    prf_key key;
+    prf_key_init(&key, data->coins);
+    for(unsigned int i=0;i<KYBER_K;i++)
+      poly_getnoise_eta1_keyed(data->sp.vec+i, &key, nonce++);
+#else
     for(unsigned int i=0;i<KYBER_K;i++)
       poly_getnoise_eta1(data->sp.vec+i, data->coins, nonce++);
+#endif
     polyvec_ntt(&data->sp);
+    polyvec_mulcache_compute(&data->spc, &data->sp);
 
     xSemaphoreGive(Semaphore_core_1);
     
+#ifdef KYBER_90S
+    for(unsigned int i=0;i<KYBER_K;i++)
+      poly_getnoise_eta2_keyed(data->ep.vec+i, &key, nonce++);
+#else
     for(unsigned int i=0;i<KYBER_K;i++)
       poly_getnoise_eta2(data->ep.vec+i, data->coins, nonce++);
+#endif
 
     xSemaphoreGive(Semaphore_core_1);
 
+#ifdef KYBER_90S
+    poly_getnoise_eta2_keyed(&data->epp, &key, nonce++);
+    prf_key_free(&key);
+#else
     poly_getnoise_eta2(&data->epp, data->coins, nonce++);
+#endif
 
     poly_frommsg(&data->k, data->m);
     poly_add(&data->epp, &data->epp, &data->k);
 
-    // unpack_pk(&data->pkpv, data->seed, data->pk);
-    // gen_at(data->at, data->seed);
+    // v reads the packed public key directly, no need to wait for core 0
+    polyvec_basemul_acc_packed(&data->v, data->pk, &data->sp, &data->spc);
 
-    xSemaphoreTake(Semaphore_core_0, portMAX_DELAY);
+    // invntt, add epp, reduce and compress v into c in one pass
+    poly_invntt_add_compress(data->c+KYBER_POLYVECCOMPRESSEDBYTES, &data->v, &data->epp);
 
-    polyvec_basemul_acc_montgomery(&data->v, &data->pkpv, &data->sp);
-    poly_invntt_tomont(&data->v);
-    
-    poly_add(&data->v, &data->v, &data->epp);
-    
-    poly_reduce(&data->v);
-
-    xSemaphoreGive(Semaphore_core_1);
-
-    // matrix-vector multiplication
-    // for(unsigned int i=0;i<KYBER_K;i++)
-    //   polyvec_basemul_acc_montgomery(&data->b.vec[i], &data->at[i], &data->sp);
-
-    // polyvec_invntt_tomont(&data->b);
-
-    // polyvec_add(&data->b, &data->b, &data->ep);
-    // polyvec_reduce(&data->b);
-    
-    // pack_ciphertext(data->c, &data->b, &data->v);
-    
+    record_stack_watermark(1);
     xSemaphoreGive(Semaphore_core_done);
     vTaskDelete(NULL);    
   }
@@ -518,8 +1045,7 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
 {
   GenericIndcpaEncData_t xStruct = { .c = c, .m = m, .pk = pk, .coins = coins };
 
-  Semaphore_core_0 = xSemaphoreCreateCounting(1, 0);
-  Semaphore_core_1 = xSemaphoreCreateCounting(3, 0);
+  Semaphore_core_1 = xSemaphoreCreateCounting(2, 0);
   Semaphore_core_done = xSemaphoreCreateCounting(2, 0);
 
   TaskHandle_t xHandle_0 = NULL;
@@ -530,7 +1056,7 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
   xReturned_0 = xTaskCreatePinnedToCore(
                   indcpa_enc_dual_0,       /* Function that implements the task. */
                   "indcpa_enc_dual_0",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_0, /* Used to pass out the created task's handle. */
@@ -539,7 +1065,7 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
   xReturned_1 = xTaskCreatePinnedToCore(
                   indcpa_enc_dual_1,       /* Function that implements the task. */
                   "indcpa_enc_dual_1",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_1, /* Used to pass out the created task's handle. */
@@ -548,7 +1074,6 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
   xSemaphoreTake(Semaphore_core_done, portMAX_DELAY); //wait until both tasks finish
   xSemaphoreTake(Semaphore_core_done, portMAX_DELAY); //wait until both tasks finish
 
-  vSemaphoreDelete(Semaphore_core_0);
   vSemaphoreDelete(Semaphore_core_1);
   vSemaphoreDelete(Semaphore_core_done);
 }
@@ -558,42 +1083,67 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
                 const uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
                 const uint8_t coins[KYBER_SYMBYTES])
 {
-  unsigned int i;
   uint8_t seed[KYBER_SYMBYTES];
-  uint8_t nonce = 0;
-  polyvec sp, pkpv, ep, at[KYBER_K], b;
-  poly v, k, epp;
+#if (INDCPA_STREAM_MATRIX == 1)
+  unpack_pk(seed, pk);
+  enc_at(c, m, NULL, seed, pk, coins);
+#else
+  polyvec at[KYBER_K];
 
-  unpack_pk(&pkpv, seed, pk);
-  poly_frommsg(&k, m);
+  unpack_pk(seed, pk);
   gen_at(at, seed);
+  enc_at(c, m, at, seed, pk, coins);
+#endif
+}
+#endif
 
-  for(i=0;i<KYBER_K;i++)
-    poly_getnoise_eta1(sp.vec+i, coins, nonce++);
-  for(i=0;i<KYBER_K;i++)
-    poly_getnoise_eta2(ep.vec+i, coins, nonce++);
-  poly_getnoise_eta2(&epp, coins, nonce++);
-
-  polyvec_ntt(&sp);
-
-  // matrix-vector multiplication
-  for(i=0;i<KYBER_K;i++)
-    polyvec_basemul_acc_montgomery(&b.vec[i], &at[i], &sp);
-
-  polyvec_basemul_acc_montgomery(&v, &pkpv, &sp);
-
-  polyvec_invntt_tomont(&b);
-  poly_invntt_tomont(&v);
+/*************************************************
+* Name:        indcpa_pk_prepare
+*
+* Description: Expands a public key for repeated encryption: generates
+*              the matrix A^T once and keeps t in its packed form
+*
+* Arguments:   - indcpa_pk_prepared *p: pointer to output prepared key
+*              - const uint8_t *pk: pointer to input public key
+*                                   (of length KYBER_INDCPA_PUBLICKEYBYTES)
+**************************************************/
+void indcpa_pk_prepare(indcpa_pk_prepared *p,
+                       const uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES])
+{
+  size_t i;
+  uint8_t seed[KYBER_SYMBYTES];
 
-  polyvec_add(&b, &b, &ep);
-  poly_add(&v, &v, &epp);
-  poly_add(&v, &v, &k);
-  polyvec_reduce(&b);
-  poly_reduce(&v);
+  unpack_pk(seed, pk);
+  gen_at(p->at, seed);
+  for(i=0;i<KYBER_POLYVECBYTES;i++)
+    p->t[i] = pk[i];
+}
 
-  pack_ciphertext(c, &b, &v);
+/*************************************************
+* Name:        indcpa_enc_prepared
+*
+* Description: indcpa_enc with a public key prepared by
+*              indcpa_pk_prepare; same output, without unpacking the
+*              key or generating A^T. Runs on one core also with
+*              INDCPA_ENC_DUAL, which only overlaps gen_at with the
+*              noise sampling.
+*
+* Arguments:   - uint8_t *c: pointer to output ciphertext
+*                            (of length KYBER_INDCPA_BYTES bytes)
+*              - const uint8_t *m: pointer to input message
+*                                  (of length KYBER_INDCPA_MSGBYTES bytes)
+*              - const indcpa_pk_prepared *p: pointer to input prepared key
+*              - const uint8_t *coins: pointer to input random coins used as seed
+*                                      (of length KYBER_SYMBYTES) to deterministically
+*                                      generate all randomness
+**************************************************/
+void indcpa_enc_prepared(uint8_t c[KYBER_INDCPA_BYTES],
+                         const uint8_t m[KYBER_INDCPA_MSGBYTES],
+                         const indcpa_pk_prepared *p,
+                         const uint8_t coins[KYBER_SYMBYTES])
+{
+  enc_at(c, m, p->at, NULL, p->t, coins);
 }
-#endif
 
 /*************************************************
 * Name:        indcpa_dec
@@ -615,21 +1165,20 @@ typedef struct IndcpaDecData_t
   const uint8_t *c;
   const uint8_t *sk;
   
-  polyvec b, skpv;
+  polyvec b;
+  polyvec_mulcache bc;
   poly v, mp;
 } GenericIndcpaDecData_t;
 
 TaskFunction_t indcpa_dec_dual_0(void *xStruct) {
   GenericIndcpaDecData_t * data = (GenericIndcpaDecData_t *) xStruct;
   while(1) {
-    unpack_sk(&data->skpv, data->sk);
     poly_decompress(&data->v, data->c+KYBER_POLYVECCOMPRESSEDBYTES);
 
-    //polyvec_decompress(&data->b, data->c);
-    //polyvec_ntt(&data->b);
     xSemaphoreTake(Semaphore_core_1, portMAX_DELAY);
-    
-    polyvec_basemul_acc_montgomery(&data->mp, &data->skpv, &data->b);
+
+    // s is read packed from sk
+    polyvec_basemul_acc_packed(&data->mp, data->sk, &data->b, &data->bc);
     poly_invntt_tomont(&data->mp);
 
     poly_sub(&data->mp, &data->v, &data->mp);
@@ -637,6 +1186,7 @@ TaskFunction_t indcpa_dec_dual_0(void *xStruct) {
 
     poly_tomsg(data->m, &data->mp);
 
+    record_stack_watermark(0);
     xSemaphoreGive(Semaphore_core_done);
     vTaskDelete(NULL);    
   }
@@ -645,20 +1195,12 @@ TaskFunction_t indcpa_dec_dual_0(void *xStruct) {
 TaskFunction_t indcpa_dec_dual_1(void *xStruct) {
   GenericIndcpaDecData_t * data = (GenericIndcpaDecData_t *) xStruct;
   while(1) {
-    polyvec_decompress(&data->b, data->c);
-    polyvec_ntt(&data->b);
+    polyvec_decompress_ntt(&data->b, data->c);
+    polyvec_mulcache_compute(&data->bc, &data->b);
 
-    //unpack_sk(&data->skpv, data->sk);
     xSemaphoreGive(Semaphore_core_1);
-    
-    // polyvec_basemul_acc_montgomery(&data->mp, &data->skpv, &data->b);
-    // poly_invntt_tomont(&data->mp);
-
-    // poly_sub(&data->mp, &data->v, &data->mp);
-    // poly_reduce(&data->mp);
-
-    // poly_tomsg(data->m, &data->mp);
 
+    record_stack_watermark(1);
     xSemaphoreGive(Semaphore_core_done);
     vTaskDelete(NULL);    
   }
@@ -669,7 +1211,6 @@ void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
                 const uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES])
 {
   GenericIndcpaDecData_t xStruct = {.m = m, .c = c, .sk = sk};
-  Semaphore_core_0 = xSemaphoreCreateCounting(1, 0);
   Semaphore_core_1 = xSemaphoreCreateCounting(1, 0);
   Semaphore_core_done = xSemaphoreCreateCounting(2, 0);
 
@@ -681,7 +1222,7 @@ void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
   xReturned_0 = xTaskCreatePinnedToCore(
                   indcpa_dec_dual_0,       /* Function that implements the task. */
                   "indcpa_dec_dual_0",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_0, /* Used to pass out the created task's handle. */
@@ -690,7 +1231,7 @@ void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
   xReturned_1 = xTaskCreatePinnedToCore(
                   indcpa_dec_dual_1,       /* Function that implements the task. */
                   "indcpa_dec_dual_1",          /* Text name for the task. */
-                  20000,      /* Stack size in words, not bytes. */
+                  INDCPA_SUBTASK_STACK_SIZE, /* Stack size in words, not bytes. */
                   ( void * ) &xStruct,    /* Parameter passed into the task. */
                   INDCPA_SUBTASK_PRIORITY, /* Priority at which the task is created. */
                   &xHandle_1, /* Used to pass out the created task's handle. */
@@ -699,7 +1240,6 @@ void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
   xSemaphoreTake(Semaphore_core_done, portMAX_DELAY); //wait until both tasks finish
   xSemaphoreTake(Semaphore_core_done, portMAX_DELAY); //wait until both tasks finish
 
-  vSemaphoreDelete(Semaphore_core_0);
   vSemaphoreDelete(Semaphore_core_1);
   vSemaphoreDelete(Semaphore_core_done);
 }
@@ -708,14 +1248,15 @@ void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
                 const uint8_t c[KYBER_INDCPA_BYTES],
                 const uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES])
 {
-  polyvec b, skpv;
+  polyvec b;
+  polyvec_mulcache bc;
   poly v, mp;
 
   unpack_ciphertext(&b, &v, c);
-  unpack_sk(&skpv, sk);
 
-  polyvec_ntt(&b);
-  polyvec_basemul_acc_montgomery(&mp, &skpv, &b);
+  /* s is read packed from sk, as the public key in indcpa_enc */
+  polyvec_mulcache_compute(&bc, &b);
+  polyvec_basemul_acc_packed(&mp, sk, &b, &bc);
   poly_invntt_tomont(&mp);
 
   poly_sub(&mp, &v, &mp);
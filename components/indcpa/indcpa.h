@@ -5,11 +5,26 @@
 #include "params.h"
 #include "polyvec.h"
 
+/* With INDCPA_STREAM_MATRIX=1 the single-core indcpa_keypair and
+ * indcpa_enc never store the matrix A (KYBER_K^2*512 bytes): its entries
+ * are generated one at a time inside the matrix-vector product. The
+ * dual-core variants share A between the two subtasks and always store
+ * it */
+#if ((INDCPA_KEYPAIR_DUAL == 1) || (INDCPA_ENC_DUAL == 1) || (INDCPA_DEC_DUAL == 1)) && (INDCPA_STACK_WATERMARK == 1)
+/* Least free stack (uxTaskGetStackHighWaterMark) of the indcpa subtasks
+ * on core 0 and core 1 over all calls so far */
+extern uint32_t indcpa_stack_watermark[2];
+#endif
+
 #define gen_matrix KYBER_NAMESPACE(gen_matrix)
 void gen_matrix(polyvec *a, const uint8_t seed[KYBER_SYMBYTES], int transposed);
 #define indcpa_keypair KYBER_NAMESPACE(indcpa_keypair)
 void indcpa_keypair(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
                     uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES]);
+#define indcpa_keypair_derand KYBER_NAMESPACE(indcpa_keypair_derand)
+void indcpa_keypair_derand(uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
+                           uint8_t sk[KYBER_INDCPA_SECRETKEYBYTES],
+                           const uint8_t coins[KYBER_SYMBYTES]);
 
 #define indcpa_enc KYBER_NAMESPACE(indcpa_enc)
 void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
@@ -17,6 +32,23 @@ void indcpa_enc(uint8_t c[KYBER_INDCPA_BYTES],
                 const uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES],
                 const uint8_t coins[KYBER_SYMBYTES]);
 
+/* Public key expanded for repeated encryption: A^T in the NTT domain
+ * and t, which stays packed (read by polyvec_basemul_acc_packed) */
+typedef struct {
+  polyvec at[KYBER_K];
+  uint8_t t[KYBER_POLYVECBYTES];
+} indcpa_pk_prepared;
+
+#define indcpa_pk_prepare KYBER_NAMESPACE(indcpa_pk_prepare)
+void indcpa_pk_prepare(indcpa_pk_prepared *p,
+                       const uint8_t pk[KYBER_INDCPA_PUBLICKEYBYTES]);
+
+#define indcpa_enc_prepared KYBER_NAMESPACE(indcpa_enc_prepared)
+void indcpa_enc_prepared(uint8_t c[KYBER_INDCPA_BYTES],
+                         const uint8_t m[KYBER_INDCPA_MSGBYTES],
+                         const indcpa_pk_prepared *p,
+                         const uint8_t coins[KYBER_SYMBYTES]);
+
 #define indcpa_dec KYBER_NAMESPACE(indcpa_dec)
 void indcpa_dec(uint8_t m[KYBER_INDCPA_MSGBYTES],
                 const uint8_t c[KYBER_INDCPA_BYTES],
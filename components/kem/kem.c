@@ -1,5 +1,6 @@
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "params.h"
 #include "kem.h"
 #include "indcpa.h"
@@ -24,16 +25,78 @@
 int crypto_kem_keypair(uint8_t *pk,
                        uint8_t *sk)
 {
-  size_t i;
-  indcpa_keypair(pk, sk);
-  for(i=0;i<KYBER_INDCPA_PUBLICKEYBYTES;i++)
-    sk[i+KYBER_INDCPA_SECRETKEYBYTES] = pk[i];
-  hash_h(sk+KYBER_SECRETKEYBYTES-2*KYBER_SYMBYTES, pk, KYBER_PUBLICKEYBYTES);
-  /* Value z for pseudo-random output on reject */
-  esp_randombytes(sk+KYBER_SECRETKEYBYTES-KYBER_SYMBYTES, KYBER_SYMBYTES);
+  uint8_t coins[2*KYBER_SYMBYTES];
+  esp_randombytes(coins, 2*KYBER_SYMBYTES);
+  return crypto_kem_keypair_derand(pk, sk, coins);
+}
+
+/*************************************************
+* Name:        crypto_kem_keypair_derand
+*
+* Description: Deterministic crypto_kem_keypair: the key pair is a
+*              function of the coins only
+*
+* Arguments:   - uint8_t *pk: pointer to output public key
+*                (an already allocated array of KYBER_PUBLICKEYBYTES bytes)
+*              - uint8_t *sk: pointer to output private key
+*                (an already allocated array of KYBER_SECRETKEYBYTES bytes)
+*              - const uint8_t *coins: pointer to input randomness d || z
+*                (an already allocated array of 2*KYBER_SYMBYTES bytes)
+*
+* Returns 0 (success)
+**************************************************/
+int crypto_kem_keypair_derand(uint8_t *pk,
+                              uint8_t *sk,
+                              const uint8_t *coins)
+{
+  crypto_kem_sk_from_seed(sk, coins);
+  memcpy(pk, sk+KYBER_INDCPA_SECRETKEYBYTES, KYBER_PUBLICKEYBYTES);
+  return 0;
+}
+
+/*************************************************
+* Name:        crypto_kem_keypair_seed
+*
+* Description: Generates a public key and the seed-form private key it
+*              derives from
+*
+* Arguments:   - uint8_t *pk: pointer to output public key
+*                (an already allocated array of KYBER_PUBLICKEYBYTES bytes)
+*              - uint8_t *seed: pointer to output seed-form private key
+*                (an already allocated array of CRYPTO_SEEDKEYBYTES bytes)
+*
+* Returns 0 (success)
+**************************************************/
+int crypto_kem_keypair_seed(uint8_t *pk,
+                            uint8_t *seed)
+{
+  uint8_t s[KYBER_INDCPA_SECRETKEYBYTES];
+  esp_randombytes(seed, CRYPTO_SEEDKEYBYTES);
+  indcpa_keypair_derand(pk, s, seed);
   return 0;
 }
 
+/*************************************************
+* Name:        crypto_kem_sk_from_seed
+*
+* Description: Expands a seed-form private key into the full private
+*              key of crypto_kem_keypair_derand
+*
+* Arguments:   - uint8_t *sk: pointer to output private key
+*                (an already allocated array of KYBER_SECRETKEYBYTES bytes)
+*              - const uint8_t *seed: pointer to input seed-form key d || z
+*                (an already allocated array of CRYPTO_SEEDKEYBYTES bytes)
+**************************************************/
+void crypto_kem_sk_from_seed(uint8_t *sk,
+                             const uint8_t *seed)
+{
+  /* The public key is written straight to its place in sk */
+  indcpa_keypair_derand(sk+KYBER_INDCPA_SECRETKEYBYTES, sk, seed);
+  hash_h(sk+KYBER_SECRETKEYBYTES-2*KYBER_SYMBYTES, sk+KYBER_INDCPA_SECRETKEYBYTES, KYBER_PUBLICKEYBYTES);
+  /* Value z for pseudo-random output on reject */
+  memcpy(sk+KYBER_SECRETKEYBYTES-KYBER_SYMBYTES, seed+KYBER_SYMBYTES, KYBER_SYMBYTES);
+}
+
 /*************************************************
 * Name:        crypto_kem_enc
 *
@@ -75,6 +138,161 @@ int crypto_kem_enc(uint8_t *ct,
   return 0;
 }
 
+/*************************************************
+* Name:        crypto_kem_pk_prepare
+*
+* Description: Prepares a public key for crypto_kem_enc_prepared:
+*              expands A^T and caches H(pk)
+*
+* Arguments:   - kyber_pk_prepared *p: pointer to output prepared key
+*              - const uint8_t *pk: pointer to input public key
+*                (an already allocated array of KYBER_PUBLICKEYBYTES bytes)
+**************************************************/
+void crypto_kem_pk_prepare(kyber_pk_prepared *p,
+                           const uint8_t *pk)
+{
+  indcpa_pk_prepare(&p->indcpa, pk);
+  hash_h(p->hpk, pk, KYBER_PUBLICKEYBYTES);
+}
+
+/*************************************************
+* Name:        crypto_kem_enc_prepared
+*
+* Description: crypto_kem_enc with a public key prepared by
+*              crypto_kem_pk_prepare
+*
+* Arguments:   - uint8_t *ct: pointer to output cipher text
+*                (an already allocated array of KYBER_CIPHERTEXTBYTES bytes)
+*              - uint8_t *ss: pointer to output shared secret
+*                (an already allocated array of KYBER_SSBYTES bytes)
+*              - const kyber_pk_prepared *p: pointer to input prepared key
+*
+* Returns 0 (success)
+**************************************************/
+int crypto_kem_enc_prepared(uint8_t *ct,
+                            uint8_t *ss,
+                            const kyber_pk_prepared *p)
+{
+  uint8_t buf[KYBER_SYMBYTES];
+  /* Will contain key, coins */
+  uint8_t kr[2*KYBER_SYMBYTES];
+
+  esp_randombytes(buf, KYBER_SYMBYTES);
+  /* Don't release system RNG output */
+  hash_h(buf, buf, KYBER_SYMBYTES);
+
+  /* Multitarget countermeasure for coins + contributory KEM */
+  hash_g2(kr, buf, p->hpk);
+
+  /* coins are in kr+KYBER_SYMBYTES */
+  indcpa_enc_prepared(ct, buf, &p->indcpa, kr+KYBER_SYMBYTES);
+
+  /* overwrite coins in kr with H(c) */
+  hash_h(kr+KYBER_SYMBYTES, ct, KYBER_CIPHERTEXTBYTES);
+  /* hash concatenation of pre-k and H(c) to k */
+  kdf(ss, kr, 2*KYBER_SYMBYTES);
+  return 0;
+}
+
+/*************************************************
+* Name:        crypto_kem_pk_cache_init
+*
+* Description: Empties a cache of prepared public keys
+*
+* Arguments:   - kyber_pk_cache *cache: pointer to the cache
+**************************************************/
+void crypto_kem_pk_cache_init(kyber_pk_cache *cache)
+{
+  size_t i;
+  for(i=0;i<KYBER_PK_CACHE_ENTRIES;i++)
+    cache->last_use[i] = 0;
+  cache->clock = 0;
+}
+
+/*************************************************
+* Name:        crypto_kem_pk_cache_get
+*
+* Description: Looks up a public key by its fingerprint H(pk). On a
+*              miss the key is prepared into an empty slot or, if there
+*              is none, into the least recently used one.
+*
+* Arguments:   - kyber_pk_cache *cache: pointer to the cache
+*              - const uint8_t *pk: pointer to input public key
+*                (an already allocated array of KYBER_PUBLICKEYBYTES bytes)
+*
+* Returns a pointer to the prepared key, valid until the next call
+**************************************************/
+const kyber_pk_prepared *crypto_kem_pk_cache_get(kyber_pk_cache *cache,
+                                                 const uint8_t *pk)
+{
+  size_t i, j, slot = 0;
+  int hit = 0;
+  uint32_t rank[KYBER_PK_CACHE_ENTRIES];
+  uint8_t hpk[KYBER_SYMBYTES];
+
+  hash_h(hpk, pk, KYBER_PUBLICKEYBYTES);
+
+  for(i=0;i<KYBER_PK_CACHE_ENTRIES && !hit;i++) {
+    if(cache->last_use[i] != 0 && memcmp(cache->key[i].hpk, hpk, KYBER_SYMBYTES) == 0) {
+      slot = i;
+      hit = 1;
+    }
+    else if(cache->last_use[i] < cache->last_use[slot])
+      slot = i;
+  }
+
+  if(!hit) {
+    indcpa_pk_prepare(&cache->key[slot].indcpa, pk);
+    memcpy(cache->key[slot].hpk, hpk, KYBER_SYMBYTES);
+  }
+
+  /* Before the clock wraps, renumber the used slots 1, 2, ... in the
+   * order of their last use */
+  if(cache->clock == UINT32_MAX) {
+    for(i=0;i<KYBER_PK_CACHE_ENTRIES;i++) {
+      rank[i] = 0;
+      if(cache->last_use[i] == 0)
+        continue;
+      for(j=0;j<KYBER_PK_CACHE_ENTRIES;j++)
+        if(cache->last_use[j] != 0 && cache->last_use[j] <= cache->last_use[i])
+          rank[i]++;
+    }
+    cache->clock = 0;
+    for(i=0;i<KYBER_PK_CACHE_ENTRIES;i++) {
+      cache->last_use[i] = rank[i];
+      if(rank[i] > cache->clock)
+        cache->clock = rank[i];
+    }
+  }
+  cache->last_use[slot] = ++cache->clock;
+  return &cache->key[slot];
+}
+
+/*************************************************
+* Name:        crypto_kem_enc_cached
+*
+* Description: crypto_kem_enc through a cache of prepared public keys:
+*              repeated encapsulations to a cached key skip the
+*              expansion of A^T
+*
+* Arguments:   - uint8_t *ct: pointer to output cipher text
+*                (an already allocated array of KYBER_CIPHERTEXTBYTES bytes)
+*              - uint8_t *ss: pointer to output shared secret
+*                (an already allocated array of KYBER_SSBYTES bytes)
+*              - const uint8_t *pk: pointer to input public key
+*                (an already allocated array of KYBER_PUBLICKEYBYTES bytes)
+*              - kyber_pk_cache *cache: pointer to the cache
+*
+* Returns 0 (success)
+**************************************************/
+int crypto_kem_enc_cached(uint8_t *ct,
+                          uint8_t *ss,
+                          const uint8_t *pk,
+                          kyber_pk_cache *cache)
+{
+  return crypto_kem_enc_prepared(ct, ss, crypto_kem_pk_cache_get(cache, pk));
+}
+
 /*************************************************
 * Name:        crypto_kem_dec
 *
@@ -96,9 +314,8 @@ int crypto_kem_dec(uint8_t *ss,
                    const uint8_t *ct,
                    const uint8_t *sk)
 {
-  size_t i;
   int fail;
-  uint8_t buf[2*KYBER_SYMBYTES];
+  uint8_t buf[KYBER_SYMBYTES];
   /* Will contain key, coins */
   uint8_t kr[2*KYBER_SYMBYTES];
   uint8_t cmp[KYBER_CIPHERTEXTBYTES];
@@ -106,10 +323,9 @@ int crypto_kem_dec(uint8_t *ss,
 
   indcpa_dec(buf, ct, sk);
 
-  /* Multitarget countermeasure for coins + contributory KEM */
-  for(i=0;i<KYBER_SYMBYTES;i++)
-    buf[KYBER_SYMBYTES+i] = sk[KYBER_SECRETKEYBYTES-2*KYBER_SYMBYTES+i];
-  hash_g(kr, buf, 2*KYBER_SYMBYTES);
+  /* Multitarget countermeasure for coins + contributory KEM;
+   * H(pk) is hashed straight from sk */
+  hash_g2(kr, buf, sk+KYBER_SECRETKEYBYTES-2*KYBER_SYMBYTES);
 
   /* coins are in kr+KYBER_SYMBYTES */
   indcpa_enc(cmp, buf, pk, kr+KYBER_SYMBYTES);
@@ -126,3 +342,138 @@ int crypto_kem_dec(uint8_t *ss,
   kdf(ss, kr, 2*KYBER_SYMBYTES);
   return 0;
 }
+
+/*************************************************
+* Name:        crypto_kem_sk_expand
+*
+* Description: Expands a secret key for crypto_kem_dec_expanded:
+*              generates A^T of the embedded public key; s, H(pk) and
+*              z are copied from sk
+*
+* Arguments:   - kyber_sk_expanded *e: pointer to output expanded key
+*              - const uint8_t *sk: pointer to input private key
+*                (an already allocated array of KYBER_SECRETKEYBYTES bytes)
+**************************************************/
+void crypto_kem_sk_expand(kyber_sk_expanded *e,
+                          const uint8_t *sk)
+{
+  memcpy(e->s, sk, KYBER_INDCPA_SECRETKEYBYTES);
+  indcpa_pk_prepare(&e->pk.indcpa, sk+KYBER_INDCPA_SECRETKEYBYTES);
+  memcpy(e->pk.hpk, sk+KYBER_SECRETKEYBYTES-2*KYBER_SYMBYTES, KYBER_SYMBYTES);
+  memcpy(e->z, sk+KYBER_SECRETKEYBYTES-KYBER_SYMBYTES, KYBER_SYMBYTES);
+}
+
+/*************************************************
+* Name:        crypto_kem_dec_expanded
+*
+* Description: crypto_kem_dec with a secret key expanded by
+*              crypto_kem_sk_expand; same output, the re-encryption
+*              uses the prepared public key
+*
+* Arguments:   - uint8_t *ss: pointer to output shared secret
+*                (an already allocated array of KYBER_SSBYTES bytes)
+*              - const uint8_t *ct: pointer to input cipher text
+*                (an already allocated array of KYBER_CIPHERTEXTBYTES bytes)
+*              - const kyber_sk_expanded *e: pointer to input expanded key
+*
+* Returns 0.
+*
+* On failure, ss will contain a pseudo-random value.
+**************************************************/
+int crypto_kem_dec_expanded(uint8_t *ss,
+                            const uint8_t *ct,
+                            const kyber_sk_expanded *e)
+{
+  int fail;
+  uint8_t buf[KYBER_SYMBYTES];
+  /* Will contain key, coins */
+  uint8_t kr[2*KYBER_SYMBYTES];
+  uint8_t cmp[KYBER_CIPHERTEXTBYTES];
+
+  indcpa_dec(buf, ct, e->s);
+
+  /* Multitarget countermeasure for coins + contributory KEM */
+  hash_g2(kr, buf, e->pk.hpk);
+
+  /* coins are in kr+KYBER_SYMBYTES */
+  indcpa_enc_prepared(cmp, buf, &e->pk.indcpa, kr+KYBER_SYMBYTES);
+
+  fail = verify(ct, cmp, KYBER_CIPHERTEXTBYTES);
+
+  /* overwrite coins in kr with H(c) */
+  hash_h(kr+KYBER_SYMBYTES, ct, KYBER_CIPHERTEXTBYTES);
+
+  /* Overwrite pre-k with z on re-encryption failure */
+  cmov(kr, e->z, KYBER_SYMBYTES, fail);
+
+  /* hash concatenation of pre-k and H(c) to k */
+  kdf(ss, kr, 2*KYBER_SYMBYTES);
+  return 0;
+}
+
+/*************************************************
+* Name:        crypto_kem_sk_seed_init
+*
+* Description: Initializes a lazily expanded seed-form private key;
+*              no key material is derived until the first use
+*
+* Arguments:   - kyber_sk_seed *k: pointer to output key
+*              - const uint8_t *seed: pointer to input seed-form key
+*                (an already allocated array of CRYPTO_SEEDKEYBYTES bytes)
+**************************************************/
+void crypto_kem_sk_seed_init(kyber_sk_seed *k,
+                             const uint8_t *seed)
+{
+  memcpy(k->seed, seed, CRYPTO_SEEDKEYBYTES);
+  k->expanded = 0;
+}
+
+/*************************************************
+* Name:        crypto_kem_sk_seed_expand
+*
+* Description: Returns the expanded key of k, deriving it from the seed
+*              on the first call: the key generation of
+*              crypto_kem_keypair_derand followed by the A^T generation
+*              of crypto_kem_sk_expand
+*
+* Arguments:   - kyber_sk_seed *k: pointer to input/output key
+*
+* Returns a pointer to the expanded key inside k.
+**************************************************/
+const kyber_sk_expanded *crypto_kem_sk_seed_expand(kyber_sk_seed *k)
+{
+  uint8_t pk[KYBER_PUBLICKEYBYTES];
+
+  if(!k->expanded) {
+    indcpa_keypair_derand(pk, k->sk.s, k->seed);
+    indcpa_pk_prepare(&k->sk.pk.indcpa, pk);
+    hash_h(k->sk.pk.hpk, pk, KYBER_PUBLICKEYBYTES);
+    memcpy(k->sk.z, k->seed+KYBER_SYMBYTES, KYBER_SYMBYTES);
+    k->expanded = 1;
+  }
+  return &k->sk;
+}
+
+/*************************************************
+* Name:        crypto_kem_dec_seed
+*
+* Description: crypto_kem_dec with a seed-form private key; expands the
+*              key on first use, same output as crypto_kem_dec with
+*              the full key
+*
+* Arguments:   - uint8_t *ss: pointer to output shared secret
+*                (an already allocated array of KYBER_SSBYTES bytes)
+*              - const uint8_t *ct: pointer to input cipher text
+*                (an already allocated array of KYBER_CIPHERTEXTBYTES bytes)
+*              - kyber_sk_seed *k: pointer to input/output key
+*
+* Returns 0.
+*
+* On failure, ss will contain a pseudo-random value.
+**************************************************/
+int crypto_kem_dec_seed(uint8_t *ss,
+                        const uint8_t *ct,
+                        kyber_sk_seed *k)
+{
+  return crypto_kem_dec_expanded(ss, ct, crypto_kem_sk_seed_expand(k));
+}
@@ -3,11 +3,13 @@
 
 #include <stdint.h>
 #include "params.h"
+#include "indcpa.h"
 
 #define CRYPTO_SECRETKEYBYTES  KYBER_SECRETKEYBYTES
 #define CRYPTO_PUBLICKEYBYTES  KYBER_PUBLICKEYBYTES
 #define CRYPTO_CIPHERTEXTBYTES KYBER_CIPHERTEXTBYTES
 #define CRYPTO_BYTES           KYBER_SSBYTES
+#define CRYPTO_SEEDKEYBYTES    (2*KYBER_SYMBYTES)
 
 #if   (KYBER_K == 2)
 #ifdef KYBER_90S
@@ -32,10 +34,91 @@
 #define crypto_kem_keypair KYBER_NAMESPACE(keypair)
 int crypto_kem_keypair(uint8_t *pk, uint8_t *sk);
 
+#define crypto_kem_keypair_derand KYBER_NAMESPACE(keypair_derand)
+int crypto_kem_keypair_derand(uint8_t *pk, uint8_t *sk, const uint8_t *coins);
+
 #define crypto_kem_enc KYBER_NAMESPACE(enc)
 int crypto_kem_enc(uint8_t *ct, uint8_t *ss, const uint8_t *pk);
 
 #define crypto_kem_dec KYBER_NAMESPACE(dec)
 int crypto_kem_dec(uint8_t *ss, const uint8_t *ct, const uint8_t *sk);
 
+/* Public key prepared for repeated encapsulation to the same peer:
+ * the expanded matrix A^T, t and H(pk), so crypto_kem_enc_prepared
+ * neither hashes the key nor generates A^T. KYBER_K^2*512 +
+ * KYBER_POLYVECBYTES + 32 bytes (2.9 KB at K=2, 9.8 KB at K=4) */
+typedef struct {
+  indcpa_pk_prepared indcpa;
+  uint8_t hpk[KYBER_SYMBYTES];
+} kyber_pk_prepared;
+
+#define crypto_kem_pk_prepare KYBER_NAMESPACE(pk_prepare)
+void crypto_kem_pk_prepare(kyber_pk_prepared *p, const uint8_t *pk);
+
+#define crypto_kem_enc_prepared KYBER_NAMESPACE(enc_prepared)
+int crypto_kem_enc_prepared(uint8_t *ct, uint8_t *ss, const kyber_pk_prepared *p);
+
+/* Bounded LRU cache of prepared public keys, keyed by the fingerprint
+ * H(pk). Its size is fixed at compile time; the caller owns the memory
+ * and serializes access to it */
+#ifndef KYBER_PK_CACHE_ENTRIES
+#define KYBER_PK_CACHE_ENTRIES 4
+#endif
+
+typedef struct {
+  kyber_pk_prepared key[KYBER_PK_CACHE_ENTRIES];
+  uint32_t last_use[KYBER_PK_CACHE_ENTRIES]; /* 0: empty slot */
+  uint32_t clock;
+} kyber_pk_cache;
+
+#define crypto_kem_pk_cache_init KYBER_NAMESPACE(pk_cache_init)
+void crypto_kem_pk_cache_init(kyber_pk_cache *cache);
+
+#define crypto_kem_pk_cache_get KYBER_NAMESPACE(pk_cache_get)
+const kyber_pk_prepared *crypto_kem_pk_cache_get(kyber_pk_cache *cache, const uint8_t *pk);
+
+#define crypto_kem_enc_cached KYBER_NAMESPACE(enc_cached)
+int crypto_kem_enc_cached(uint8_t *ct, uint8_t *ss, const uint8_t *pk, kyber_pk_cache *cache);
+
+/* Secret key expanded for repeated decapsulation: s (packed, as in sk),
+ * the prepared public key for the re-encryption and z, so
+ * crypto_kem_dec_expanded does not generate A^T */
+typedef struct {
+  uint8_t s[KYBER_INDCPA_SECRETKEYBYTES];
+  kyber_pk_prepared pk;
+  uint8_t z[KYBER_SYMBYTES];
+} kyber_sk_expanded;
+
+#define crypto_kem_sk_expand KYBER_NAMESPACE(sk_expand)
+void crypto_kem_sk_expand(kyber_sk_expanded *e, const uint8_t *sk);
+
+#define crypto_kem_dec_expanded KYBER_NAMESPACE(dec_expanded)
+int crypto_kem_dec_expanded(uint8_t *ss, const uint8_t *ct, const kyber_sk_expanded *e);
+
+/* Seed-form secret key: the CRYPTO_SEEDKEYBYTES coins d || z of
+ * crypto_kem_keypair_derand, from which the full key is derived again
+ * when needed. Storage shrinks to 64 bytes at the cost of one key
+ * generation per expansion. A kyber_sk_seed expands on the first
+ * crypto_kem_dec_seed and keeps the expanded key for later calls */
+#define crypto_kem_keypair_seed KYBER_NAMESPACE(keypair_seed)
+int crypto_kem_keypair_seed(uint8_t *pk, uint8_t *seed);
+
+#define crypto_kem_sk_from_seed KYBER_NAMESPACE(sk_from_seed)
+void crypto_kem_sk_from_seed(uint8_t *sk, const uint8_t *seed);
+
+typedef struct {
+  uint8_t seed[CRYPTO_SEEDKEYBYTES];
+  int expanded;
+  kyber_sk_expanded sk;
+} kyber_sk_seed;
+
+#define crypto_kem_sk_seed_init KYBER_NAMESPACE(sk_seed_init)
+void crypto_kem_sk_seed_init(kyber_sk_seed *k, const uint8_t *seed);
+
+#define crypto_kem_sk_seed_expand KYBER_NAMESPACE(sk_seed_expand)
+const kyber_sk_expanded *crypto_kem_sk_seed_expand(kyber_sk_seed *k);
+
+#define crypto_kem_dec_seed KYBER_NAMESPACE(dec_seed)
+int crypto_kem_dec_seed(uint8_t *ss, const uint8_t *ct, kyber_sk_seed *k);
+
 #endif
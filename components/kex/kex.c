@@ -19,12 +19,9 @@ void kex_uake_sharedB(uint8_t *send, uint8_t *k, const uint8_t *recv, const uint
 
 void kex_uake_sharedA(uint8_t *k, const uint8_t *recv, const uint8_t *tk, const uint8_t *sk)
 {
-  unsigned int i;
-  uint8_t buf[2*CRYPTO_BYTES];
+  uint8_t buf[CRYPTO_BYTES];
   crypto_kem_dec(buf, recv, sk);
-  for(i=0;i<CRYPTO_BYTES;i++)
-    buf[i+CRYPTO_BYTES] = tk[i];
-  kdf(k, buf, 2*CRYPTO_BYTES);
+  kdf2(k, buf, CRYPTO_BYTES, tk, CRYPTO_BYTES);
 }
 
 void kex_ake_initA(uint8_t *send, uint8_t *tk, uint8_t *sk, const uint8_t *pkb)
@@ -44,11 +41,8 @@ void kex_ake_sharedB(uint8_t *send, uint8_t *k, const uint8_t* recv, const uint8
 
 void kex_ake_sharedA(uint8_t *k, const uint8_t *recv, const uint8_t *tk, const uint8_t *sk, const uint8_t *ska)
 {
-  unsigned int i;
-  uint8_t buf[3*CRYPTO_BYTES];
+  uint8_t buf[2*CRYPTO_BYTES];
   crypto_kem_dec(buf, recv, sk);
   crypto_kem_dec(buf+CRYPTO_BYTES, recv+CRYPTO_CIPHERTEXTBYTES, ska);
-  for(i=0;i<CRYPTO_BYTES;i++)
-    buf[i+2*CRYPTO_BYTES] = tk[i];
-  kdf(k, buf, 3*CRYPTO_BYTES);
+  kdf2(k, buf, 2*CRYPTO_BYTES, tk, CRYPTO_BYTES);
 }
@@ -2,6 +2,8 @@
 #include "params.h"
 #include "ntt.h"
 #include "reduce.h"
+#include "cpufeatures.h"
+#include "avx2.h"
 
 /* Code to generate zetas and zetas_inv used in the number-theoretic transform:
 
@@ -63,35 +65,743 @@ const int16_t zetas[128] = {
 * Arguments:   - int16_t a: first factor
 *              - int16_t b: second factor
 *
-* Returns 16-bit integer congruent to a*b*R^{-1} mod q
+* Returns 16-bit integer congruent to a*b*R^{-1} mod q.
+* Same as montgomery_reduce((int32_t)a*b), written out so that it is
+* inlined into the butterflies and their operands stay in registers.
 **************************************************/
-static int16_t fqmul(int16_t a, int16_t b) {
-  return montgomery_reduce((int32_t)a*b);
+static inline int16_t fqmul(int16_t a, int16_t b) {
+  int32_t p = (int32_t)a*b;
+  int16_t t = (int16_t)p*QINV;
+  return (p - (int32_t)t*KYBER_Q) >> 16;
+}
+
+#if (NTT_PLANTARD == 1)
+/* zetas for Plantard multiplication: zetas_plantard[i] = z*q^-1 mod 2^32
+ * with z = -zetas[i]*2^16 mod q (centered), so that
+ * fqmul_plantard(a, zetas_plantard[i]) == fqmul(a, zetas[i]) mod q:
+
+  for(i=0;i<128;i++) {
+    z = -zetas[i]*65536 % KYBER_Q;
+    if(z > KYBER_Q/2) z -= KYBER_Q;
+    if(z < -KYBER_Q/2) z += KYBER_Q;
+    zetas_plantard[i] = (uint32_t)z*PLANTARD_QINV;
+  }
+*/
+static const int32_t zetas_plantard[128] = {
+      1290167, -2064267850,  -966335387,   -51606696,  -886345008,   812805466,
+  -1847519726,  1094061961,  1370157786, -1819136043,   249002309,  1028263423,
+   -700560902,   -89021551,   734105254, -2042335004,   381889552, -1137927652,
+   1727534157,  1904287092,  -365117376,    72249375, -1404992306,  1719793153,
+   1839778722, -1593356747,   690239562,  -576704831, -1207596692,  -580575333,
+  -1748176836,  1059227441,   372858380,   427045412,   -98052723, -2029433330,
+   1544330385, -1322421592, -1357256112, -1643673276,   838608814, -1744306333,
+  -1052776604,   815385801,  -598637677,    42575524,  1703020976, -1824296713,
+  -1303069080,  1851390228,  1041165097,   583155668,  1855260730,  -594767174,
+   1979116801, -1195985186,  -879894171,  -918599193,  1910737929,   836028479,
+  -1103093132,  -282546662,  1583035408,  1174052340,    21932846,  -732815087,
+    752167598,  -877313836,  2112004044,   932791035, -1343064270,  1419184147,
+   1817845876,  -860541660,   -61928036,   300609006,   975366559, -1513366368,
+   -405112566,  -359956706, -2097812203,  2130066388,  -696690399, -1986857806,
+  -1912028096,  1228239371,  1884934581,  -828287475,  1211467195, -1317260922,
+  -1150829327, -1214047529,   945692709, -1279846067,   345764865,   826997308,
+   2043625172, -1330162596, -1666896289,  -140628247,   483812777, -1006330577,
+  -1598517417,  2122325384,  1371447953,   411563403,  -717333078,   976656727,
+  -1586905910,   723783915, -1113414472,  -948273044,  -677337888,  1408862808,
+    519937465,  1323711759,  1474661346, -1521107372,  -714752743,  1143088322,
+  -2073299022,  1563682897, -1877193576,  1327582261, -1572714068,  -508325958,
+   1141798155, -1515946703
+};
+
+/*************************************************
+* Name:        fqmul_plantard
+*
+* Description: Multiplication by a constant followed by Plantard reduction
+*
+* Arguments:   - int16_t a: first factor, any int16_t
+*              - int32_t zq: second factor z in Plantard form, z*q^-1 mod 2^32
+*                            with |z| <= q/2
+*
+* Returns 16-bit integer congruent to a*z*(-2^-32) mod q, in
+* {-(q+1)/2,...,(q+1)/2}. Same as plantard_reduce(a*zq), inlined.
+**************************************************/
+static inline int16_t fqmul_plantard(int16_t a, int32_t zq) {
+  int32_t t = (int32_t)((uint32_t)a*(uint32_t)zq);
+  return (((t >> 16) + 8) * KYBER_Q) >> 16;
+}
+#endif
+
+#if KYBER_X86_64
+/*
+ * AVX2 kernels, 16 coefficients per vector. The output order is the same
+ * as that of the portable code, so packed keys and ciphertexts do not
+ * change. The last three NTT layers (the first three of the inverse) pair
+ * coefficients inside one 32-coefficient block; that block is held in two
+ * vectors that are shuffled so that each butterfly pairs equal lanes:
+ *
+ *   len 8: X = coeffs 0-7 | 16-23,         Y = 8-15 | 24-31
+ *   len 4: X = 0-3, 8-11 | 16-19, 24-27,   Y = 4-7, 12-15 | 20-23, 28-31
+ *   len 2: X = 0-1, 4-5, 8-9, 12-13 | ..., Y = 2-3, 6-7, 10-11, 14-15 | ...
+ *
+ * zetas_avx2[c] holds the twiddles of block c in this lane order: the
+ * forward len 8, 4 and 2 layers followed by the inverse len 2, 4 and 8
+ * layers. zetas_basemul holds zetas[64+i] and -zetas[64+i] for the 128
+ * degree-one products of basemul_avx2.
+ */
+static const int16_t zetas_avx2[8][6][16] = {
+  {
+    {   573,   573,   573,   573,   573,   573,   573,   573, -1325, -1325, -1325, -1325, -1325, -1325, -1325, -1325 },
+    {  1223,  1223,  1223,  1223,   652,   652,   652,   652,  -552,  -552,  -552,  -552,  1015,  1015,  1015,  1015 },
+    { -1103, -1103,   430,   430,   555,   555,   843,   843, -1251, -1251,   871,   871,  1550,  1550,   105,   105 },
+    {  1628,  1628,  1522,  1522, -1460, -1460,   958,   958,   991,   991,   996,   996,  -308,  -308,  -108,  -108 },
+    { -1275, -1275, -1275, -1275,   677,   677,   677,   677, -1065, -1065, -1065, -1065,   448,   448,   448,   448 },
+    { -1571, -1571, -1571, -1571, -1571, -1571, -1571, -1571,  -205,  -205,  -205,  -205,  -205,  -205,  -205,  -205 }
+  },
+  {
+    {   264,   264,   264,   264,   264,   264,   264,   264,   383,   383,   383,   383,   383,   383,   383,   383 },
+    { -1293, -1293, -1293, -1293,  1491,  1491,  1491,  1491,  -282,  -282,  -282,  -282, -1544, -1544, -1544, -1544 },
+    {   422,   422,   587,   587,   177,   177,  -235,  -235,  -291,  -291,  -460,  -460,  1574,  1574,  1653,  1653 },
+    {   478,   478,  -870,  -870,  -854,  -854, -1510, -1510,   794,   794, -1278, -1278, -1530, -1530, -1185, -1185 },
+    {  -725,  -725,  -725,  -725, -1508, -1508, -1508, -1508,   961,   961,   961,   961,  -398,  -398,  -398,  -398 },
+    {   411,   411,   411,   411,   411,   411,   411,   411, -1542, -1542, -1542, -1542, -1542, -1542, -1542, -1542 }
+  },
+  {
+    {  -829,  -829,  -829,  -829,  -829,  -829,  -829,  -829,  1458,  1458,  1458,  1458,  1458,  1458,  1458,  1458 },
+    {   516,   516,   516,   516,    -8,    -8,    -8,    -8,  -320,  -320,  -320,  -320,  -666,  -666,  -666,  -666 },
+    {  -246,  -246,   778,   778,  1159,  1159,  -147,  -147,  -777,  -777,  1483,  1483,  -602,  -602,  1119,  1119 },
+    { -1659, -1659, -1187, -1187,   220,   220,  -874,  -874, -1335, -1335,  1218,  1218,  -136,  -136, -1215, -1215 },
+    {  -951,  -951,  -951,  -951,  -247,  -247,  -247,  -247, -1421, -1421, -1421, -1421,   107,   107,   107,   107 },
+    {   608,   608,   608,   608,   608,   608,   608,   608,   732,   732,   732,   732,   732,   732,   732,   732 }
+  },
+  {
+    { -1602, -1602, -1602, -1602, -1602, -1602, -1602, -1602,  -130,  -130,  -130,  -130,  -130,  -130,  -130,  -130 },
+    { -1618, -1618, -1618, -1618, -1162, -1162, -1162, -1162,   126,   126,   126,   126,  1469,  1469,  1469,  1469 },
+    { -1590, -1590,   644,   644,  -872,  -872,   349,   349,   418,   418,   329,   329,  -156,  -156,   -75,   -75 },
+    {   384,   384, -1465, -1465, -1285, -1285,  1322,  1322,   610,   610,   603,   603,  1097,  1097,   817,   817 },
+    {   830,   830,   830,   830,  -271,  -271,  -271,  -271,   -90,   -90,   -90,   -90,  -853,  -853,  -853,  -853 },
+    {  1017,  1017,  1017,  1017,  1017,  1017,  1017,  1017,  -681,  -681,  -681,  -681,  -681,  -681,  -681,  -681 }
+  },
+  {
+    {  -681,  -681,  -681,  -681,  -681,  -681,  -681,  -681,  1017,  1017,  1017,  1017,  1017,  1017,  1017,  1017 },
+    {  -853,  -853,  -853,  -853,   -90,   -90,   -90,   -90,  -271,  -271,  -271,  -271,   830,   830,   830,   830 },
+    {   817,   817,  1097,  1097,   603,   603,   610,   610,  1322,  1322, -1285, -1285, -1465, -1465,   384,   384 },
+    {   -75,   -75,  -156,  -156,   329,   329,   418,   418,   349,   349,  -872,  -872,   644,   644, -1590, -1590 },
+    {  1469,  1469,  1469,  1469,   126,   126,   126,   126, -1162, -1162, -1162, -1162, -1618, -1618, -1618, -1618 },
+    {  -130,  -130,  -130,  -130,  -130,  -130,  -130,  -130, -1602, -1602, -1602, -1602, -1602, -1602, -1602, -1602 }
+  },
+  {
+    {   732,   732,   732,   732,   732,   732,   732,   732,   608,   608,   608,   608,   608,   608,   608,   608 },
+    {   107,   107,   107,   107, -1421, -1421, -1421, -1421,  -247,  -247,  -247,  -247,  -951,  -951,  -951,  -951 },
+    { -1215, -1215,  -136,  -136,  1218,  1218, -1335, -1335,  -874,  -874,   220,   220, -1187, -1187, -1659, -1659 },
+    {  1119,  1119,  -602,  -602,  1483,  1483,  -777,  -777,  -147,  -147,  1159,  1159,   778,   778,  -246,  -246 },
+    {  -666,  -666,  -666,  -666,  -320,  -320,  -320,  -320,    -8,    -8,    -8,    -8,   516,   516,   516,   516 },
+    {  1458,  1458,  1458,  1458,  1458,  1458,  1458,  1458,  -829,  -829,  -829,  -829,  -829,  -829,  -829,  -829 }
+  },
+  {
+    { -1542, -1542, -1542, -1542, -1542, -1542, -1542, -1542,   411,   411,   411,   411,   411,   411,   411,   411 },
+    {  -398,  -398,  -398,  -398,   961,   961,   961,   961, -1508, -1508, -1508, -1508,  -725,  -725,  -725,  -725 },
+    { -1185, -1185, -1530, -1530, -1278, -1278,   794,   794, -1510, -1510,  -854,  -854,  -870,  -870,   478,   478 },
+    {  1653,  1653,  1574,  1574,  -460,  -460,  -291,  -291,  -235,  -235,   177,   177,   587,   587,   422,   422 },
+    { -1544, -1544, -1544, -1544,  -282,  -282,  -282,  -282,  1491,  1491,  1491,  1491, -1293, -1293, -1293, -1293 },
+    {   383,   383,   383,   383,   383,   383,   383,   383,   264,   264,   264,   264,   264,   264,   264,   264 }
+  },
+  {
+    {  -205,  -205,  -205,  -205,  -205,  -205,  -205,  -205, -1571, -1571, -1571, -1571, -1571, -1571, -1571, -1571 },
+    {   448,   448,   448,   448, -1065, -1065, -1065, -1065,   677,   677,   677,   677, -1275, -1275, -1275, -1275 },
+    {  -108,  -108,  -308,  -308,   996,   996,   991,   991,   958,   958, -1460, -1460,  1522,  1522,  1628,  1628 },
+    {   105,   105,  1550,  1550,   871,   871, -1251, -1251,   843,   843,   555,   555,   430,   430, -1103, -1103 },
+    {  1015,  1015,  1015,  1015,  -552,  -552,  -552,  -552,   652,   652,   652,   652,  1223,  1223,  1223,  1223 },
+    { -1325, -1325, -1325, -1325, -1325, -1325, -1325, -1325,   573,   573,   573,   573,   573,   573,   573,   573 }
+  }
+};
+
+static const int16_t zetas_basemul[128] = {
+  -1103,  1103,   430,  -430,   555,  -555,   843,  -843,
+  -1251,  1251,   871,  -871,  1550, -1550,   105,  -105,
+    422,  -422,   587,  -587,   177,  -177,  -235,   235,
+   -291,   291,  -460,   460,  1574, -1574,  1653, -1653,
+   -246,   246,   778,  -778,  1159, -1159,  -147,   147,
+   -777,   777,  1483, -1483,  -602,   602,  1119, -1119,
+  -1590,  1590,   644,  -644,  -872,   872,   349,  -349,
+    418,  -418,   329,  -329,  -156,   156,   -75,    75,
+    817,  -817,  1097, -1097,   603,  -603,   610,  -610,
+   1322, -1322, -1285,  1285, -1465,  1465,   384,  -384,
+  -1215,  1215,  -136,   136,  1218, -1218, -1335,  1335,
+   -874,   874,   220,  -220, -1187,  1187, -1659,  1659,
+  -1185,  1185, -1530,  1530, -1278,  1278,   794,  -794,
+  -1510,  1510,  -854,   854,  -870,   870,   478,  -478,
+   -108,   108,  -308,   308,   996,  -996,   991,  -991,
+    958,  -958, -1460,  1460,  1522, -1522,  1628, -1628
+};
+
+/* Montgomery multiplication by a constant b with bqinv = b*QINV mod 2^16;
+ * the same result as fqmul: the low halves of a*b and t*q cancel */
+TARGET_AVX2
+static inline __m256i fqmul_avx2(__m256i a, __m256i b, __m256i bqinv)
+{
+  __m256i t;
+
+  t = _mm256_mullo_epi16(a, bqinv);
+  t = _mm256_mulhi_epi16(t, _mm256_set1_epi16(KYBER_Q));
+  return _mm256_sub_epi16(_mm256_mulhi_epi16(a, b), t);
+}
+
+TARGET_AVX2
+static inline __m256i fqmulv_avx2(__m256i a, __m256i b)
+{
+  return fqmul_avx2(a, b, _mm256_mullo_epi16(b, _mm256_set1_epi16(QINV)));
+}
+
+#define BUTTERFLY(a, b, z, zq) do { \
+    __m256i t_ = fqmul_avx2(b, z, zq); \
+    b = _mm256_sub_epi16(a, t_); \
+    a = _mm256_add_epi16(a, t_); \
+  } while(0)
+
+#define INVBUTTERFLY(a, b, z, zq) do { \
+    __m256i t_ = a; \
+    a = _mm256_add_epi16(a, b); \
+    b = _mm256_sub_epi16(b, t_); \
+    b = fqmul_avx2(b, z, zq); \
+  } while(0)
+
+#define SETZETA(k) do { \
+    z = _mm256_set1_epi16(zetas[k]); \
+    zq = _mm256_set1_epi16((int16_t)(zetas[k]*QINV)); \
+  } while(0)
+
+/* (a, b) -> (x, y) of the len 8 layer and back */
+#define SHUFFLE8(x, y, a, b) do { \
+    x = _mm256_permute2x128_si256(a, b, 0x20); \
+    y = _mm256_permute2x128_si256(a, b, 0x31); \
+  } while(0)
+
+/* len 8 <-> len 4 layout, its own inverse */
+#define SHUFFLE4(x, y) do { \
+    __m256i t_ = _mm256_unpacklo_epi64(x, y); \
+    y = _mm256_unpackhi_epi64(x, y); \
+    x = t_; \
+  } while(0)
+
+/* len 4 <-> len 2 layout, its own inverse */
+#define SHUFFLE2(x, y) do { \
+    __m256i l_ = _mm256_unpacklo_epi32(x, y); \
+    __m256i h_ = _mm256_unpackhi_epi32(x, y); \
+    x = _mm256_unpacklo_epi64(l_, h_); \
+    y = _mm256_unpackhi_epi64(l_, h_); \
+  } while(0)
+
+/*************************************************
+* Name:        ntt_avx2
+*
+* Description: AVX2 version of ntt. Layer 1 is one pass over memory,
+*              layers 2-7 run in registers on each half of r.
+*              Performs the same operations as the portable code, so
+*              the output is identical.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+TARGET_AVX2
+static void ntt_avx2(int16_t r[256])
+{
+  __m256i x, y, z, zq;
+  unsigned int i;
+
+  SETZETA(1);
+  for(i = 0; i < 8; i++) {
+    x = _mm256_loadu_si256((const __m256i *)&r[16*i]);
+    y = _mm256_loadu_si256((const __m256i *)&r[16*i + 128]);
+    BUTTERFLY(x, y, z, zq);
+    _mm256_storeu_si256((__m256i *)&r[16*i], x);
+    _mm256_storeu_si256((__m256i *)&r[16*i + 128], y);
+  }
+  ntt_finish_avx2(r);
+}
+
+/*************************************************
+* Name:        ntt_finish_avx2
+*
+* Description: Layers 2-7 of ntt_avx2, in registers on each half of r,
+*              for callers that ran layer 1 (the butterflies of r[i]
+*              and r[i+128] with zetas[1]) on their own data in
+*              registers, as polyvec_decompress_ntt does
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+TARGET_AVX2
+void ntt_finish_avx2(int16_t r[256])
+{
+  const __m256i qinv = _mm256_set1_epi16(QINV);
+  __m256i v[8], x, y, z, zq;
+  unsigned int h, i;
+
+  for(h = 0; h < 2; h++) {
+    for(i = 0; i < 8; i++)
+      v[i] = _mm256_loadu_si256((const __m256i *)&r[128*h + 16*i]);
+
+    SETZETA(2 + h);
+    for(i = 0; i < 4; i++)
+      BUTTERFLY(v[i], v[i+4], z, zq);
+    for(i = 0; i < 4; i++) {
+      SETZETA(4 + 2*h + i/2);
+      BUTTERFLY(v[i + (i & 2)], v[i + (i & 2) + 2], z, zq);
+    }
+    for(i = 0; i < 4; i++) {
+      SETZETA(8 + 4*h + i);
+      BUTTERFLY(v[2*i], v[2*i+1], z, zq);
+    }
+
+    for(i = 0; i < 4; i++) {
+      const int16_t (*zb)[16] = zetas_avx2[4*h + i];
+
+      SHUFFLE8(x, y, v[2*i], v[2*i+1]);
+      z = _mm256_loadu_si256((const __m256i *)zb[0]);
+      BUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      SHUFFLE4(x, y);
+      z = _mm256_loadu_si256((const __m256i *)zb[1]);
+      BUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      SHUFFLE2(x, y);
+      z = _mm256_loadu_si256((const __m256i *)zb[2]);
+      BUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      SHUFFLE2(x, y);
+      SHUFFLE4(x, y);
+      SHUFFLE8(v[2*i], v[2*i+1], x, y);
+    }
+
+    for(i = 0; i < 8; i++)
+      _mm256_storeu_si256((__m256i *)&r[128*h + 16*i], v[i]);
+  }
+}
+
+/* Layers 1-6 of invntt_avx2, in registers on each half of r */
+TARGET_AVX2
+static void invntt_begin_avx2(int16_t r[256])
+{
+  const __m256i qinv = _mm256_set1_epi16(QINV);
+  __m256i v[8], x, y, z, zq;
+  unsigned int h, i;
+
+  for(h = 0; h < 2; h++) {
+    for(i = 0; i < 8; i++)
+      v[i] = _mm256_loadu_si256((const __m256i *)&r[128*h + 16*i]);
+
+    for(i = 0; i < 4; i++) {
+      const int16_t (*zb)[16] = zetas_avx2[4*h + i];
+
+      SHUFFLE8(x, y, v[2*i], v[2*i+1]);
+      SHUFFLE4(x, y);
+      SHUFFLE2(x, y);
+      z = _mm256_loadu_si256((const __m256i *)zb[3]);
+      INVBUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      SHUFFLE2(x, y);
+      z = _mm256_loadu_si256((const __m256i *)zb[4]);
+      INVBUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      SHUFFLE4(x, y);
+      z = _mm256_loadu_si256((const __m256i *)zb[5]);
+      INVBUTTERFLY(x, y, z, _mm256_mullo_epi16(z, qinv));
+      x = barrett_avx2(x);
+      SHUFFLE8(v[2*i], v[2*i+1], x, y);
+    }
+
+    for(i = 0; i < 4; i++) {
+      SETZETA(15 - 4*h - i);
+      INVBUTTERFLY(v[2*i], v[2*i+1], z, zq);
+    }
+    for(i = 0; i < 4; i++) {
+      SETZETA(7 - 2*h - i/2);
+      INVBUTTERFLY(v[i + (i & 2)], v[i + (i & 2) + 2], z, zq);
+    }
+    SETZETA(3 - h);
+    for(i = 0; i < 4; i++) {
+      INVBUTTERFLY(v[i], v[i+4], z, zq);
+      v[i] = barrett_avx2(v[i]);
+    }
+
+    for(i = 0; i < 8; i++)
+      _mm256_storeu_si256((__m256i *)&r[128*h + 16*i], v[i]);
+  }
+}
+
+/* Layer 7 with the scaling by f on x = r[k], y = r[k+128] */
+#define INVNTT_LAST_AVX2(x, y) do { \
+    const int16_t f = 1441; /* mont^2/128 */ \
+    const int16_t fz = 1397; /* fqmul(zetas[1], f) */ \
+    __m256i z_ = _mm256_add_epi16(x, y); \
+    y = _mm256_sub_epi16(y, x); \
+    x = fqmul_avx2(z_, _mm256_set1_epi16(f), _mm256_set1_epi16((int16_t)(f*QINV))); \
+    y = fqmul_avx2(y, _mm256_set1_epi16(fz), _mm256_set1_epi16((int16_t)(fz*QINV))); \
+  } while(0)
+
+/*************************************************
+* Name:        invntt_avx2
+*
+* Description: AVX2 version of invntt. Layers 1-6 run in registers on
+*              each half of r, layer 7 is one pass over memory and also
+*              multiplies by f. The sums are Barrett reduced only after
+*              layers 3 and 6 instead of in every layer, and f is folded
+*              into the twiddles of layer 7. Requires input coefficients
+*              of absolute value below q (as after poly_reduce); then no
+*              sum exceeds 8q. The output is congruent mod q to that of
+*              the portable code and below q in absolute value.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+TARGET_AVX2
+static void invntt_avx2(int16_t r[256])
+{
+  __m256i x, y;
+  unsigned int i;
+
+  invntt_begin_avx2(r);
+  for(i = 0; i < 8; i++) {
+    x = _mm256_loadu_si256((const __m256i *)&r[16*i]);
+    y = _mm256_loadu_si256((const __m256i *)&r[16*i + 128]);
+    INVNTT_LAST_AVX2(x, y);
+    _mm256_storeu_si256((__m256i *)&r[16*i], x);
+    _mm256_storeu_si256((__m256i *)&r[16*i + 128], y);
+  }
+}
+
+/* invntt_finish on AVX2: r[j..j+7] and r[j+64..j+71] share a vector */
+TARGET_AVX2
+static void invntt_finish_avx2(int16_t r[256], unsigned int j)
+{
+  __m256i x, y;
+
+  x = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&r[j])),
+                              _mm_loadu_si128((const __m128i *)&r[j + 64]), 1);
+  y = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&r[j + 128])),
+                              _mm_loadu_si128((const __m128i *)&r[j + 192]), 1);
+  INVNTT_LAST_AVX2(x, y);
+  _mm_storeu_si128((__m128i *)&r[j], _mm256_castsi256_si128(x));
+  _mm_storeu_si128((__m128i *)&r[j + 64], _mm256_extracti128_si256(x, 1));
+  _mm_storeu_si128((__m128i *)&r[j + 128], _mm256_castsi256_si128(y));
+  _mm_storeu_si128((__m128i *)&r[j + 192], _mm256_extracti128_si256(y, 1));
+}
+
+/* Loads 32 coefficients from p into their even (x0) and odd (x1) ones */
+#define DEINTERLEAVE(x0, x1, p) do { \
+    const __m256i deint_ = _mm256_setr_epi8(0,1,4,5,8,9,12,13,2,3,6,7,10,11,14,15, \
+                                            0,1,4,5,8,9,12,13,2,3,6,7,10,11,14,15); \
+    __m256i l_ = _mm256_loadu_si256((const __m256i *)(p)); \
+    __m256i h_ = _mm256_loadu_si256((const __m256i *)(p) + 1); \
+    l_ = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(l_, deint_), 0xD8); \
+    h_ = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(h_, deint_), 0xD8); \
+    x0 = _mm256_permute2x128_si256(l_, h_, 0x20); \
+    x1 = _mm256_permute2x128_si256(l_, h_, 0x31); \
+  } while(0)
+
+/*************************************************
+* Name:        basemul_avx2
+*
+* Description: AVX2 version of the 128 calls of basemul that multiply
+*              two polynomials in NTT domain (see poly_basemul_montgomery);
+*              16 degree-one products per step, with even and odd
+*              coefficients in separate vectors. Identical output.
+*
+* Arguments:   - int16_t r[256]: pointer to the output polynomial
+*              - const int16_t a[256]: pointer to the first factor
+*              - const int16_t b[256]: pointer to the second factor
+**************************************************/
+TARGET_AVX2
+void basemul_avx2(int16_t r[256], const int16_t a[256], const int16_t b[256])
+{
+  __m256i a0, a1, b0, b1, r0, r1, t, z;
+  unsigned int i;
+
+  for(i = 0; i < 8; i++) {
+    DEINTERLEAVE(a0, a1, &a[32*i]);
+    DEINTERLEAVE(b0, b1, &b[32*i]);
+    z = _mm256_loadu_si256((const __m256i *)&zetas_basemul[16*i]);
+
+    r0 = fqmulv_avx2(fqmulv_avx2(a1, b1), z);
+    r0 = _mm256_add_epi16(r0, fqmulv_avx2(a0, b0));
+    r1 = _mm256_add_epi16(fqmulv_avx2(a0, b1), fqmulv_avx2(a1, b0));
+
+    t = _mm256_unpacklo_epi16(r0, r1);
+    r1 = _mm256_unpackhi_epi16(r0, r1);
+    _mm256_storeu_si256((__m256i *)&r[32*i], _mm256_permute2x128_si256(t, r1, 0x20));
+    _mm256_storeu_si256((__m256i *)&r[32*i + 16], _mm256_permute2x128_si256(t, r1, 0x31));
+  }
+}
+
+/*************************************************
+* Name:        basemul_cache_avx2
+*
+* Description: AVX2 version of basemul_cache
+*
+* Arguments:   - int16_t c[128]: pointer to the output cache
+*              - const int16_t b[256]: pointer to the input polynomial
+**************************************************/
+TARGET_AVX2
+static void basemul_cache_avx2(int16_t c[128], const int16_t b[256])
+{
+  __m256i b0, b1, z;
+  unsigned int i;
+
+  for(i = 0; i < 8; i++) {
+    DEINTERLEAVE(b0, b1, &b[32*i]);
+    (void)b0;
+    z = _mm256_loadu_si256((const __m256i *)&zetas_basemul[16*i]);
+    _mm256_storeu_si256((__m256i *)&c[16*i], fqmulv_avx2(b1, z));
+  }
+}
+#endif
+
+/*
+ * The portable ntt and invntt work on 2 or 3 layers per pass over r, with
+ * the 4 or 8 coefficients of a butterfly group in local variables, and
+ * reduce only where the bounds noted at each pass require it. Every sum
+ * and difference is annotated with its bound b (all b <= 2^15, so no
+ * int16 overflows).
+ *
+ * With NTT_PLANTARD=1 the twiddle multiplications (ZETA_FQMUL, also in
+ * basemul_cache) use Plantard instead of Montgomery reduction, with the
+ * twiddles from zetas_plantard: one multiply less per butterfly on
+ * 32-bit cores, results congruent mod q and at most (q+1)/2, so the
+ * bounds below still hold. The AVX2 code is not affected.
+ *
+ * With NTT_BOUND_CHECK=1 the annotations are asserted. ntt_check_bounds
+ * then also runs both transforms on bounds instead of values: every
+ * coefficient holds an upper bound of its absolute value, sums and
+ * differences add, fqmul gives q-1 and barrett_reduce (q-1)/2. Starting
+ * from all inputs at q-1 this checks the analysis for every input.
+ */
+#if (NTT_PLANTARD == 1)
+typedef int32_t zeta_t;
+#define ZETA(k) zetas_plantard[k]
+#define ZETA_FQMUL(zeta, x) fqmul_plantard(x, zeta)
+#else
+typedef int16_t zeta_t;
+#define ZETA(k) zetas[k]
+#define ZETA_FQMUL(zeta, x) fqmul(zeta, x)
+#endif
+
+#if (NTT_BOUND_CHECK == 1)
+#include <assert.h>
+
+static int bounds_mode;
+
+static int16_t ntt_bound(int32_t x, int32_t b) {
+  assert(b <= 32768 && x > -b && x < b);
+  return x;
+}
+
+static int16_t ntt_fqmul(zeta_t zeta, int16_t a) {
+#if (NTT_PLANTARD != 1)
+  /* Plantard takes any int16_t a */
+  assert((zeta < 0 ? -zeta : zeta)*(int32_t)(a < 0 ? -a : a) < KYBER_Q << 15);
+#endif
+  return bounds_mode ? KYBER_Q - 1 : ZETA_FQMUL(zeta, a);
+}
+
+#define NTT_IN(x, b) ntt_bound(x, b)
+#define NTT_ADD(x, y, b) ntt_bound((int32_t)(x) + (y), b)
+#define NTT_SUB(x, y, b) ntt_bound(bounds_mode ? (int32_t)(x) + (y) : (int32_t)(x) - (y), b)
+#define NTT_FQMUL(zeta, x) ntt_fqmul(zeta, x)
+#define NTT_REDUCE(x) (bounds_mode ? (KYBER_Q - 1)/2 : barrett_reduce(x))
+#else
+#define NTT_IN(x, b) (x)
+#define NTT_ADD(x, y, b) ((int16_t)((x) + (y)))
+#define NTT_SUB(x, y, b) ((int16_t)((x) - (y)))
+#define NTT_FQMUL(zeta, x) ZETA_FQMUL(zeta, x)
+#define NTT_REDUCE(x) barrett_reduce(x)
+#endif
+
+/* Butterflies of ntt and invntt; outputs below b */
+#define NTT_BF(a, c, zeta, b) do { \
+    int16_t t_ = NTT_FQMUL(zeta, c); \
+    c = NTT_SUB(a, t_, b); \
+    a = NTT_ADD(a, t_, b); \
+  } while(0)
+
+#define INVNTT_BF(a, c, zeta, b) do { \
+    int16_t t_ = a; \
+    a = NTT_ADD(a, c, b); \
+    c = NTT_FQMUL(zeta, NTT_SUB(c, t_, b)); \
+  } while(0)
+
+/*************************************************
+* Name:        ntt_portable
+*
+* Description: Portable ntt, three passes over r: layers 1-2, 3-4, 5-7.
+*              Performs the same butterflies as the layer-by-layer loop,
+*              so the output is identical.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+static void ntt_portable(int16_t r[256]) {
+  unsigned int i, j;
+  int16_t a0, a1, a2, a3, a4, a5, a6, a7;
+
+  /* layers 1-2: r[j], r[j+64], r[j+128], r[j+192] */
+  for(j = 0; j < 64; j++) {
+    a0 = NTT_IN(r[j], KYBER_Q);
+    a1 = NTT_IN(r[j + 64], KYBER_Q);
+    a2 = NTT_IN(r[j + 128], KYBER_Q);
+    a3 = NTT_IN(r[j + 192], KYBER_Q);
+    NTT_BF(a0, a2, ZETA(1), 2*KYBER_Q);
+    NTT_BF(a1, a3, ZETA(1), 2*KYBER_Q);
+    NTT_BF(a0, a1, ZETA(2), 3*KYBER_Q);
+    NTT_BF(a2, a3, ZETA(3), 3*KYBER_Q);
+    r[j] = a0; r[j + 64] = a1; r[j + 128] = a2; r[j + 192] = a3;
+  }
+
+  /* layers 3-4: r[j], r[j+16], r[j+32], r[j+48] in each quarter i */
+  for(i = 0; i < 4; i++) {
+    for(j = 64*i; j < 64*i + 16; j++) {
+      a0 = r[j]; a1 = r[j + 16]; a2 = r[j + 32]; a3 = r[j + 48];
+      NTT_BF(a0, a2, ZETA(4 + i), 4*KYBER_Q);
+      NTT_BF(a1, a3, ZETA(4 + i), 4*KYBER_Q);
+      NTT_BF(a0, a1, ZETA(8 + 2*i), 5*KYBER_Q);
+      NTT_BF(a2, a3, ZETA(9 + 2*i), 5*KYBER_Q);
+      r[j] = a0; r[j + 16] = a1; r[j + 32] = a2; r[j + 48] = a3;
+    }
+  }
+
+  /* layers 5-7: r[j], r[j+2], ..., r[j+14] in each block i of 16 */
+  for(i = 0; i < 16; i++) {
+    for(j = 16*i; j < 16*i + 2; j++) {
+      a0 = r[j];     a1 = r[j + 2];  a2 = r[j + 4];  a3 = r[j + 6];
+      a4 = r[j + 8]; a5 = r[j + 10]; a6 = r[j + 12]; a7 = r[j + 14];
+      NTT_BF(a0, a4, ZETA(16 + i), 6*KYBER_Q);
+      NTT_BF(a1, a5, ZETA(16 + i), 6*KYBER_Q);
+      NTT_BF(a2, a6, ZETA(16 + i), 6*KYBER_Q);
+      NTT_BF(a3, a7, ZETA(16 + i), 6*KYBER_Q);
+      NTT_BF(a0, a2, ZETA(32 + 2*i), 7*KYBER_Q);
+      NTT_BF(a1, a3, ZETA(32 + 2*i), 7*KYBER_Q);
+      NTT_BF(a4, a6, ZETA(33 + 2*i), 7*KYBER_Q);
+      NTT_BF(a5, a7, ZETA(33 + 2*i), 7*KYBER_Q);
+      NTT_BF(a0, a1, ZETA(64 + 4*i), 8*KYBER_Q);
+      NTT_BF(a2, a3, ZETA(65 + 4*i), 8*KYBER_Q);
+      NTT_BF(a4, a5, ZETA(66 + 4*i), 8*KYBER_Q);
+      NTT_BF(a6, a7, ZETA(67 + 4*i), 8*KYBER_Q);
+      r[j] = a0;     r[j + 2] = a1;  r[j + 4] = a2;  r[j + 6] = a3;
+      r[j + 8] = a4; r[j + 10] = a5; r[j + 12] = a6; r[j + 14] = a7;
+    }
+  }
+}
+
+/*************************************************
+* Name:        invntt_begin_portable
+*
+* Description: Portable invntt, three passes over r: layers 1-3, 4-5
+*              (here) and 6-7 with the scaling by f (invntt_last_portable).
+*              128 Barrett reductions instead of one per butterfly (896)
+*              and no separate pass for f; output congruent mod q to the
+*              layer-by-layer loop.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+static void invntt_begin_portable(int16_t r[256]) {
+  unsigned int i, j;
+  int16_t a0, a1, a2, a3, a4, a5, a6, a7;
+
+  /* layers 1-3: r[j], r[j+2], ..., r[j+14] in each block i of 16.
+   * Sums grow to 8q in a0 (index bits 1-3 all 0) and to 4q in a1, so
+   * these two are reduced; everything else leaves below 2q */
+  for(i = 0; i < 16; i++) {
+    for(j = 16*i; j < 16*i + 2; j++) {
+      a0 = NTT_IN(r[j], KYBER_Q);      a1 = NTT_IN(r[j + 2], KYBER_Q);
+      a2 = NTT_IN(r[j + 4], KYBER_Q);  a3 = NTT_IN(r[j + 6], KYBER_Q);
+      a4 = NTT_IN(r[j + 8], KYBER_Q);  a5 = NTT_IN(r[j + 10], KYBER_Q);
+      a6 = NTT_IN(r[j + 12], KYBER_Q); a7 = NTT_IN(r[j + 14], KYBER_Q);
+      INVNTT_BF(a0, a1, ZETA(127 - 4*i), 2*KYBER_Q);
+      INVNTT_BF(a2, a3, ZETA(126 - 4*i), 2*KYBER_Q);
+      INVNTT_BF(a4, a5, ZETA(125 - 4*i), 2*KYBER_Q);
+      INVNTT_BF(a6, a7, ZETA(124 - 4*i), 2*KYBER_Q);
+      INVNTT_BF(a0, a2, ZETA(63 - 2*i), 4*KYBER_Q);
+      INVNTT_BF(a1, a3, ZETA(63 - 2*i), 2*KYBER_Q);
+      INVNTT_BF(a4, a6, ZETA(62 - 2*i), 4*KYBER_Q);
+      INVNTT_BF(a5, a7, ZETA(62 - 2*i), 2*KYBER_Q);
+      INVNTT_BF(a0, a4, ZETA(31 - i), 8*KYBER_Q);
+      INVNTT_BF(a1, a5, ZETA(31 - i), 4*KYBER_Q);
+      INVNTT_BF(a2, a6, ZETA(31 - i), 2*KYBER_Q);
+      INVNTT_BF(a3, a7, ZETA(31 - i), 2*KYBER_Q);
+      a0 = NTT_REDUCE(a0);
+      a1 = NTT_REDUCE(a1);
+      r[j] = a0;     r[j + 2] = a1;  r[j + 4] = a2;  r[j + 6] = a3;
+      r[j + 8] = a4; r[j + 10] = a5; r[j + 12] = a6; r[j + 14] = a7;
+    }
+  }
+
+  /* layers 4-5: r[j], r[j+16], r[j+32], r[j+48] in each quarter i.
+   * Inputs are below 2q; only a0 grows to 8q and is reduced, a1 leaves
+   * below 2q and a2, a3 below q */
+  for(i = 0; i < 4; i++) {
+    for(j = 64*i; j < 64*i + 16; j++) {
+      a0 = r[j]; a1 = r[j + 16]; a2 = r[j + 32]; a3 = r[j + 48];
+      INVNTT_BF(a0, a1, ZETA(15 - 2*i), 4*KYBER_Q);
+      INVNTT_BF(a2, a3, ZETA(14 - 2*i), 4*KYBER_Q);
+      INVNTT_BF(a0, a2, ZETA(7 - i), 8*KYBER_Q);
+      INVNTT_BF(a1, a3, ZETA(7 - i), 2*KYBER_Q);
+      a0 = NTT_REDUCE(a0);
+      r[j] = a0; r[j + 16] = a1; r[j + 32] = a2; r[j + 48] = a3;
+    }
+  }
+}
+
+/*************************************************
+* Name:        invntt_last_portable
+*
+* Description: Last pass of invntt_portable, on r[j], r[j+64], r[j+128]
+*              and r[j+192] for j0 <= j < j1
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+*              - unsigned int j0, j1: range of j
+**************************************************/
+static void invntt_last_portable(int16_t r[256], unsigned int j0, unsigned int j1) {
+  unsigned int j;
+  int16_t a0, a1, a2, a3, t;
+#if (NTT_PLANTARD == 1)
+  const zeta_t f = 660565712; // mont^2/128 in Plantard form
+  const zeta_t fz = -343184530; // fqmul(zetas[1], f) in Plantard form
+#else
+  const zeta_t f = 1441; // mont^2/128
+  const zeta_t fz = 1397; // fqmul(zetas[1], f)
+#endif
+
+  /* layers 6-7: r[j], r[j+64], r[j+128], r[j+192]. Inputs are below 2q,
+   * the sums of layer 7 below 8q. The scaling by f is folded into the
+   * twiddles of layer 7: fqmul(fqmul(zeta, x), f) == fqmul(x, fz) mod q */
+  for(j = j0; j < j1; j++) {
+    a0 = r[j]; a1 = r[j + 64]; a2 = r[j + 128]; a3 = r[j + 192];
+    INVNTT_BF(a0, a1, ZETA(3), 4*KYBER_Q);
+    INVNTT_BF(a2, a3, ZETA(2), 4*KYBER_Q);
+    t = a0;
+    a0 = NTT_FQMUL(f, NTT_ADD(a0, a2, 8*KYBER_Q));
+    a2 = NTT_FQMUL(fz, NTT_SUB(a2, t, 8*KYBER_Q));
+    t = a1;
+    a1 = NTT_FQMUL(f, NTT_ADD(a1, a3, 8*KYBER_Q));
+    a3 = NTT_FQMUL(fz, NTT_SUB(a3, t, 8*KYBER_Q));
+    r[j] = a0; r[j + 64] = a1; r[j + 128] = a2; r[j + 192] = a3;
+  }
+}
+
+static void invntt_portable(int16_t r[256]) {
+  invntt_begin_portable(r);
+  invntt_last_portable(r, 0, 64);
 }
 
 /*************************************************
 * Name:        ntt
 *
 * Description: Inplace number-theoretic transform (NTT) in Rq.
-*              input is in standard order, output is in bitreversed order
+*              input is in standard order, output is in bitreversed order.
+*              Input coefficients must be below q in absolute value,
+*              output coefficients are below 8q. Same output as the
+*              layer-by-layer loop (the same butterflies in another order).
 *
 * Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
 **************************************************/
 void ntt(int16_t r[256]) {
-  unsigned int len, start, j, k;
-  int16_t t, zeta;
-
-  k = 1;
-  for(len = 128; len >= 2; len >>= 1) {
-    for(start = 0; start < 256; start = j + len) {
-      zeta = zetas[k++];
-      for(j = start; j < start + len; j++) {
-        t = fqmul(zeta, r[j + len]);
-        r[j + len] = r[j] - t;
-        r[j] = r[j] + t;
-      }
-    }
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    ntt_avx2(r);
+    return;
   }
+#endif
+
+  ntt_portable(r);
 }
 
 /*************************************************
@@ -99,31 +809,98 @@ void ntt(int16_t r[256]) {
 *
 * Description: Inplace inverse number-theoretic transform in Rq and
 *              multiplication by Montgomery factor 2^16.
-*              Input is in bitreversed order, output is in standard order
+*              Input is in bitreversed order, output is in standard order.
+*              Input coefficients must be below q in absolute value (as
+*              after poly_reduce), output coefficients are below q.
 *
 * Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
 **************************************************/
 void invntt(int16_t r[256]) {
-  unsigned int start, len, j, k;
-  int16_t t, zeta;
-  const int16_t f = 1441; // mont^2/128
-
-  k = 127;
-  for(len = 2; len <= 128; len <<= 1) {
-    for(start = 0; start < 256; start = j + len) {
-      zeta = zetas[k--];
-      for(j = start; j < start + len; j++) {
-        t = r[j];
-        r[j] = barrett_reduce(t + r[j + len]);
-        r[j + len] = r[j + len] - t;
-        r[j + len] = fqmul(zeta, r[j + len]);
-      }
-    }
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    invntt_avx2(r);
+    return;
+  }
+#endif
+
+  invntt_portable(r);
+}
+
+/*************************************************
+* Name:        invntt_begin
+*
+* Description: invntt without its last pass; invntt_finish completes
+*              the coefficients a strip at a time, so the caller can
+*              go on with them while they are still in cache.
+*              invntt(r) is invntt_begin(r) followed by
+*              invntt_finish(r, j) for j = 0, 8, ..., 56.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+**************************************************/
+void invntt_begin(int16_t r[256]) {
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    invntt_begin_avx2(r);
+    return;
+  }
+#endif
+
+  invntt_begin_portable(r);
+}
+
+/*************************************************
+* Name:        invntt_finish
+*
+* Description: Last pass of invntt on the strip r[j..j+7], r[j+64..j+71],
+*              r[j+128..j+135] and r[j+192..j+199], after invntt_begin.
+*              Output as for invntt.
+*
+* Arguments:   - int16_t r[256]: pointer to input/output vector of elements of Zq
+*              - unsigned int j: start of the strip, a multiple of 8 below 64
+**************************************************/
+void invntt_finish(int16_t r[256], unsigned int j) {
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    invntt_finish_avx2(r, j);
+    return;
   }
+#endif
+
+  invntt_last_portable(r, j, j + 8);
+}
+
+#if (NTT_BOUND_CHECK == 1)
+/*************************************************
+* Name:        ntt_check_bounds
+*
+* Description: Checks the coefficient bounds of the portable ntt and
+*              invntt for all inputs below q in absolute value, by
+*              running them on bounds instead of values (see above).
+*              A violated bound fails an assert.
+*
+* Returns 1 if the output bounds (8q for ntt, q for invntt) hold.
+**************************************************/
+int ntt_check_bounds(void) {
+  int16_t r[256];
+  unsigned int i;
+  int ok = 1;
+
+  bounds_mode = 1;
+  for(i = 0; i < 256; i++)
+    r[i] = KYBER_Q - 1;
+  ntt_portable(r);
+  for(i = 0; i < 256; i++)
+    ok &= r[i] < 8*KYBER_Q;
 
-  for(j = 0; j < 256; j++)
-    r[j] = fqmul(r[j], f);
+  for(i = 0; i < 256; i++)
+    r[i] = KYBER_Q - 1;
+  invntt_portable(r);
+  for(i = 0; i < 256; i++)
+    ok &= r[i] < KYBER_Q;
+  bounds_mode = 0;
+  return ok;
 }
+#endif
 
 /*************************************************
 * Name:        basemul
@@ -144,3 +921,33 @@ void basemul(int16_t r[2], const int16_t a[2], const int16_t b[2], int16_t zeta)
   r[1]  = fqmul(a[0], b[1]);
   r[1] += fqmul(a[1], b[0]);
 }
+
+/*************************************************
+* Name:        basemul_cache
+*
+* Description: Computes the products b[1]*zeta of all 128 calls of basemul
+*              on the polynomial b (see poly_basemul_montgomery), in
+*              Montgomery form: c[i] = fqmul(b[2i+1], +-zetas[64+i/2])
+*              (congruent mod q and at most (q+1)/2 with NTT_PLANTARD=1).
+*              Lets a polynomial that is multiplied several times, such
+*              as the vector of a matrix-vector product, do this once.
+*
+* Arguments:   - int16_t c[128]: pointer to the output cache
+*              - const int16_t b[256]: pointer to the input polynomial
+**************************************************/
+void basemul_cache(int16_t c[128], const int16_t b[256])
+{
+  unsigned int i;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    basemul_cache_avx2(c, b);
+    return;
+  }
+#endif
+
+  for(i = 0; i < 64; i++) {
+    c[2*i] = ZETA_FQMUL(ZETA(64+i), b[4*i+1]);
+    c[2*i+1] = ZETA_FQMUL(-ZETA(64+i), b[4*i+3]);
+  }
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "params.h"
+#include "cpufeatures.h"
 
 #define zetas KYBER_NAMESPACE(zetas)
 extern const int16_t zetas[128];
@@ -12,8 +13,27 @@ void ntt(int16_t poly[256]);
 
 #define invntt KYBER_NAMESPACE(invntt)
 void invntt(int16_t poly[256]);
+#define invntt_begin KYBER_NAMESPACE(invntt_begin)
+void invntt_begin(int16_t poly[256]);
+#define invntt_finish KYBER_NAMESPACE(invntt_finish)
+void invntt_finish(int16_t poly[256], unsigned int j);
 
 #define basemul KYBER_NAMESPACE(basemul)
 void basemul(int16_t r[2], const int16_t a[2], const int16_t b[2], int16_t zeta);
 
+#define basemul_cache KYBER_NAMESPACE(basemul_cache)
+void basemul_cache(int16_t c[128], const int16_t b[256]);
+
+#if (NTT_BOUND_CHECK == 1)
+#define ntt_check_bounds KYBER_NAMESPACE(ntt_check_bounds)
+int ntt_check_bounds(void);
+#endif
+
+#if KYBER_X86_64
+#define basemul_avx2 KYBER_NAMESPACE(basemul_avx2)
+void basemul_avx2(int16_t r[256], const int16_t a[256], const int16_t b[256]);
+#define ntt_finish_avx2 KYBER_NAMESPACE(ntt_finish_avx2)
+void ntt_finish_avx2(int16_t r[256]);
+#endif
+
 #endif
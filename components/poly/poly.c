@@ -1,62 +1,363 @@
 #include <stdint.h>
+#include <string.h>
 #include "params.h"
 #include "poly.h"
 #include "ntt.h"
 #include "reduce.h"
 #include "cbd.h"
 #include "symmetric.h"
+#include "cpufeatures.h"
+#include "avx2.h"
+
+#if KYBER_X86_64
+/*
+ * AVX2 compression and serialization. Same output as the portable code
+ * for all coefficients in {-q+1,...,q-1}; the compression formulas were
+ * checked against the portable code on every such input.
+ *
+ * Packing: madd_epi16/maddubs_epi16 merge neighbouring fields into wider
+ * lanes, shuffle_epi8 drops the unused bytes of each 128-bit lane.
+ * Unpacking: shuffle_epi8 puts the (at most two) bytes holding field k
+ * into 16-bit lane k, mullo_epi16 by a power of two per lane moves the
+ * field to the top, a shift and mask to its place for mulhrs_epi16.
+ */
 
 /*************************************************
-* Name:        poly_compress
+* Name:        poly_compress_avx2
+*
+* Description: AVX2 version of poly_compress. round(x*2^d/q) is
+*              mulhi_epi16 by 20159 ~ 2^26/q followed by mulhrs_epi16,
+*              which rounds; negative x need no correction as the
+*              result is taken mod 2^d.
+**************************************************/
+TARGET_AVX2
+static void poly_compress_avx2(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], const poly *a)
+{
+  unsigned int i;
+  const __m256i v = _mm256_set1_epi16(20159);
+  __m256i f0, f1;
+
+#if (KYBER_POLYCOMPRESSEDBYTES == 128)
+  const __m256i shift1 = _mm256_set1_epi16(1 << 9);
+  const __m256i mask = _mm256_set1_epi16(15);
+  const __m256i shift2 = _mm256_set1_epi16((16 << 8) + 1);
+
+  for(i=0;i<KYBER_N/32;i++) {
+    f0 = _mm256_loadu_si256((const __m256i *)&a->coeffs[32*i]);
+    f1 = _mm256_loadu_si256((const __m256i *)&a->coeffs[32*i+16]);
+    f0 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f0, v), shift1), mask);
+    f1 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f1, v), shift1), mask);
+    /* 32 nibbles in order, then two per byte */
+    f0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(f0, f1), 0xD8);
+    f0 = _mm256_maddubs_epi16(f0, shift2);
+    f0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(f0, f0), 0x08);
+    _mm_storeu_si128((__m128i *)&r[16*i], _mm256_castsi256_si128(f0));
+  }
+#elif (KYBER_POLYCOMPRESSEDBYTES == 160)
+  const __m256i shift1 = _mm256_set1_epi16(1 << 10);
+  const __m256i mask = _mm256_set1_epi16(31);
+  const __m256i shift2 = _mm256_set1_epi16((32 << 8) + 1);
+  const __m256i shift3 = _mm256_set1_epi32((1024 << 16) + 1);
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,2,3,4,8,9,10,11,12,-1,-1,-1,-1,-1,-1,
+                                            0,1,2,3,4,8,9,10,11,12,-1,-1,-1,-1,-1,-1);
+
+  for(i=0;i<KYBER_N/32;i++) {
+    f0 = _mm256_loadu_si256((const __m256i *)&a->coeffs[32*i]);
+    f1 = _mm256_loadu_si256((const __m256i *)&a->coeffs[32*i+16]);
+    f0 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f0, v), shift1), mask);
+    f1 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f1, v), shift1), mask);
+    /* 32 5-bit fields in order; 10, 20 and 40 bits per lane */
+    f0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(f0, f1), 0xD8);
+    f0 = _mm256_maddubs_epi16(f0, shift2);
+    f0 = _mm256_madd_epi16(f0, shift3);
+    f0 = _mm256_add_epi64(_mm256_blend_epi32(f0, _mm256_setzero_si256(), 0xAA),
+                          _mm256_slli_epi64(_mm256_srli_epi64(f0, 32), 20));
+    storeu_lanes(&r[20*i], _mm256_shuffle_epi8(f0, shufbidx), 10);
+  }
+#else
+#error "KYBER_POLYCOMPRESSEDBYTES needs to be in {128, 160}"
+#endif
+}
+
+/*************************************************
+* Name:        poly_decompress_avx2
+*
+* Description: AVX2 version of poly_decompress:
+*              mulhrs_epi16(x*2^(15-d), q) == (x*q + 2^(d-1)) >> d
+**************************************************/
+TARGET_AVX2
+static void poly_decompress_avx2(poly *r, const uint8_t a[KYBER_POLYCOMPRESSEDBYTES])
+{
+  unsigned int i;
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  __m256i f;
+
+#if (KYBER_POLYCOMPRESSEDBYTES == 128)
+  const __m256i shufbidx = _mm256_setr_epi8(0,-1,0,-1,1,-1,1,-1,2,-1,2,-1,3,-1,3,-1,
+                                            4,-1,4,-1,5,-1,5,-1,6,-1,6,-1,7,-1,7,-1);
+  const __m256i shift = _mm256_setr_epi16(4096,256,4096,256,4096,256,4096,256,
+                                          4096,256,4096,256,4096,256,4096,256);
+  const __m256i mask = _mm256_set1_epi16(0x7800);
+
+  for(i=0;i<KYBER_N/16;i++) {
+    f = _mm256_broadcastq_epi64(_mm_loadl_epi64((const __m128i *)&a[8*i]));
+    f = _mm256_mullo_epi16(_mm256_shuffle_epi8(f, shufbidx), shift);
+    f = _mm256_and_si256(_mm256_srli_epi16(f, 1), mask);
+    _mm256_storeu_si256((__m256i *)&r->coeffs[16*i], _mm256_mulhrs_epi16(f, q));
+  }
+#elif (KYBER_POLYCOMPRESSEDBYTES == 160)
+  /* 20 bytes per 32 coefficients; the upper lane holds bytes 4-19 */
+  const __m256i shufbidx0 = _mm256_setr_epi8(0,-1,0,1,1,-1,1,2,2,3,3,-1,3,4,4,-1,
+                                             1,-1,1,2,2,-1,2,3,3,4,4,-1,4,5,5,-1);
+  const __m256i shufbidx1 = _mm256_setr_epi8(10,-1,10,11,11,-1,11,12,12,13,13,-1,13,14,14,-1,
+                                             11,-1,11,12,12,-1,12,13,13,14,14,-1,14,15,15,-1);
+  const __m256i shift = _mm256_setr_epi16(2048,64,512,16,128,1024,32,256,
+                                          2048,64,512,16,128,1024,32,256);
+  const __m256i mask = _mm256_set1_epi16(0x7C00);
+  __m256i g;
+
+  for(i=0;i<KYBER_N/32;i++) {
+    g = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&a[20*i])),
+                                _mm_loadu_si128((const __m128i *)&a[20*i+4]), 1);
+    f = _mm256_mullo_epi16(_mm256_shuffle_epi8(g, shufbidx0), shift);
+    f = _mm256_and_si256(_mm256_srli_epi16(f, 1), mask);
+    _mm256_storeu_si256((__m256i *)&r->coeffs[32*i], _mm256_mulhrs_epi16(f, q));
+    f = _mm256_mullo_epi16(_mm256_shuffle_epi8(g, shufbidx1), shift);
+    f = _mm256_and_si256(_mm256_srli_epi16(f, 1), mask);
+    _mm256_storeu_si256((__m256i *)&r->coeffs[32*i+16], _mm256_mulhrs_epi16(f, q));
+  }
+#else
+#error "KYBER_POLYCOMPRESSEDBYTES needs to be in {128, 160}"
+#endif
+}
+
+/*************************************************
+* Name:        poly_tobytes_avx2
 *
-* Description: Compression and subsequent serialization of a polynomial
+* Description: AVX2 version of poly_tobytes
+**************************************************/
+TARGET_AVX2
+static void poly_tobytes_avx2(uint8_t r[KYBER_POLYBYTES], const poly *a)
+{
+  unsigned int i;
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  const __m256i shift = _mm256_set1_epi32((4096 << 16) + 1);
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+                                            0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+  __m256i f;
+
+  for(i=0;i<KYBER_N/16;i++) {
+    f = _mm256_loadu_si256((const __m256i *)&a->coeffs[16*i]);
+    f = _mm256_add_epi16(f, _mm256_and_si256(_mm256_srai_epi16(f, 15), q));
+    f = _mm256_madd_epi16(f, shift);
+    storeu_lanes(&r[24*i], _mm256_shuffle_epi8(f, shufbidx), 12);
+  }
+}
+
+/*************************************************
+* Name:        poly_frombytes_avx2
+*
+* Description: AVX2 version of poly_frombytes
+**************************************************/
+TARGET_AVX2
+static void poly_frombytes_avx2(poly *r, const uint8_t a[KYBER_POLYBYTES])
+{
+  unsigned int i;
+  /* 24 bytes per 16 coefficients; the upper lane holds bytes 8-23 */
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,1,2,3,4,4,5,6,7,7,8,9,10,10,11,
+                                            4,5,5,6,7,8,8,9,10,11,11,12,13,14,14,15);
+  const __m256i shift = _mm256_setr_epi16(16,1,16,1,16,1,16,1,16,1,16,1,16,1,16,1);
+  __m256i f;
+
+  for(i=0;i<KYBER_N/16;i++) {
+    f = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&a[24*i])),
+                                _mm_loadu_si128((const __m128i *)&a[24*i+8]), 1);
+    f = _mm256_mullo_epi16(_mm256_shuffle_epi8(f, shufbidx), shift);
+    _mm256_storeu_si256((__m256i *)&r->coeffs[16*i], _mm256_srli_epi16(f, 4));
+  }
+}
+
+/*************************************************
+* Name:        poly_add_compress_strip_avx2
+*
+* Description: AVX2 tail of poly_invntt_add_compress on the strip j of
+*              a: adds e, reduces and compresses the 4 runs of 8
+*              coefficients at j, 64+j, 128+j and 192+j. As in
+*              poly_compress_avx2, but the lanes are not permuted back
+*              into order: each run is stored to its own place.
+**************************************************/
+TARGET_AVX2
+static void poly_add_compress_strip_avx2(uint8_t r[KYBER_POLYCOMPRESSEDBYTES],
+                                         poly *a,
+                                         const poly *e,
+                                         unsigned int j)
+{
+  const __m256i v = _mm256_set1_epi16(20159);
+  unsigned int k;
+  uint8_t buf[32];
+  __m256i f0, f1;
+
+  /* runs 0 and 1 in f0, runs 2 and 3 in f1 */
+  f0 = barrett_avx2(_mm256_add_epi16(loadu_strip(&a->coeffs[j]), loadu_strip(&e->coeffs[j])));
+  f1 = barrett_avx2(_mm256_add_epi16(loadu_strip(&a->coeffs[128 + j]),
+                                     loadu_strip(&e->coeffs[128 + j])));
+#if (KYBER_POLYCOMPRESSEDBYTES == 128)
+  /* epi32 elements 0, 4, 1, 5 hold runs 0, 1, 2, 3 */
+  const unsigned int off[4] = {0, 16, 4, 20};
+  f0 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f0, v), _mm256_set1_epi16(1 << 9)),
+                        _mm256_set1_epi16(15));
+  f1 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f1, v), _mm256_set1_epi16(1 << 9)),
+                        _mm256_set1_epi16(15));
+  f0 = _mm256_maddubs_epi16(_mm256_packus_epi16(f0, f1), _mm256_set1_epi16((16 << 8) + 1));
+  f0 = _mm256_packus_epi16(f0, f0);
+#elif (KYBER_POLYCOMPRESSEDBYTES == 160)
+  /* 64-bit elements 0, 2, 1, 3 hold runs 0, 1, 2, 3 */
+  const unsigned int off[4] = {0, 16, 8, 24};
+  f0 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f0, v), _mm256_set1_epi16(1 << 10)),
+                        _mm256_set1_epi16(31));
+  f1 = _mm256_and_si256(_mm256_mulhrs_epi16(_mm256_mulhi_epi16(f1, v), _mm256_set1_epi16(1 << 10)),
+                        _mm256_set1_epi16(31));
+  f0 = _mm256_maddubs_epi16(_mm256_packus_epi16(f0, f1), _mm256_set1_epi16((32 << 8) + 1));
+  f0 = _mm256_madd_epi16(f0, _mm256_set1_epi32((1024 << 16) + 1));
+  f0 = _mm256_add_epi64(_mm256_blend_epi32(f0, _mm256_setzero_si256(), 0xAA),
+                        _mm256_slli_epi64(_mm256_srli_epi64(f0, 32), 20));
+#else
+#error "KYBER_POLYCOMPRESSEDBYTES needs to be in {128, 160}"
+#endif
+
+  _mm256_storeu_si256((__m256i *)buf, f0);
+  for(k=0;k<4;k++)
+    memcpy(&r[(64*k + j)*KYBER_POLYCOMPRESSEDBYTES/KYBER_N], buf + off[k],
+           KYBER_POLYCOMPRESSEDBYTES/32);
+}
+#endif
+
+/*************************************************
+* Name:        poly_compress8
+*
+* Description: Compression and serialization of the 8 coefficients
+*              a[0..7] to KYBER_POLYCOMPRESSEDBYTES/32 bytes
 *
 * Arguments:   - uint8_t *r: pointer to output byte array
-*                            (of length KYBER_POLYCOMPRESSEDBYTES)
-*              - const poly *a: pointer to input polynomial
+*              - const int16_t *a: pointer to input coefficients
+*                                  (in {-q+1,...,q-1})
 **************************************************/
-void poly_compress(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], const poly *a)
+static void poly_compress8(uint8_t *r, const int16_t a[8])
 {
-  unsigned int i,j;
+  unsigned int j;
   int16_t u;
+  uint32_t d0;
   uint8_t t[8];
 
 #if (KYBER_POLYCOMPRESSEDBYTES == 128)
-  for(i=0;i<KYBER_N/8;i++) {
-    for(j=0;j<8;j++) {
-      // map to positive standard representatives
-      u  = a->coeffs[8*i+j];
-      u += (u >> 15) & KYBER_Q;
-      t[j] = ((((uint16_t)u << 4) + KYBER_Q/2)/KYBER_Q) & 15;
-    }
-
-    r[0] = t[0] | (t[1] << 4);
-    r[1] = t[2] | (t[3] << 4);
-    r[2] = t[4] | (t[5] << 4);
-    r[3] = t[6] | (t[7] << 4);
-    r += 4;
+  for(j=0;j<8;j++) {
+    // map to positive standard representatives
+    u  = a[j];
+    u += (u >> 15) & KYBER_Q;
+    /* t[j] = ((((uint16_t)u << 4) + KYBER_Q/2)/KYBER_Q) & 15; */
+    d0 = (uint32_t)u << 4;
+    d0 += 1665;
+    d0 *= 80635;
+    d0 >>= 28;
+    t[j] = d0 & 0xf;
   }
-#elif (KYBER_POLYCOMPRESSEDBYTES == 160)
-  for(i=0;i<KYBER_N/8;i++) {
-    for(j=0;j<8;j++) {
-      // map to positive standard representatives
-      u  = a->coeffs[8*i+j];
-      u += (u >> 15) & KYBER_Q;
-      t[j] = ((((uint32_t)u << 5) + KYBER_Q/2)/KYBER_Q) & 31;
-    }
 
-    r[0] = (t[0] >> 0) | (t[1] << 5);
-    r[1] = (t[1] >> 3) | (t[2] << 2) | (t[3] << 7);
-    r[2] = (t[3] >> 1) | (t[4] << 4);
-    r[3] = (t[4] >> 4) | (t[5] << 1) | (t[6] << 6);
-    r[4] = (t[6] >> 2) | (t[7] << 3);
-    r += 5;
+  r[0] = t[0] | (t[1] << 4);
+  r[1] = t[2] | (t[3] << 4);
+  r[2] = t[4] | (t[5] << 4);
+  r[3] = t[6] | (t[7] << 4);
+#elif (KYBER_POLYCOMPRESSEDBYTES == 160)
+  for(j=0;j<8;j++) {
+    // map to positive standard representatives
+    u  = a[j];
+    u += (u >> 15) & KYBER_Q;
+    /* t[j] = ((((uint32_t)u << 5) + KYBER_Q/2)/KYBER_Q) & 31; */
+    d0 = (uint32_t)u << 5;
+    d0 += 1664;
+    d0 *= 40318;
+    d0 >>= 27;
+    t[j] = d0 & 0x1f;
   }
+
+  r[0] = (t[0] >> 0) | (t[1] << 5);
+  r[1] = (t[1] >> 3) | (t[2] << 2) | (t[3] << 7);
+  r[2] = (t[3] >> 1) | (t[4] << 4);
+  r[3] = (t[4] >> 4) | (t[5] << 1) | (t[6] << 6);
+  r[4] = (t[6] >> 2) | (t[7] << 3);
 #else
 #error "KYBER_POLYCOMPRESSEDBYTES needs to be in {128, 160}"
 #endif
 }
 
+/*************************************************
+* Name:        poly_compress
+*
+* Description: Compression and subsequent serialization of a polynomial.
+*              The rounded division by q is a multiplication and shift
+*              (exact for all inputs), so no variable-time divide.
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (of length KYBER_POLYCOMPRESSEDBYTES)
+*              - const poly *a: pointer to input polynomial
+*                               (coefficients in {-q+1,...,q-1})
+**************************************************/
+void poly_compress(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], const poly *a)
+{
+  unsigned int i;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    poly_compress_avx2(r, a);
+    return;
+  }
+#endif
+
+  for(i=0;i<KYBER_N/8;i++)
+    poly_compress8(&r[i*KYBER_POLYCOMPRESSEDBYTES/32], &a->coeffs[8*i]);
+}
+
+/*************************************************
+* Name:        poly_invntt_add_compress
+*
+* Description: Fused poly_invntt_tomont, poly_add of e, poly_reduce and
+*              poly_compress: the last invntt pass runs a strip of 4x8
+*              coefficients at a time (invntt_finish), and each strip is
+*              reduced and compressed while still in registers or L1
+*              instead of four more passes over a. Same output as the
+*              separate calls.
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (of length KYBER_POLYCOMPRESSEDBYTES)
+*              - poly *a: pointer to input polynomial in NTT domain;
+*                         overwritten
+*              - const poly *e: pointer to polynomial added after the invntt
+*                               (|a+e| stays below 2^15 for |e| < 2^14)
+**************************************************/
+void poly_invntt_add_compress(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], poly *a, const poly *e)
+{
+  unsigned int j, k, l;
+  const int16_t *c;
+  int16_t t[32];
+
+  invntt_begin(a->coeffs);
+  for(j=0;j<KYBER_N/4;j+=8) {
+    invntt_finish(a->coeffs, j);
+#if KYBER_X86_64
+    if(cpu_has_avx2()) {
+      poly_add_compress_strip_avx2(r, a, e, j);
+      continue;
+    }
+#endif
+    for(k=0;k<4;k++) {
+      c = &a->coeffs[64*k + j];
+      for(l=0;l<8;l++)
+        t[8*k+l] = barrett_reduce(c[l] + e->coeffs[64*k + j + l]);
+    }
+    for(k=0;k<4;k++)
+      poly_compress8(&r[(64*k + j)*KYBER_POLYCOMPRESSEDBYTES/KYBER_N], t+8*k);
+  }
+}
+
 /*************************************************
 * Name:        poly_decompress
 *
@@ -71,6 +372,13 @@ void poly_decompress(poly *r, const uint8_t a[KYBER_POLYCOMPRESSEDBYTES])
 {
   unsigned int i;
 
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    poly_decompress_avx2(r, a);
+    return;
+  }
+#endif
+
 #if (KYBER_POLYCOMPRESSEDBYTES == 128)
   for(i=0;i<KYBER_N/2;i++) {
     r->coeffs[2*i+0] = (((uint16_t)(a[0] & 15)*KYBER_Q) + 8) >> 4;
@@ -113,6 +421,13 @@ void poly_tobytes(uint8_t r[KYBER_POLYBYTES], const poly *a)
   unsigned int i;
   uint16_t t0, t1;
 
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    poly_tobytes_avx2(r, a);
+    return;
+  }
+#endif
+
   for(i=0;i<KYBER_N/2;i++) {
     // map to positive standard representatives
     t0  = a->coeffs[2*i];
@@ -138,6 +453,13 @@ void poly_tobytes(uint8_t r[KYBER_POLYBYTES], const poly *a)
 void poly_frombytes(poly *r, const uint8_t a[KYBER_POLYBYTES])
 {
   unsigned int i;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    poly_frombytes_avx2(r, a);
+    return;
+  }
+#endif
   for(i=0;i<KYBER_N/2;i++) {
     r->coeffs[2*i]   = ((a[3*i+0] >> 0) | ((uint16_t)a[3*i+1] << 8)) & 0xFFF;
     r->coeffs[2*i+1] = ((a[3*i+1] >> 4) | ((uint16_t)a[3*i+2] << 4)) & 0xFFF;
@@ -172,7 +494,8 @@ void poly_frommsg(poly *r, const uint8_t msg[KYBER_INDCPA_MSGBYTES])
 /*************************************************
 * Name:        poly_tomsg
 *
-* Description: Convert polynomial to 32-byte message
+* Description: Convert polynomial to 32-byte message; division-free
+*              like poly_compress
 *
 * Arguments:   - uint8_t *msg: pointer to output message
 *              - const poly *a: pointer to input polynomial
@@ -180,14 +503,19 @@ void poly_frommsg(poly *r, const uint8_t msg[KYBER_INDCPA_MSGBYTES])
 void poly_tomsg(uint8_t msg[KYBER_INDCPA_MSGBYTES], const poly *a)
 {
   unsigned int i,j;
-  uint16_t t;
+  uint32_t t;
 
   for(i=0;i<KYBER_N/8;i++) {
     msg[i] = 0;
     for(j=0;j<8;j++) {
       t  = a->coeffs[8*i+j];
       t += ((int16_t)t >> 15) & KYBER_Q;
-      t  = (((t << 1) + KYBER_Q/2)/KYBER_Q) & 1;
+      /* t = (((t << 1) + KYBER_Q/2)/KYBER_Q) & 1; */
+      t <<= 1;
+      t += 1665;
+      t *= 80635;
+      t >>= 28;
+      t &= 1;
       msg[i] |= t << j;
     }
   }
@@ -207,9 +535,24 @@ void poly_tomsg(uint8_t msg[KYBER_INDCPA_MSGBYTES], const poly *a)
 **************************************************/
 void poly_getnoise_eta1(poly *r, const uint8_t seed[KYBER_SYMBYTES], uint8_t nonce)
 {
-  uint8_t buf[KYBER_ETA1*KYBER_N/4];
-  prf(buf, sizeof(buf), seed, nonce);
-  poly_cbd_eta1(r, buf);
+#ifdef KYBER_90S
+  prf_key key;
+
+  prf_key_init(&key, seed);
+  poly_getnoise_eta1_keyed(r, &key, nonce);
+  prf_key_free(&key);
+#else
+  unsigned int i,j;
+  uint64_t t[KYBER_ETA1];
+  prf_state state;
+
+  prf_init(&state, seed, nonce);
+  for(i=0;i<KYBER_N/32;i++) {
+    for(j=0;j<KYBER_ETA1;j++)
+      t[j] = prf_squeezelane(&state);
+    cbd_eta1_lanes(r->coeffs+32*i, t);
+  }
+#endif
 }
 
 /*************************************************
@@ -226,10 +569,209 @@ void poly_getnoise_eta1(poly *r, const uint8_t seed[KYBER_SYMBYTES], uint8_t non
 **************************************************/
 void poly_getnoise_eta2(poly *r, const uint8_t seed[KYBER_SYMBYTES], uint8_t nonce)
 {
+#ifdef KYBER_90S
+  prf_key key;
+
+  prf_key_init(&key, seed);
+  poly_getnoise_eta2_keyed(r, &key, nonce);
+  prf_key_free(&key);
+#else
+  unsigned int i,j;
+  uint64_t t[KYBER_ETA2];
+  prf_state state;
+
+  prf_init(&state, seed, nonce);
+  for(i=0;i<KYBER_N/32;i++) {
+    for(j=0;j<KYBER_ETA2;j++)
+      t[j] = prf_squeezelane(&state);
+    cbd_eta2_lanes(r->coeffs+32*i, t);
+  }
+#endif
+}
+
+#ifdef KYBER_90S
+/*************************************************
+* Name:        poly_getnoise_eta1_keyed
+*
+* Description: Same as poly_getnoise_eta1, but with the seed already
+*              expanded into an AES key schedule by prf_key_init, so a run
+*              of noise polynomials under one seed expands it only once.
+*              Restarts the PRF stream of key at the given nonce.
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - prf_key *key: pointer to the expanded seed
+*              - uint8_t nonce: one-byte input nonce
+**************************************************/
+void poly_getnoise_eta1_keyed(poly *r, prf_key *key, uint8_t nonce)
+{
+#if (AES_ACC == 1)
+  uint8_t buf[KYBER_ETA1*KYBER_N/4];
+  prf_keyed(buf, sizeof(buf), key, nonce);
+  poly_cbd_eta1(r, buf);
+#else
+  unsigned int i,j;
+  uint64_t t[KYBER_ETA1];
+
+  prf_key_setnonce(key, nonce);
+  for(i=0;i<KYBER_N/32;i++) {
+    for(j=0;j<KYBER_ETA1;j++)
+      t[j] = prf_squeezelane(key);
+    cbd_eta1_lanes(r->coeffs+32*i, t);
+  }
+#endif
+}
+
+/*************************************************
+* Name:        poly_getnoise_eta2_keyed
+*
+* Description: Same as poly_getnoise_eta2, but with the seed already
+*              expanded by prf_key_init; see poly_getnoise_eta1_keyed.
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - prf_key *key: pointer to the expanded seed
+*              - uint8_t nonce: one-byte input nonce
+**************************************************/
+void poly_getnoise_eta2_keyed(poly *r, prf_key *key, uint8_t nonce)
+{
+#if (AES_ACC == 1)
   uint8_t buf[KYBER_ETA2*KYBER_N/4];
-  prf(buf, sizeof(buf), seed, nonce);
+  prf_keyed(buf, sizeof(buf), key, nonce);
   poly_cbd_eta2(r, buf);
+#else
+  unsigned int i,j;
+  uint64_t t[KYBER_ETA2];
+
+  prf_key_setnonce(key, nonce);
+  for(i=0;i<KYBER_N/32;i++) {
+    for(j=0;j<KYBER_ETA2;j++)
+      t[j] = prf_squeezelane(key);
+    cbd_eta2_lanes(r->coeffs+32*i, t);
+  }
+#endif
+}
+#else
+#if (KYBER_ETA1 < KYBER_ETA2)
+#error "poly_getnoise_4x requires KYBER_ETA1 >= KYBER_ETA2"
+#endif
+/*************************************************
+* Name:        poly_getnoise_4x
+*
+* Description: Shared body of the 4-way noise samplers. The four PRF
+*              streams are squeezed a lane at a time in lockstep; each
+*              instance collects its lanes and runs the sampler whenever it
+*              has enough for 32 coefficients. r[k] uses parameter
+*              KYBER_ETA1 for k < neta1 and KYBER_ETA2 otherwise.
+*
+* Arguments:   - poly **r: pointers to the four output polynomials
+*              - unsigned int neta1: number of leading outputs sampled with KYBER_ETA1
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+*              - const uint8_t *nonce: the four one-byte input nonces
+**************************************************/
+static void poly_getnoise_4x(poly *r[4],
+                             unsigned int neta1,
+                             const uint8_t seed[KYBER_SYMBYTES],
+                             const uint8_t nonce[4])
+{
+  unsigned int ctr[4] = {0}, n[4] = {0}, k;
+  uint64_t lane[4], t[4][KYBER_ETA1];
+  prf4x_state state;
+
+  prf4x_init(&state, seed, nonce);
+  while(ctr[0] < KYBER_N || ctr[1] < KYBER_N || ctr[2] < KYBER_N || ctr[3] < KYBER_N) {
+    prf4x_squeezelane(lane, &state);
+    for(k=0;k<4;k++) {
+      if(ctr[k] == KYBER_N)
+        continue;
+      t[k][n[k]++] = lane[k];
+      if(k < neta1 && n[k] == KYBER_ETA1) {
+        cbd_eta1_lanes(r[k]->coeffs+ctr[k], t[k]);
+        ctr[k] += 32;
+        n[k] = 0;
+      }
+      else if(k >= neta1 && n[k] == KYBER_ETA2) {
+        cbd_eta2_lanes(r[k]->coeffs+ctr[k], t[k]);
+        ctr[k] += 32;
+        n[k] = 0;
+      }
+    }
+  }
+}
+
+/*************************************************
+* Name:        poly_getnoise_eta1_4x
+*
+* Description: Sample four polynomials deterministically from a seed and
+*              four nonces, with output polynomials close to centered binomial
+*              distribution with parameter KYBER_ETA1. Same output as four
+*              calls of poly_getnoise_eta1, but the four PRF instances share
+*              each Keccak permutation.
+*
+* Arguments:   - poly *r0..r3: pointers to output polynomials
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+*              - uint8_t nonce0..nonce3: one-byte input nonces
+**************************************************/
+void poly_getnoise_eta1_4x(poly *r0,
+                           poly *r1,
+                           poly *r2,
+                           poly *r3,
+                           const uint8_t seed[KYBER_SYMBYTES],
+                           uint8_t nonce0,
+                           uint8_t nonce1,
+                           uint8_t nonce2,
+                           uint8_t nonce3)
+{
+  poly *r[4];
+  uint8_t nonce[4];
+
+  r[0] = r0;
+  r[1] = r1;
+  r[2] = r2;
+  r[3] = r3;
+  nonce[0] = nonce0;
+  nonce[1] = nonce1;
+  nonce[2] = nonce2;
+  nonce[3] = nonce3;
+  poly_getnoise_4x(r, 4, seed, nonce);
+}
+
+/*************************************************
+* Name:        poly_getnoise_eta1122_4x
+*
+* Description: Like poly_getnoise_eta1_4x, but r2 and r3 are sampled with
+*              parameter KYBER_ETA2; these two instances simply stop
+*              consuming their PRF streams earlier.
+*
+* Arguments:   - poly *r0..r3: pointers to output polynomials
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+*              - uint8_t nonce0..nonce3: one-byte input nonces
+**************************************************/
+void poly_getnoise_eta1122_4x(poly *r0,
+                              poly *r1,
+                              poly *r2,
+                              poly *r3,
+                              const uint8_t seed[KYBER_SYMBYTES],
+                              uint8_t nonce0,
+                              uint8_t nonce1,
+                              uint8_t nonce2,
+                              uint8_t nonce3)
+{
+  poly *r[4];
+  uint8_t nonce[4];
+
+  r[0] = r0;
+  r[1] = r1;
+  r[2] = r2;
+  r[3] = r3;
+  nonce[0] = nonce0;
+  nonce[1] = nonce1;
+  nonce[2] = nonce2;
+  nonce[3] = nonce3;
+  poly_getnoise_4x(r, 2, seed, nonce);
 }
+#endif
 
 
 /*************************************************
@@ -273,12 +815,101 @@ void poly_invntt_tomont(poly *r)
 void poly_basemul_montgomery(poly *r, const poly *a, const poly *b)
 {
   unsigned int i;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    basemul_avx2(r->coeffs, a->coeffs, b->coeffs);
+    return;
+  }
+#endif
+
   for(i=0;i<KYBER_N/4;i++) {
     basemul(&r->coeffs[4*i], &a->coeffs[4*i], &b->coeffs[4*i], zetas[64+i]);
     basemul(&r->coeffs[4*i+2], &a->coeffs[4*i+2], &b->coeffs[4*i+2], -zetas[64+i]);
   }
 }
 
+/*************************************************
+* Name:        poly_mulcache_compute
+*
+* Description: Computes the zeta-multiplied odd coefficients of a
+*              polynomial in NTT domain, for polyvec_basemul_acc_montgomery_cached
+*
+* Arguments:   - poly_mulcache *c: pointer to output cache
+*              - const poly *b: pointer to input polynomial
+**************************************************/
+void poly_mulcache_compute(poly_mulcache *c, const poly *b)
+{
+  basemul_cache(c->coeffs, b->coeffs);
+}
+
+#if KYBER_X86_64
+/* AVX2 version, as polyvec_basemul_acc_cached_avx2 in polyvec.c for a
+ * single polynomial, added to r */
+TARGET_AVX2
+static void poly_basemul_acc_cached_avx2(poly *r, const poly *a, const poly *b, const poly_mulcache *bc)
+{
+  const __m256i swap = _mm256_setr_epi8(2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13,
+                                        2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13);
+  const __m256i qinv = _mm256_set1_epi16(QINV);
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  __m256i va, vb, vz, t0, t1, u;
+  unsigned int j;
+
+  for(j=0;j<KYBER_N;j+=16) {
+    va = _mm256_loadu_si256((const __m256i *)&a->coeffs[j]);
+    vb = _mm256_loadu_si256((const __m256i *)&b->coeffs[j]);
+    vz = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&bc->coeffs[j/2]));
+    vz = _mm256_blend_epi16(vb, _mm256_slli_epi32(vz, 16), 0xAA);
+    t0 = _mm256_madd_epi16(va, vz);
+    t1 = _mm256_madd_epi16(va, _mm256_shuffle_epi8(vb, swap));
+
+    u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t0, qinv), q);
+    t0 = _mm256_sub_epi16(t0, _mm256_slli_epi32(u, 16));
+    u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t1, qinv), q);
+    t1 = _mm256_sub_epi16(t1, _mm256_slli_epi32(u, 16));
+    t0 = _mm256_blend_epi16(_mm256_srli_epi32(t0, 16), t1, 0xAA);
+    _mm256_storeu_si256((__m256i *)&r->coeffs[j],
+                        _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)&r->coeffs[j]), t0));
+  }
+}
+#endif
+
+/*************************************************
+* Name:        poly_basemul_acc_cached
+*
+* Description: Multiplication of two polynomials in NTT domain, multiplied
+*              by 2^-16 and added to r, with the zeta products of b taken
+*              from bc. Each product is reduced on its own, so r can be
+*              accumulated one polynomial at a time: requires |a| < 2^12
+*              and |b| <= q/2; every product is then below q in absolute
+*              value and the caller bounds the sum.
+*
+* Arguments:   - poly *r: pointer to input/output polynomial
+*              - const poly *a: pointer to first input polynomial
+*              - const poly *b: pointer to second input polynomial
+*              - const poly_mulcache *bc: pointer to cache of b
+**************************************************/
+void poly_basemul_acc_cached(poly *r, const poly *a, const poly *b, const poly_mulcache *bc)
+{
+  unsigned int j;
+  const int16_t *x, *y;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    poly_basemul_acc_cached_avx2(r, a, b, bc);
+    return;
+  }
+#endif
+
+  for(j=0;j<KYBER_N/2;j++) {
+    x = &a->coeffs[2*j];
+    y = &b->coeffs[2*j];
+    r->coeffs[2*j] += montgomery_reduce((int32_t)x[0]*y[0] + (int32_t)x[1]*bc->coeffs[j]);
+    r->coeffs[2*j+1] += montgomery_reduce((int32_t)x[0]*y[1] + (int32_t)x[1]*y[0]);
+  }
+}
+
 /*************************************************
 * Name:        poly_tomont
 *
@@ -295,6 +926,59 @@ void poly_tomont(poly *r)
     r->coeffs[i] = montgomery_reduce((int32_t)r->coeffs[i]*f);
 }
 
+#if (POLY_SWAR == 1)
+/*
+ * SIMD within a register: two int16 lanes per uint32_t. A word add or
+ * subtract is exact in the low lane; its carry (borrow) out of bit 15
+ * lands in the high lane and is taken back out. SWAR_LANES(x) is x
+ * in both lanes.
+ */
+#define SWAR_LANES(x) ((uint32_t)(x)*0x10001)
+#define SWAR_SIGN 0x80008000
+
+static inline uint32_t swar_add(uint32_t a, uint32_t b)
+{
+  uint32_t s = a + b;
+  return s - ((a ^ b ^ s) & 0x10000);
+}
+
+static inline uint32_t swar_sub(uint32_t a, uint32_t b)
+{
+  uint32_t d = a - b;
+  return d + ((a ^ b ^ d) & 0x10000);
+}
+
+/*************************************************
+* Name:        swar_barrett_reduce
+*
+* Description: barrett_reduce on both lanes of a word. Flipping the sign
+*              bits gives u = a + 2^15 in [0,2^16). A quotient estimate
+*              k with floor((u+2186)/q)-1 <= k <= floor((u+2186)/q) from
+*              ((u>>7)+17)*39>>10 (at most 528*39 < 2^16 per lane) puts
+*              u + q - k*q in [1143,1143+2q), and one conditional
+*              subtraction in [1143,1143+q). That is the centered
+*              representative plus 2807 = 2^15 - 9q, the same value
+*              as barrett_reduce. Carries between the lanes in the
+*              steps in between cancel, as every lane result fits.
+*
+* Arguments:   - uint32_t a: two int16 coefficients
+*
+* Returns two coefficients in {-(q-1)/2,...,(q-1)/2}
+**************************************************/
+static inline uint32_t swar_barrett_reduce(uint32_t a)
+{
+  uint32_t u, k;
+
+  u = a ^ SWAR_SIGN;
+  k = ((u >> 7) & SWAR_LANES(0x1FF)) + SWAR_LANES(17);
+  k = ((k*39) >> 10) & SWAR_LANES(0x3F);
+  u = u + SWAR_LANES(KYBER_Q) - k*KYBER_Q;
+  k = (u + SWAR_LANES(0x8000 - 1143 - KYBER_Q)) & SWAR_SIGN;
+  u -= (k >> 15)*KYBER_Q;
+  return (u + SWAR_LANES(9*KYBER_Q)) ^ SWAR_SIGN;
+}
+#endif
+
 /*************************************************
 * Name:        poly_reduce
 *
@@ -306,8 +990,13 @@ void poly_tomont(poly *r)
 void poly_reduce(poly *r)
 {
   unsigned int i;
+#if (POLY_SWAR == 1)
+  for(i=0;i<KYBER_N/2;i++)
+    r->words[i] = swar_barrett_reduce(r->words[i]);
+#else
   for(i=0;i<KYBER_N;i++)
     r->coeffs[i] = barrett_reduce(r->coeffs[i]);
+#endif
 }
 
 /*************************************************
@@ -322,8 +1011,13 @@ void poly_reduce(poly *r)
 void poly_add(poly *r, const poly *a, const poly *b)
 {
   unsigned int i;
+#if (POLY_SWAR == 1)
+  for(i=0;i<KYBER_N/2;i++)
+    r->words[i] = swar_add(a->words[i], b->words[i]);
+#else
   for(i=0;i<KYBER_N;i++)
     r->coeffs[i] = a->coeffs[i] + b->coeffs[i];
+#endif
 }
 
 /*************************************************
@@ -338,6 +1032,11 @@ void poly_add(poly *r, const poly *a, const poly *b)
 void poly_sub(poly *r, const poly *a, const poly *b)
 {
   unsigned int i;
+#if (POLY_SWAR == 1)
+  for(i=0;i<KYBER_N/2;i++)
+    r->words[i] = swar_sub(a->words[i], b->words[i]);
+#else
   for(i=0;i<KYBER_N;i++)
     r->coeffs[i] = a->coeffs[i] - b->coeffs[i];
+#endif
 }
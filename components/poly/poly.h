@@ -3,19 +3,35 @@
 
 #include <stdint.h>
 #include "params.h"
+#ifdef KYBER_90S
+#include "symmetric.h"
+#endif
 
 /*
  * Elements of R_q = Z_q[X]/(X^n + 1). Represents polynomial
- * coeffs[0] + X*coeffs[1] + X^2*coeffs[2] + ... + X^{n-1}*coeffs[n-1]
+ * coeffs[0] + X*coeffs[1] + X^2*coeffs[2] + ... + X^{n-1}*coeffs[n-1].
+ * With POLY_SWAR=1, poly_add, poly_sub and poly_reduce work on words,
+ * two coefficients per 32-bit word (either byte order).
  */
-typedef struct{
+typedef union{
   int16_t coeffs[KYBER_N];
+  uint32_t words[KYBER_N/2];
 } poly;
 
+/*
+ * Products b[2i+1]*zeta of a polynomial b in NTT domain with the zetas of
+ * its 128 degree-one factors (see poly_mulcache_compute)
+ */
+typedef struct{
+  int16_t coeffs[KYBER_N/2];
+} poly_mulcache;
+
 #define poly_compress KYBER_NAMESPACE(poly_compress)
 void poly_compress(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], const poly *a);
 #define poly_decompress KYBER_NAMESPACE(poly_decompress)
 void poly_decompress(poly *r, const uint8_t a[KYBER_POLYCOMPRESSEDBYTES]);
+#define poly_invntt_add_compress KYBER_NAMESPACE(poly_invntt_add_compress)
+void poly_invntt_add_compress(uint8_t r[KYBER_POLYCOMPRESSEDBYTES], poly *a, const poly *e);
 
 #define poly_tobytes KYBER_NAMESPACE(poly_tobytes)
 void poly_tobytes(uint8_t r[KYBER_POLYBYTES], const poly *a);
@@ -33,12 +49,46 @@ void poly_getnoise_eta1(poly *r, const uint8_t seed[KYBER_SYMBYTES], uint8_t non
 #define poly_getnoise_eta2 KYBER_NAMESPACE(poly_getnoise_eta2)
 void poly_getnoise_eta2(poly *r, const uint8_t seed[KYBER_SYMBYTES], uint8_t nonce);
 
+#ifdef KYBER_90S
+#define poly_getnoise_eta1_keyed KYBER_NAMESPACE(poly_getnoise_eta1_keyed)
+void poly_getnoise_eta1_keyed(poly *r, prf_key *key, uint8_t nonce);
+
+#define poly_getnoise_eta2_keyed KYBER_NAMESPACE(poly_getnoise_eta2_keyed)
+void poly_getnoise_eta2_keyed(poly *r, prf_key *key, uint8_t nonce);
+#else
+#define poly_getnoise_eta1_4x KYBER_NAMESPACE(poly_getnoise_eta1_4x)
+void poly_getnoise_eta1_4x(poly *r0,
+                           poly *r1,
+                           poly *r2,
+                           poly *r3,
+                           const uint8_t seed[KYBER_SYMBYTES],
+                           uint8_t nonce0,
+                           uint8_t nonce1,
+                           uint8_t nonce2,
+                           uint8_t nonce3);
+
+#define poly_getnoise_eta1122_4x KYBER_NAMESPACE(poly_getnoise_eta1122_4x)
+void poly_getnoise_eta1122_4x(poly *r0,
+                              poly *r1,
+                              poly *r2,
+                              poly *r3,
+                              const uint8_t seed[KYBER_SYMBYTES],
+                              uint8_t nonce0,
+                              uint8_t nonce1,
+                              uint8_t nonce2,
+                              uint8_t nonce3);
+#endif
+
 #define poly_ntt KYBER_NAMESPACE(poly_ntt)
 void poly_ntt(poly *r);
 #define poly_invntt_tomont KYBER_NAMESPACE(poly_invntt_tomont)
 void poly_invntt_tomont(poly *r);
 #define poly_basemul_montgomery KYBER_NAMESPACE(poly_basemul_montgomery)
 void poly_basemul_montgomery(poly *r, const poly *a, const poly *b);
+#define poly_mulcache_compute KYBER_NAMESPACE(poly_mulcache_compute)
+void poly_mulcache_compute(poly_mulcache *c, const poly *b);
+#define poly_basemul_acc_cached KYBER_NAMESPACE(poly_basemul_acc_cached)
+void poly_basemul_acc_cached(poly *r, const poly *a, const poly *b, const poly_mulcache *bc);
 #define poly_tomont KYBER_NAMESPACE(poly_tomont)
 void poly_tomont(poly *r);
 
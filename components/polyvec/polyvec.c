@@ -1,66 +1,405 @@
 #include <stdint.h>
+#include <string.h>
 #include "params.h"
 #include "poly.h"
 #include "polyvec.h"
+#include "reduce.h"
+#include "ntt.h"
+#include "cpufeatures.h"
+#include "avx2.h"
+
+/* Bytes per 8 compressed coefficients */
+#define COMPRESS8_BYTES (KYBER_POLYVECCOMPRESSEDBYTES/(KYBER_K*32))
+
+#if KYBER_X86_64
+/* Stores the first n bytes of the low and high 128-bit lane of v to r0 and r1 */
+TARGET_AVX2
+static inline void storeu_lanes2(uint8_t *r0, uint8_t *r1, __m256i v, unsigned int n)
+{
+  uint8_t buf[32];
+
+  _mm256_storeu_si256((__m256i *)buf, v);
+  memcpy(r0, buf, n);
+  memcpy(r1, buf + 16, n);
+}
 
 /*************************************************
-* Name:        polyvec_compress
+* Name:        compress16_avx2
+*
+* Description: AVX2 compression of 16 coefficients of the vector, same
+*              output as the portable code for all coefficients in
+*              {-q+1,...,q-1}. After mapping to {0,...,q-1}, x*2^d/q is
+*              mulhi_epi16(8x, 20159 ~ 2^26/q) with a one-off correction
+*              from the low half of the product (mullo_epi16), then
+*              rounded by mulhrs_epi16. Fields are merged with madd_epi16
+*              and 64-bit shifts; see poly_compress_avx2 in poly.c.
+*
+* Returns the d bytes of the 8 coefficients of each 128-bit lane of f0
+* at the start of that lane.
+**************************************************/
+TARGET_AVX2
+static inline __m256i compress16_avx2(__m256i f0)
+{
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  const __m256i v = _mm256_set1_epi16(20159);
+  const __m256i v8 = _mm256_set1_epi16((int16_t)(20159*8));
+  __m256i f1, f2;
+
+#if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
+  const __m256i off = _mm256_set1_epi16(36);
+  const __m256i shift1 = _mm256_set1_epi16(1 << 13);
+  const __m256i mask = _mm256_set1_epi16(2047);
+  const __m256i shift2 = _mm256_set1_epi32((2048 << 16) + 1);
+  const __m256i shift3 = _mm256_setr_epi64x(0, 4, 0, 4);
+  const __m256i shufbidx0 = _mm256_setr_epi8(0,1,2,3,4,5,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+                                             0,1,2,3,4,5,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1);
+  const __m256i shufbidx1 = _mm256_setr_epi8(-1,-1,-1,-1,-1,8,9,10,11,12,13,-1,-1,-1,-1,-1,
+                                             -1,-1,-1,-1,-1,8,9,10,11,12,13,-1,-1,-1,-1,-1);
+#elif (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 320))
+  const __m256i off = _mm256_set1_epi16(15);
+  const __m256i shift1 = _mm256_set1_epi16(1 << 12);
+  const __m256i mask = _mm256_set1_epi16(1023);
+  const __m256i shift2 = _mm256_set1_epi32((1024 << 16) + 1);
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,2,3,4,8,9,10,11,12,-1,-1,-1,-1,-1,-1,
+                                            0,1,2,3,4,8,9,10,11,12,-1,-1,-1,-1,-1,-1);
+#else
+#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
+#endif
+
+  f0 = _mm256_add_epi16(f0, _mm256_and_si256(_mm256_srai_epi16(f0, 15), q));
+  f1 = _mm256_mullo_epi16(f0, v8);
+  f2 = _mm256_add_epi16(f0, off);
+  f0 = _mm256_mulhi_epi16(_mm256_slli_epi16(f0, 3), v);
+  f2 = _mm256_sub_epi16(f1, f2);
+  f1 = _mm256_srli_epi16(_mm256_andnot_si256(f1, f2), 15);
+  f0 = _mm256_sub_epi16(f0, f1);
+  f0 = _mm256_and_si256(_mm256_mulhrs_epi16(f0, shift1), mask);
+  /* 2 and 4 fields per 32-bit and 64-bit lane */
+  f0 = _mm256_madd_epi16(f0, shift2);
+#if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
+  f0 = _mm256_add_epi64(_mm256_blend_epi32(f0, _mm256_setzero_si256(), 0xAA),
+                        _mm256_slli_epi64(_mm256_srli_epi64(f0, 32), 22));
+  /* 44 + 44 bits: byte 5 is shared by both 64-bit lanes */
+  f0 = _mm256_sllv_epi64(f0, shift3);
+  return _mm256_or_si256(_mm256_shuffle_epi8(f0, shufbidx0), _mm256_shuffle_epi8(f0, shufbidx1));
+#else
+  f0 = _mm256_add_epi64(_mm256_blend_epi32(f0, _mm256_setzero_si256(), 0xAA),
+                        _mm256_slli_epi64(_mm256_srli_epi64(f0, 32), 20));
+  return _mm256_shuffle_epi8(f0, shufbidx);
+#endif
+}
+
+/*************************************************
+* Name:        polyvec_poly_compress_avx2
+*
+* Description: AVX2 compression of one polynomial of the vector
+**************************************************/
+TARGET_AVX2
+static void polyvec_poly_compress_avx2(uint8_t *r, const poly *a)
+{
+  unsigned int i;
+  __m256i f;
+
+  for(i=0;i<KYBER_N/16;i++) {
+    f = compress16_avx2(_mm256_loadu_si256((const __m256i *)&a->coeffs[16*i]));
+    storeu_lanes2(&r[2*COMPRESS8_BYTES*i], &r[(2*i+1)*COMPRESS8_BYTES], f, COMPRESS8_BYTES);
+  }
+}
+
+/*************************************************
+* Name:        decompress16_avx2
+*
+* Description: AVX2 decompression of 16 coefficients:
+*              mulhrs_epi16(x*2^(15-d), q) == (x*q + 2^(d-1)) >> d.
+*              Each 128-bit lane unpacks 8 coefficients from bytes of
+*              an overlapping 16-byte load, so nothing past the 2*d
+*              bytes at a is read.
+**************************************************/
+TARGET_AVX2
+static inline __m256i decompress16_avx2(const uint8_t *a)
+{
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  __m256i f;
+
+#if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
+  /* 22 bytes per 16 coefficients; the upper lane holds bytes 6-21. An
+   * 11-bit field spans up to 3 bytes, so unpack into 32-bit lanes */
+  const __m256i shufbidx0 = _mm256_setr_epi8(0,1,-1,-1,1,2,-1,-1,2,3,4,-1,4,5,-1,-1,
+                                             5,6,-1,-1,6,7,-1,-1,7,8,9,-1,9,10,-1,-1);
+  const __m256i shufbidx1 = _mm256_setr_epi8(5,6,-1,-1,6,7,8,-1,8,9,-1,-1,9,10,-1,-1,
+                                             10,11,-1,-1,11,12,13,-1,13,14,-1,-1,14,15,-1,-1);
+  const __m256i srlvdidx0 = _mm256_setr_epi32(0,3,6,1,0,3,6,1);
+  const __m256i srlvdidx1 = _mm256_setr_epi32(4,7,2,5,4,7,2,5);
+  const __m256i mask = _mm256_set1_epi32(2047);
+  __m256i g, f1;
+
+  g = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+                              _mm_loadu_si128((const __m128i *)(a + 6)), 1);
+  f = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(g, shufbidx0), srlvdidx0), mask);
+  f1 = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(g, shufbidx1), srlvdidx1), mask);
+  f = _mm256_slli_epi16(_mm256_packus_epi32(f, f1), 4);
+#elif (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 320))
+  /* 20 bytes per 16 coefficients; the upper lane holds bytes 4-19 */
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,1,2,2,3,3,4,5,6,6,7,7,8,8,9,
+                                            6,7,7,8,8,9,9,10,11,12,12,13,13,14,14,15);
+  const __m256i shift = _mm256_setr_epi16(64,16,4,1,64,16,4,1,64,16,4,1,64,16,4,1);
+  const __m256i mask = _mm256_set1_epi16(0x7FE0);
+
+  f = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+                              _mm_loadu_si128((const __m128i *)(a + 4)), 1);
+  f = _mm256_mullo_epi16(_mm256_shuffle_epi8(f, shufbidx), shift);
+  f = _mm256_and_si256(_mm256_srli_epi16(f, 1), mask);
+#else
+#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
+#endif
+  return _mm256_mulhrs_epi16(f, q);
+}
+
+/*************************************************
+* Name:        polyvec_poly_decompress_avx2
+*
+* Description: AVX2 decompression of one polynomial of the vector
+**************************************************/
+TARGET_AVX2
+static void polyvec_poly_decompress_avx2(poly *r, const uint8_t *a)
+{
+  unsigned int i;
+
+  for(i=0;i<KYBER_N/16;i++)
+    _mm256_storeu_si256((__m256i *)&r->coeffs[16*i],
+                        decompress16_avx2(&a[2*COMPRESS8_BYTES*i]));
+}
+
+/*************************************************
+* Name:        poly_decompress_ntt_avx2
 *
-* Description: Compress and serialize vector of polynomials
+* Description: AVX2 decompression of one polynomial of the vector into
+*              the first layer of ntt_avx2: r[i] and r[i+128] go through
+*              the same butterfly in registers before they are stored,
+*              then ntt_finish_avx2 runs layers 2-7
+**************************************************/
+TARGET_AVX2
+static void poly_decompress_ntt_avx2(int16_t r[KYBER_N], const uint8_t *a)
+{
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  const __m256i z = _mm256_set1_epi16(zetas[1]);
+  const __m256i zq = _mm256_set1_epi16((int16_t)(zetas[1]*QINV));
+  __m256i x, y, t;
+  unsigned int i;
+
+  for(i=0;i<KYBER_N/2;i+=16) {
+    x = decompress16_avx2(&a[i/8*COMPRESS8_BYTES]);
+    y = decompress16_avx2(&a[(i + 128)/8*COMPRESS8_BYTES]);
+    /* fqmul(y, zetas[1]) as fqmul_avx2 in ntt.c */
+    t = _mm256_mulhi_epi16(_mm256_mullo_epi16(y, zq), q);
+    t = _mm256_sub_epi16(_mm256_mulhi_epi16(y, z), t);
+    _mm256_storeu_si256((__m256i *)&r[i], _mm256_add_epi16(x, t));
+    _mm256_storeu_si256((__m256i *)&r[i + 128], _mm256_sub_epi16(x, t));
+  }
+  ntt_finish_avx2(r);
+}
+
+/*************************************************
+* Name:        polyvec_add_compress_strip_avx2
+*
+* Description: AVX2 tail of polyvec_invntt_add_compress on the strip j
+*              of one polynomial a: adds e, reduces and compresses the
+*              4 runs of 8 coefficients at j, 64+j, 128+j and 192+j,
+*              one run per 128-bit lane.
+**************************************************/
+TARGET_AVX2
+static void polyvec_add_compress_strip_avx2(uint8_t *r, const poly *a, const poly *e, unsigned int j)
+{
+  unsigned int k;
+  __m256i f;
+
+  for(k=0;k<4;k+=2) {
+    f = _mm256_add_epi16(loadu_strip(&a->coeffs[64*k + j]), loadu_strip(&e->coeffs[64*k + j]));
+    f = compress16_avx2(barrett_avx2(f));
+    storeu_lanes2(&r[(64*k + j)/8*COMPRESS8_BYTES], &r[(64*k + 64 + j)/8*COMPRESS8_BYTES],
+                 f, COMPRESS8_BYTES);
+  }
+}
+#endif
+
+/*************************************************
+* Name:        polyvec_compress8
+*
+* Description: Compression and serialization of the 8 coefficients
+*              a[0..7] to KYBER_POLYVECCOMPRESSEDBYTES/(32*KYBER_K) bytes.
+*              The rounded division by q is a multiplication and shift
+*              (exact for all inputs), so no variable-time divide.
 *
 * Arguments:   - uint8_t *r: pointer to output byte array
-*                            (needs space for KYBER_POLYVECCOMPRESSEDBYTES)
-*              - const polyvec *a: pointer to input vector of polynomials
+*              - const int16_t *a: pointer to input coefficients
+*                                  (in {-q+1,...,q-1})
 **************************************************/
-void polyvec_compress(uint8_t r[KYBER_POLYVECCOMPRESSEDBYTES], const polyvec *a)
+static inline void polyvec_compress8(uint8_t *r, const int16_t a[8])
 {
-  unsigned int i,j,k;
+  unsigned int k;
+  uint64_t d0;
 
 #if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
   uint16_t t[8];
-  for(i=0;i<KYBER_K;i++) {
-    for(j=0;j<KYBER_N/8;j++) {
-      for(k=0;k<8;k++) {
-        t[k]  = a->vec[i].coeffs[8*j+k];
-        t[k] += ((int16_t)t[k] >> 15) & KYBER_Q;
-        t[k]  = ((((uint32_t)t[k] << 11) + KYBER_Q/2)/KYBER_Q) & 0x7ff;
-      }
+  for(k=0;k<8;k++) {
+    t[k]  = a[k];
+    t[k] += ((int16_t)t[k] >> 15) & KYBER_Q;
+    /* t[k] = ((((uint32_t)t[k] << 11) + KYBER_Q/2)/KYBER_Q) & 0x7ff; */
+    d0 = (uint64_t)(((uint32_t)t[k] << 11) + 1664) * 645084;
+    t[k] = (d0 >> 31) & 0x7ff;
+  }
 
-      r[ 0] = (t[0] >>  0);
-      r[ 1] = (t[0] >>  8) | (t[1] << 3);
-      r[ 2] = (t[1] >>  5) | (t[2] << 6);
-      r[ 3] = (t[2] >>  2);
-      r[ 4] = (t[2] >> 10) | (t[3] << 1);
-      r[ 5] = (t[3] >>  7) | (t[4] << 4);
-      r[ 6] = (t[4] >>  4) | (t[5] << 7);
-      r[ 7] = (t[5] >>  1);
-      r[ 8] = (t[5] >>  9) | (t[6] << 2);
-      r[ 9] = (t[6] >>  6) | (t[7] << 5);
-      r[10] = (t[7] >>  3);
-      r += 11;
-    }
+  r[ 0] = (t[0] >>  0);
+  r[ 1] = (t[0] >>  8) | (t[1] << 3);
+  r[ 2] = (t[1] >>  5) | (t[2] << 6);
+  r[ 3] = (t[2] >>  2);
+  r[ 4] = (t[2] >> 10) | (t[3] << 1);
+  r[ 5] = (t[3] >>  7) | (t[4] << 4);
+  r[ 6] = (t[4] >>  4) | (t[5] << 7);
+  r[ 7] = (t[5] >>  1);
+  r[ 8] = (t[5] >>  9) | (t[6] << 2);
+  r[ 9] = (t[6] >>  6) | (t[7] << 5);
+  r[10] = (t[7] >>  3);
+#elif (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 320))
+  uint16_t t[8];
+  for(k=0;k<8;k++) {
+    t[k]  = a[k];
+    t[k] += ((int16_t)t[k] >> 15) & KYBER_Q;
+    /* t[k] = ((((uint32_t)t[k] << 10) + KYBER_Q/2)/ KYBER_Q) & 0x3ff; */
+    d0 = (uint64_t)(((uint32_t)t[k] << 10) + 1665) * 1290167;
+    t[k] = (d0 >> 32) & 0x3ff;
   }
+
+  for(k=0;k<2;k++) {
+    r[5*k+0] = (t[4*k+0] >> 0);
+    r[5*k+1] = (t[4*k+0] >> 8) | (t[4*k+1] << 2);
+    r[5*k+2] = (t[4*k+1] >> 6) | (t[4*k+2] << 4);
+    r[5*k+3] = (t[4*k+2] >> 4) | (t[4*k+3] << 6);
+    r[5*k+4] = (t[4*k+3] >> 2);
+  }
+#else
+#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
+#endif
+}
+
+/*************************************************
+* Name:        polyvec_decompress8
+*
+* Description: De-serialization and decompression of 8 coefficients
+*              from KYBER_POLYVECCOMPRESSEDBYTES/(32*KYBER_K) bytes;
+*              approximate inverse of polyvec_compress8
+*
+* Arguments:   - int16_t *r: pointer to output coefficients
+*              - const uint8_t *a: pointer to input byte array
+**************************************************/
+static void polyvec_decompress8(int16_t r[8], const uint8_t *a)
+{
+  unsigned int k;
+
+#if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
+  uint16_t t[8];
+  t[0] = (a[0] >> 0) | ((uint16_t)a[ 1] << 8);
+  t[1] = (a[1] >> 3) | ((uint16_t)a[ 2] << 5);
+  t[2] = (a[2] >> 6) | ((uint16_t)a[ 3] << 2) | ((uint16_t)a[4] << 10);
+  t[3] = (a[4] >> 1) | ((uint16_t)a[ 5] << 7);
+  t[4] = (a[5] >> 4) | ((uint16_t)a[ 6] << 4);
+  t[5] = (a[6] >> 7) | ((uint16_t)a[ 7] << 1) | ((uint16_t)a[8] << 9);
+  t[6] = (a[8] >> 2) | ((uint16_t)a[ 9] << 6);
+  t[7] = (a[9] >> 5) | ((uint16_t)a[10] << 3);
+
+  for(k=0;k<8;k++)
+    r[k] = ((uint32_t)(t[k] & 0x7FF)*KYBER_Q + 1024) >> 11;
 #elif (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 320))
-  uint16_t t[4];
+  uint16_t t[8];
+  for(k=0;k<2;k++) {
+    t[4*k+0] = (a[5*k+0] >> 0) | ((uint16_t)a[5*k+1] << 8);
+    t[4*k+1] = (a[5*k+1] >> 2) | ((uint16_t)a[5*k+2] << 6);
+    t[4*k+2] = (a[5*k+2] >> 4) | ((uint16_t)a[5*k+3] << 4);
+    t[4*k+3] = (a[5*k+3] >> 6) | ((uint16_t)a[5*k+4] << 2);
+  }
+
+  for(k=0;k<8;k++)
+    r[k] = ((uint32_t)(t[k] & 0x3FF)*KYBER_Q + 512) >> 10;
+#else
+#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
+#endif
+}
+
+/*************************************************
+* Name:        polyvec_compress
+*
+* Description: Compress and serialize vector of polynomials. The
+*              rounded division by q is a multiplication and shift
+*              (exact for all inputs), so no variable-time divide.
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (needs space for KYBER_POLYVECCOMPRESSEDBYTES)
+*              - const polyvec *a: pointer to input vector of polynomials
+*                                  (coefficients in {-q+1,...,q-1})
+**************************************************/
+void polyvec_compress(uint8_t r[KYBER_POLYVECCOMPRESSEDBYTES], const polyvec *a)
+{
+  unsigned int i,j;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    for(i=0;i<KYBER_K;i++)
+      polyvec_poly_compress_avx2(r + i*KYBER_POLYVECCOMPRESSEDBYTES/KYBER_K, &a->vec[i]);
+    return;
+  }
+#endif
+
+  for(i=0;i<KYBER_K;i++)
+    for(j=0;j<KYBER_N/8;j++)
+      polyvec_compress8(&r[(i*KYBER_N/8 + j)*COMPRESS8_BYTES], &a->vec[i].coeffs[8*j]);
+}
+
+/*************************************************
+* Name:        polyvec_invntt_add_compress
+*
+* Description: Fused polyvec_invntt_tomont, polyvec_add of e,
+*              polyvec_reduce and polyvec_compress: per polynomial, the
+*              last invntt pass runs a strip of 4x8 coefficients at a
+*              time (invntt_finish), and each strip is reduced and
+*              compressed while still in L1 instead of four more passes
+*              over the vector. Same output as the separate calls.
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (needs space for KYBER_POLYVECCOMPRESSEDBYTES)
+*              - polyvec *a: pointer to input vector in NTT domain;
+*                            overwritten
+*              - const polyvec *e: pointer to vector added after the invntt
+*                                  (|e| < 2^14)
+**************************************************/
+void polyvec_invntt_add_compress(uint8_t r[KYBER_POLYVECCOMPRESSEDBYTES],
+                                 polyvec *a,
+                                 const polyvec *e)
+{
+  unsigned int i, j, k, l;
+  uint8_t *ri;
+  const int16_t *c;
+  int16_t t[32];
+
   for(i=0;i<KYBER_K;i++) {
-    for(j=0;j<KYBER_N/4;j++) {
+    ri = r + i*KYBER_POLYVECCOMPRESSEDBYTES/KYBER_K;
+    invntt_begin(a->vec[i].coeffs);
+    for(j=0;j<KYBER_N/4;j+=8) {
+      invntt_finish(a->vec[i].coeffs, j);
+#if KYBER_X86_64
+      if(cpu_has_avx2()) {
+        polyvec_add_compress_strip_avx2(ri, &a->vec[i], &e->vec[i], j);
+        continue;
+      }
+#endif
       for(k=0;k<4;k++) {
-        t[k]  = a->vec[i].coeffs[4*j+k];
-        t[k] += ((int16_t)t[k] >> 15) & KYBER_Q;
-        t[k]  = ((((uint32_t)t[k] << 10) + KYBER_Q/2)/ KYBER_Q) & 0x3ff;
+        c = &a->vec[i].coeffs[64*k + j];
+        for(l=0;l<8;l++)
+          t[8*k+l] = barrett_reduce(c[l] + e->vec[i].coeffs[64*k + j + l]);
       }
-
-      r[0] = (t[0] >> 0);
-      r[1] = (t[0] >> 8) | (t[1] << 2);
-      r[2] = (t[1] >> 6) | (t[2] << 4);
-      r[3] = (t[2] >> 4) | (t[3] << 6);
-      r[4] = (t[3] >> 2);
-      r += 5;
+      for(k=0;k<4;k++)
+        polyvec_compress8(&ri[(64*k + j)/8*COMPRESS8_BYTES], t+8*k);
     }
   }
-#else
-#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
-#endif
 }
 
 /*************************************************
@@ -75,43 +414,52 @@ void polyvec_compress(uint8_t r[KYBER_POLYVECCOMPRESSEDBYTES], const polyvec *a)
 **************************************************/
 void polyvec_decompress(polyvec *r, const uint8_t a[KYBER_POLYVECCOMPRESSEDBYTES])
 {
-  unsigned int i,j,k;
+  unsigned int i,j;
 
-#if (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 352))
-  uint16_t t[8];
-  for(i=0;i<KYBER_K;i++) {
-    for(j=0;j<KYBER_N/8;j++) {
-      t[0] = (a[0] >> 0) | ((uint16_t)a[ 1] << 8);
-      t[1] = (a[1] >> 3) | ((uint16_t)a[ 2] << 5);
-      t[2] = (a[2] >> 6) | ((uint16_t)a[ 3] << 2) | ((uint16_t)a[4] << 10);
-      t[3] = (a[4] >> 1) | ((uint16_t)a[ 5] << 7);
-      t[4] = (a[5] >> 4) | ((uint16_t)a[ 6] << 4);
-      t[5] = (a[6] >> 7) | ((uint16_t)a[ 7] << 1) | ((uint16_t)a[8] << 9);
-      t[6] = (a[8] >> 2) | ((uint16_t)a[ 9] << 6);
-      t[7] = (a[9] >> 5) | ((uint16_t)a[10] << 3);
-      a += 11;
-
-      for(k=0;k<8;k++)
-        r->vec[i].coeffs[8*j+k] = ((uint32_t)(t[k] & 0x7FF)*KYBER_Q + 1024) >> 11;
-    }
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    for(i=0;i<KYBER_K;i++)
+      polyvec_poly_decompress_avx2(&r->vec[i], a + i*KYBER_POLYVECCOMPRESSEDBYTES/KYBER_K);
+    return;
   }
-#elif (KYBER_POLYVECCOMPRESSEDBYTES == (KYBER_K * 320))
-  uint16_t t[4];
-  for(i=0;i<KYBER_K;i++) {
-    for(j=0;j<KYBER_N/4;j++) {
-      t[0] = (a[0] >> 0) | ((uint16_t)a[1] << 8);
-      t[1] = (a[1] >> 2) | ((uint16_t)a[2] << 6);
-      t[2] = (a[2] >> 4) | ((uint16_t)a[3] << 4);
-      t[3] = (a[3] >> 6) | ((uint16_t)a[4] << 2);
-      a += 5;
+#endif
 
-      for(k=0;k<4;k++)
-        r->vec[i].coeffs[4*j+k] = ((uint32_t)(t[k] & 0x3FF)*KYBER_Q + 512) >> 10;
+  for(i=0;i<KYBER_K;i++)
+    for(j=0;j<KYBER_N/8;j++)
+      polyvec_decompress8(&r->vec[i].coeffs[8*j], &a[(i*KYBER_N/8 + j)*COMPRESS8_BYTES]);
+}
+
+/*************************************************
+* Name:        polyvec_decompress_ntt
+*
+* Description: Fused polyvec_decompress and polyvec_ntt, one polynomial
+*              at a time. With AVX2 the decompressed coefficients go
+*              through the first NTT layer in registers instead of a
+*              store and reload. Same output as the separate calls.
+*
+* Arguments:   - polyvec *r: pointer to output vector of polynomials
+*                            (NTT domain, reduced as by poly_ntt)
+*              - const uint8_t *a: pointer to input byte array
+*                                  (of length KYBER_POLYVECCOMPRESSEDBYTES)
+**************************************************/
+void polyvec_decompress_ntt(polyvec *r, const uint8_t a[KYBER_POLYVECCOMPRESSEDBYTES])
+{
+  unsigned int i, j;
+  const uint8_t *ai;
+
+  for(i=0;i<KYBER_K;i++) {
+    ai = a + i*KYBER_POLYVECCOMPRESSEDBYTES/KYBER_K;
+#if KYBER_X86_64
+    if(cpu_has_avx2()) {
+      poly_decompress_ntt_avx2(r->vec[i].coeffs, ai);
+      poly_reduce(&r->vec[i]);
+      continue;
     }
-  }
-#else
-#error "KYBER_POLYVECCOMPRESSEDBYTES needs to be in {320*KYBER_K, 352*KYBER_K}"
 #endif
+    for(j=0;j<KYBER_N/8;j++)
+      polyvec_decompress8(&r->vec[i].coeffs[8*j], &ai[j*COMPRESS8_BYTES]);
+    poly_ntt(&r->vec[i]);
+  }
 }
 
 /*************************************************
@@ -187,17 +535,362 @@ void polyvec_invntt_tomont(polyvec *r)
 *            - const polyvec *b: pointer to second input vector of polynomials
 **************************************************/
 void polyvec_basemul_acc_montgomery(poly *r, const polyvec *a, const polyvec *b)
+{
+  polyvec_mulcache bc;
+
+  polyvec_mulcache_compute(&bc, b);
+  polyvec_basemul_acc_montgomery_cached(r, a, b, &bc);
+}
+
+/*************************************************
+* Name:        polyvec_mulcache_compute
+*
+* Description: Computes the zeta-multiplied odd coefficients of all
+*              elements of b (see poly_mulcache_compute); done once for
+*              a vector that is multiplied with several others
+*
+* Arguments: - polyvec_mulcache *c: pointer to output cache
+*            - const polyvec *b: pointer to input vector of polynomials
+**************************************************/
+void polyvec_mulcache_compute(polyvec_mulcache *c, const polyvec *b)
 {
   unsigned int i;
-  poly t;
+  for(i=0;i<KYBER_K;i++)
+    poly_mulcache_compute(&c->vec[i], &b->vec[i]);
+}
+
+#if KYBER_X86_64
+/*************************************************
+* Name:        polyvec_basemul_acc_cached_avx2
+*
+* Description: AVX2 version of polyvec_basemul_acc_montgomery_cached.
+*              _mm256_madd_epi16 on the interleaved coefficients gives
+*              a0*b0 + a1*b1*zeta and (with b's pairs swapped)
+*              a0*b1 + a1*b0 as int32; the Montgomery reduction of the
+*              sums leaves the result in the high halves. Same output
+*              as the portable code.
+**************************************************/
+TARGET_AVX2
+static inline __m256i basemul_acc16_avx2(const polyvec *a,
+                                         const polyvec *b,
+                                         const polyvec_mulcache *bc,
+                                         unsigned int j)
+{
+  const __m256i swap = _mm256_setr_epi8(2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13,
+                                        2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13);
+  const __m256i qinv = _mm256_set1_epi16(QINV);
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  __m256i va, vb, vz, t0, t1, u;
+  unsigned int i;
+
+  t0 = t1 = _mm256_setzero_si256();
+  for(i=0;i<KYBER_K;i++) {
+    va = _mm256_loadu_si256((const __m256i *)&a->vec[i].coeffs[j]);
+    vb = _mm256_loadu_si256((const __m256i *)&b->vec[i].coeffs[j]);
+    vz = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&bc->vec[i].coeffs[j/2]));
+    vz = _mm256_blend_epi16(vb, _mm256_slli_epi32(vz, 16), 0xAA);
+    t0 = _mm256_add_epi32(t0, _mm256_madd_epi16(va, vz));
+    t1 = _mm256_add_epi32(t1, _mm256_madd_epi16(va, _mm256_shuffle_epi8(vb, swap)));
+  }
+
+  /* (t - (int16_t)(t*QINV)*q) >> 16 in the high 16 bits of each lane */
+  u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t0, qinv), q);
+  t0 = _mm256_sub_epi16(t0, _mm256_slli_epi32(u, 16));
+  u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t1, qinv), q);
+  t1 = _mm256_sub_epi16(t1, _mm256_slli_epi32(u, 16));
+  return _mm256_blend_epi16(_mm256_srli_epi32(t0, 16), t1, 0xAA);
+}
+
+/*************************************************
+* Name:        frombytes16_avx2
+*
+* Description: Unpacks 16 12-bit coefficients from the 24 bytes at a
+*              (as poly_frombytes_avx2 in poly.c)
+**************************************************/
+TARGET_AVX2
+static inline __m256i frombytes16_avx2(const uint8_t *a)
+{
+  /* The upper lane holds bytes 8-23 */
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,1,2,3,4,4,5,6,7,7,8,9,10,10,11,
+                                            4,5,5,6,7,8,8,9,10,11,11,12,13,14,14,15);
+  const __m256i shift = _mm256_setr_epi16(16,1,16,1,16,1,16,1,16,1,16,1,16,1,16,1);
+  __m256i f;
+
+  f = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)a)),
+                              _mm_loadu_si128((const __m128i *)(a + 8)), 1);
+  f = _mm256_mullo_epi16(_mm256_shuffle_epi8(f, shufbidx), shift);
+  return _mm256_srli_epi16(f, 4);
+}
 
-  poly_basemul_montgomery(r, &a->vec[0], &b->vec[0]);
-  for(i=1;i<KYBER_K;i++) {
-    poly_basemul_montgomery(&t, &a->vec[i], &b->vec[i]);
-    poly_add(r, r, &t);
+/*************************************************
+* Name:        polyvec_basemul_acc_packed_avx2
+*
+* Description: AVX2 version of polyvec_basemul_acc_packed; as
+*              polyvec_basemul_acc_cached_avx2 with the coefficients of
+*              a unpacked in registers
+**************************************************/
+TARGET_AVX2
+static void polyvec_basemul_acc_packed_avx2(poly *r,
+                                            const uint8_t a[KYBER_POLYVECBYTES],
+                                            const polyvec *b,
+                                            const polyvec_mulcache *bc)
+{
+  const __m256i swap = _mm256_setr_epi8(2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13,
+                                        2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13);
+  const __m256i qinv = _mm256_set1_epi16(QINV);
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  __m256i va, vb, vz, t0, t1, u;
+  unsigned int i, j;
+
+  for(j=0;j<KYBER_N;j+=16) {
+    t0 = t1 = _mm256_setzero_si256();
+    for(i=0;i<KYBER_K;i++) {
+      va = frombytes16_avx2(&a[i*KYBER_POLYBYTES + 3*j/2]);
+      vb = _mm256_loadu_si256((const __m256i *)&b->vec[i].coeffs[j]);
+      vz = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&bc->vec[i].coeffs[j/2]));
+      vz = _mm256_blend_epi16(vb, _mm256_slli_epi32(vz, 16), 0xAA);
+      t0 = _mm256_add_epi32(t0, _mm256_madd_epi16(va, vz));
+      t1 = _mm256_add_epi32(t1, _mm256_madd_epi16(va, _mm256_shuffle_epi8(vb, swap)));
+    }
+
+    u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t0, qinv), q);
+    t0 = _mm256_sub_epi16(t0, _mm256_slli_epi32(u, 16));
+    u = _mm256_mulhi_epi16(_mm256_mullo_epi16(t1, qinv), q);
+    t1 = _mm256_sub_epi16(t1, _mm256_slli_epi32(u, 16));
+    _mm256_storeu_si256((__m256i *)&r->coeffs[j],
+                        _mm256_blend_epi16(_mm256_srli_epi32(t0, 16), t1, 0xAA));
   }
+}
+
+TARGET_AVX2
+static void polyvec_basemul_acc_cached_avx2(poly *r,
+                                            const polyvec *a,
+                                            const polyvec *b,
+                                            const polyvec_mulcache *bc)
+{
+  unsigned int j;
+
+  for(j=0;j<KYBER_N;j+=16)
+    _mm256_storeu_si256((__m256i *)&r->coeffs[j], basemul_acc16_avx2(a, b, bc, j));
+}
 
-  poly_reduce(r);
+/*************************************************
+* Name:        polyvec_matvec_add_tobytes_avx2
+*
+* Description: AVX2 version of polyvec_matvec_add_tobytes; the tobytes
+*              step is poly_tobytes_avx2 of poly.c
+**************************************************/
+TARGET_AVX2
+static void polyvec_matvec_add_tobytes_avx2(uint8_t r[KYBER_POLYVECBYTES],
+                                            const polyvec a[KYBER_K],
+                                            const polyvec *b,
+                                            const polyvec_mulcache *bc,
+                                            const polyvec *e)
+{
+  const int16_t f = (1ULL << 32) % KYBER_Q;
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  const __m256i vf = _mm256_set1_epi16(f);
+  const __m256i vfqinv = _mm256_set1_epi16((int16_t)(f*QINV));
+  const __m256i shift = _mm256_set1_epi32((4096 << 16) + 1);
+  const __m256i shufbidx = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+                                            0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+  unsigned int i, j;
+  uint8_t *p;
+  __m256i t;
+
+  for(i=0;i<KYBER_K;i++) {
+    for(j=0;j<KYBER_N;j+=16) {
+      t = basemul_acc16_avx2(&a[i], b, bc, j);
+      /* tomont: fqmul(t, f), below q in absolute value */
+      t = _mm256_sub_epi16(_mm256_mulhi_epi16(t, vf),
+                           _mm256_mulhi_epi16(_mm256_mullo_epi16(t, vfqinv), q));
+      t = _mm256_add_epi16(t, _mm256_loadu_si256((const __m256i *)&e->vec[i].coeffs[j]));
+      t = barrett_avx2(t);
+      t = _mm256_add_epi16(t, _mm256_and_si256(_mm256_srai_epi16(t, 15), q));
+      t = _mm256_shuffle_epi8(_mm256_madd_epi16(t, shift), shufbidx);
+      p = &r[i*KYBER_POLYBYTES + 3*j/2];
+      storeu_lanes(p, t, 12);
+    }
+  }
+}
+#endif
+
+/*************************************************
+* Name:        polyvec_basemul_acc_montgomery_cached
+*
+* Description: Multiply elements of a and b in NTT domain, accumulate into r,
+*              and multiply by 2^-16, with the zeta products of b taken
+*              from bc. The sums over all K elements are accumulated in
+*              int32 and reduced once per coefficient. Requires |a| < 2^12
+*              (any unpacked polynomial) and |b| <= q/2 (as after
+*              poly_reduce); the sums then stay below q*2^15 and the
+*              output is below q in absolute value.
+*
+* Arguments: - poly *r: pointer to output polynomial
+*            - const polyvec *a: pointer to first input vector of polynomials
+*            - const polyvec *b: pointer to second input vector of polynomials
+*            - const polyvec_mulcache *bc: pointer to cache of b
+**************************************************/
+void polyvec_basemul_acc_montgomery_cached(poly *r,
+                                           const polyvec *a,
+                                           const polyvec *b,
+                                           const polyvec_mulcache *bc)
+{
+  unsigned int i, j;
+  int32_t t0, t1;
+  const int16_t *x, *y;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    polyvec_basemul_acc_cached_avx2(r, a, b, bc);
+    return;
+  }
+#endif
+
+  for(j=0;j<KYBER_N/2;j++) {
+    t0 = t1 = 0;
+    for(i=0;i<KYBER_K;i++) {
+      x = &a->vec[i].coeffs[2*j];
+      y = &b->vec[i].coeffs[2*j];
+      t0 += (int32_t)x[0]*y[0] + (int32_t)x[1]*bc->vec[i].coeffs[j];
+      t1 += (int32_t)x[0]*y[1] + (int32_t)x[1]*y[0];
+    }
+    r->coeffs[2*j] = montgomery_reduce(t0);
+    r->coeffs[2*j+1] = montgomery_reduce(t1);
+  }
+}
+
+/*************************************************
+* Name:        polyvec_basemul_acc_packed
+*
+* Description: polyvec_basemul_acc_montgomery_cached with a given as its
+*              serialization (polyvec_tobytes, e.g. the vector of a
+*              public or secret key): the 12-bit coefficients are
+*              unpacked as they are multiplied, so a is never expanded
+*              into a polyvec and keys held in RAM can stay packed
+*              (384 instead of 512 bytes per polynomial). Same output
+*              as polyvec_frombytes followed by
+*              polyvec_basemul_acc_montgomery_cached.
+*
+* Arguments: - poly *r: pointer to output polynomial
+*            - const uint8_t *a: pointer to first input vector, serialized
+*                                (of length KYBER_POLYVECBYTES)
+*            - const polyvec *b: pointer to second input vector of polynomials
+*            - const polyvec_mulcache *bc: pointer to cache of b
+**************************************************/
+void polyvec_basemul_acc_packed(poly *r,
+                                const uint8_t a[KYBER_POLYVECBYTES],
+                                const polyvec *b,
+                                const polyvec_mulcache *bc)
+{
+  unsigned int i, j;
+  int32_t t0, t1;
+  int16_t x0, x1;
+  const uint8_t *x;
+  const int16_t *y;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    polyvec_basemul_acc_packed_avx2(r, a, b, bc);
+    return;
+  }
+#endif
+
+  for(j=0;j<KYBER_N/2;j++) {
+    t0 = t1 = 0;
+    for(i=0;i<KYBER_K;i++) {
+      x = &a[i*KYBER_POLYBYTES + 3*j];
+      x0 = ((x[0] >> 0) | ((uint16_t)x[1] << 8)) & 0xFFF;
+      x1 = ((x[1] >> 4) | ((uint16_t)x[2] << 4)) & 0xFFF;
+      y = &b->vec[i].coeffs[2*j];
+      t0 += (int32_t)x0*y[0] + (int32_t)x1*bc->vec[i].coeffs[j];
+      t1 += (int32_t)x0*y[1] + (int32_t)x1*y[0];
+    }
+    r->coeffs[2*j] = montgomery_reduce(t0);
+    r->coeffs[2*j+1] = montgomery_reduce(t1);
+  }
+}
+
+/*************************************************
+* Name:        polyvec_matvec
+*
+* Description: Matrix-vector product in NTT domain, r[i] = a[i]^T b for
+*              each row i, multiplied by 2^-16; bc is the cache of b,
+*              computed once by the caller (see
+*              polyvec_basemul_acc_montgomery_cached for the bounds)
+*
+* Arguments: - polyvec *r: pointer to output vector of polynomials
+*            - const polyvec a[KYBER_K]: rows of the input matrix
+*            - const polyvec *b: pointer to input vector of polynomials
+*            - const polyvec_mulcache *bc: pointer to cache of b
+**************************************************/
+void polyvec_matvec(polyvec *r,
+                    const polyvec a[KYBER_K],
+                    const polyvec *b,
+                    const polyvec_mulcache *bc)
+{
+  unsigned int i;
+  for(i=0;i<KYBER_K;i++)
+    polyvec_basemul_acc_montgomery_cached(&r->vec[i], &a[i], b, bc);
+}
+
+/*************************************************
+* Name:        polyvec_matvec_add_tobytes
+*
+* Description: Fused polyvec_matvec, poly_tomont of each row, polyvec_add
+*              of e, polyvec_reduce and polyvec_tobytes: each pair of
+*              output coefficients goes from the int32 sums straight to
+*              its 3 bytes, so the product vector is never stored. Same
+*              output as the separate calls (bounds as for polyvec_matvec).
+*
+* Arguments: - uint8_t *r: pointer to output byte array
+*                          (needs space for KYBER_POLYVECBYTES)
+*            - const polyvec a[KYBER_K]: rows of the input matrix
+*            - const polyvec *b: pointer to input vector of polynomials
+*            - const polyvec_mulcache *bc: pointer to cache of b
+*            - const polyvec *e: pointer to vector added after the product
+*                                (coefficients in {-(q-1)/2,...,(q-1)/2})
+**************************************************/
+void polyvec_matvec_add_tobytes(uint8_t r[KYBER_POLYVECBYTES],
+                                const polyvec a[KYBER_K],
+                                const polyvec *b,
+                                const polyvec_mulcache *bc,
+                                const polyvec *e)
+{
+  unsigned int i, j, k;
+  int32_t t0, t1;
+  int16_t u[2];
+  const int16_t f = (1ULL << 32) % KYBER_Q;
+  const int16_t *x, *y;
+
+#if KYBER_X86_64
+  if(cpu_has_avx2()) {
+    polyvec_matvec_add_tobytes_avx2(r, a, b, bc, e);
+    return;
+  }
+#endif
+
+  for(i=0;i<KYBER_K;i++) {
+    for(j=0;j<KYBER_N/2;j++) {
+      t0 = t1 = 0;
+      for(k=0;k<KYBER_K;k++) {
+        x = &a[i].vec[k].coeffs[2*j];
+        y = &b->vec[k].coeffs[2*j];
+        t0 += (int32_t)x[0]*y[0] + (int32_t)x[1]*bc->vec[k].coeffs[j];
+        t1 += (int32_t)x[0]*y[1] + (int32_t)x[1]*y[0];
+      }
+      u[0] = montgomery_reduce((int32_t)montgomery_reduce(t0)*f);
+      u[1] = montgomery_reduce((int32_t)montgomery_reduce(t1)*f);
+      for(k=0;k<2;k++) {
+        u[k] = barrett_reduce(u[k] + e->vec[i].coeffs[2*j+k]);
+        // map to positive standard representatives
+        u[k] += (u[k] >> 15) & KYBER_Q;
+      }
+      r[i*KYBER_POLYBYTES + 3*j+0] = (u[0] >> 0);
+      r[i*KYBER_POLYBYTES + 3*j+1] = (u[0] >> 8) | (u[1] << 4);
+      r[i*KYBER_POLYBYTES + 3*j+2] = (u[1] >> 4);
+    }
+  }
 }
 
 /*************************************************
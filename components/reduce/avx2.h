@@ -0,0 +1,51 @@
+#ifndef AVX2_H
+#define AVX2_H
+
+/*
+ * AVX2 helpers shared by ntt.c, poly.c and polyvec.c. Internal to those
+ * files: everything is static inline with a per-function target
+ * attribute, and only defined when the x86-64 backend is compiled.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "params.h"
+#include "cpufeatures.h"
+
+#if KYBER_X86_64
+#include <immintrin.h>
+
+/* Same result as barrett_reduce: ((v*a >> 16) + 2^9) >> 10 is the
+ * rounded v*a/2^26 */
+TARGET_AVX2
+static inline __m256i barrett_avx2(__m256i a)
+{
+  __m256i t;
+
+  t = _mm256_mulhi_epi16(a, _mm256_set1_epi16(20159));
+  t = _mm256_add_epi16(t, _mm256_set1_epi16(1 << 9));
+  t = _mm256_srai_epi16(t, 10);
+  t = _mm256_mullo_epi16(t, _mm256_set1_epi16(KYBER_Q));
+  return _mm256_sub_epi16(a, t);
+}
+
+/* Loads r[0..7] and r[64..71] into the low and high lane */
+TARGET_AVX2
+static inline __m256i loadu_strip(const int16_t *r)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)r)),
+                                 _mm_loadu_si128((const __m128i *)(r + 64)), 1);
+}
+
+/* Stores the first n bytes of each 128-bit lane of v to r and r+n */
+TARGET_AVX2
+static inline void storeu_lanes(uint8_t *r, __m256i v, unsigned int n)
+{
+  uint8_t buf[32];
+
+  _mm256_storeu_si256((__m256i *)buf, v);
+  memcpy(r, buf, n);
+  memcpy(r + n, buf + 16, n);
+}
+#endif
+
+#endif
@@ -22,6 +22,27 @@ int16_t montgomery_reduce(int32_t a)
   return t;
 }
 
+/*************************************************
+* Name:        plantard_reduce
+*
+* Description: Plantard reduction; given a 32-bit integer a = x*y*q^-1
+*              mod 2^32, computes 16-bit integer congruent to
+*              x*y * (-2^-32) mod q. With y a constant, y*q^-1 mod 2^32
+*              is precomputed and the product is one 32-bit multiply,
+*              so a multiplication by a constant takes two multiplies
+*              instead of the three of fqmul (Huang et al., TCHES 2022)
+*
+* Arguments:   - int32_t a: input integer to be reduced;
+*                           x*y has to be in {-q2^18,...,q2^18-1}
+*
+* Returns:     integer in {-(q+1)/2,...,(q+1)/2} congruent to
+*              x*y * (-2^-32) modulo q.
+**************************************************/
+int16_t plantard_reduce(int32_t a)
+{
+  return (((a >> 16) + 8) * KYBER_Q) >> 16;
+}
+
 /*************************************************
 * Name:        barrett_reduce
 *
@@ -6,10 +6,14 @@
 
 #define MONT -1044 // 2^16 mod q
 #define QINV -3327 // q^-1 mod 2^16
+#define PLANTARD_QINV 1806234369 // q^-1 mod 2^32
 
 #define montgomery_reduce KYBER_NAMESPACE(montgomery_reduce)
 int16_t montgomery_reduce(int32_t a);
 
+#define plantard_reduce KYBER_NAMESPACE(plantard_reduce)
+int16_t plantard_reduce(int32_t a);
+
 #define barrett_reduce KYBER_NAMESPACE(barrett_reduce)
 int16_t barrett_reduce(int16_t a);
 
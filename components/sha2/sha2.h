@@ -6,8 +6,44 @@
 
 #define SHA2_NAMESPACE(s) pqcrystals_sha2_ref_##s
 
+/* Incremental hashing: init, any number of updates, final */
+typedef struct {
+  uint32_t s[8];
+  uint8_t buf[64];
+  uint64_t bytes;
+} sha256ctx;
+
+typedef struct {
+  uint64_t s[8];
+  uint8_t buf[128];
+  uint64_t bytes;
+} sha512ctx;
+
+/* One fragment of a message hashed with sha256_v/sha512_v */
+typedef struct {
+  const uint8_t *in;
+  size_t inlen;
+} sha2_iovec;
+
+#define sha256_init SHA2_NAMESPACE(sha256_init)
+void sha256_init(sha256ctx *ctx);
+#define sha256_update SHA2_NAMESPACE(sha256_update)
+void sha256_update(sha256ctx *ctx, const uint8_t *in, size_t inlen);
+#define sha256_final SHA2_NAMESPACE(sha256_final)
+void sha256_final(uint8_t out[32], sha256ctx *ctx);
+#define sha256_v SHA2_NAMESPACE(sha256_v)
+void sha256_v(uint8_t out[32], const sha2_iovec *iov, size_t iovcnt);
 #define sha256 SHA2_NAMESPACE(sha256)
 void sha256(uint8_t out[32], const uint8_t *in, size_t inlen);
+
+#define sha512_init SHA2_NAMESPACE(sha512_init)
+void sha512_init(sha512ctx *ctx);
+#define sha512_update SHA2_NAMESPACE(sha512_update)
+void sha512_update(sha512ctx *ctx, const uint8_t *in, size_t inlen);
+#define sha512_final SHA2_NAMESPACE(sha512_final)
+void sha512_final(uint8_t out[64], sha512ctx *ctx);
+#define sha512_v SHA2_NAMESPACE(sha512_v)
+void sha512_v(uint8_t out[64], const sha2_iovec *iov, size_t iovcnt);
 #define sha512 SHA2_NAMESPACE(sha512)
 void sha512(uint8_t out[64], const uint8_t *in, size_t inlen);
 
@@ -3,6 +3,10 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "sha2.h"
+#include "cpufeatures.h"
+#if KYBER_X86_64
+#include <immintrin.h>
+#endif
 
 static uint32_t load_bigendian(const uint8_t *x)
 {
@@ -64,9 +68,8 @@ static void store_bigendian(uint8_t *x,uint32_t u)
   b = a; \
   a = T1 + T2;
 
-static int crypto_hashblocks_sha256(uint8_t *statebytes,const uint8_t *in,size_t inlen)
+static size_t crypto_hashblocks_sha256(uint32_t state[8],const uint8_t *in,size_t inlen)
 {
-  uint32_t state[8];
   uint32_t a;
   uint32_t b;
   uint32_t c;
@@ -78,14 +81,14 @@ static int crypto_hashblocks_sha256(uint8_t *statebytes,const uint8_t *in,size_t
   uint32_t T1;
   uint32_t T2;
 
-  a = load_bigendian(statebytes +  0); state[0] = a;
-  b = load_bigendian(statebytes +  4); state[1] = b;
-  c = load_bigendian(statebytes +  8); state[2] = c;
-  d = load_bigendian(statebytes + 12); state[3] = d;
-  e = load_bigendian(statebytes + 16); state[4] = e;
-  f = load_bigendian(statebytes + 20); state[5] = f;
-  g = load_bigendian(statebytes + 24); state[6] = g;
-  h = load_bigendian(statebytes + 28); state[7] = h;
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
 
   while (inlen >= 64) {
     uint32_t w0  = load_bigendian(in +  0);
@@ -201,71 +204,189 @@ static int crypto_hashblocks_sha256(uint8_t *statebytes,const uint8_t *in,size_t
     inlen -= 64;
   }
 
-  store_bigendian(statebytes +  0,state[0]);
-  store_bigendian(statebytes +  4,state[1]);
-  store_bigendian(statebytes +  8,state[2]);
-  store_bigendian(statebytes + 12,state[3]);
-  store_bigendian(statebytes + 16,state[4]);
-  store_bigendian(statebytes + 20,state[5]);
-  store_bigendian(statebytes + 24,state[6]);
-  store_bigendian(statebytes + 28,state[7]);
+  return inlen;
+}
+
+#if KYBER_X86_64
+static const uint32_t K256[64] = {
+  0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+  0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+  0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+  0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+  0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+  0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+  0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+  0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
+};
+
+/*************************************************
+* Name:        crypto_hashblocks_sha256_shani
+*
+* Description: crypto_hashblocks_sha256 on the x86 SHA extensions.
+*              sha256rnds2 keeps the state as the halves ABEF and CDGH
+*              and does two rounds per instruction; sha256msg1/msg2
+*              extend the message schedule four words at a time.
+**************************************************/
+TARGET_SHANI
+static size_t crypto_hashblocks_sha256_shani(uint32_t state[8],const uint8_t *in,size_t inlen)
+{
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,0x0405060700010203ULL);
+  __m128i abef, cdgh, abef_save, cdgh_save, t, msg;
+  __m128i w[4];
+  unsigned int i;
+
+  t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]),0xb1);    /* CDAB */
+  cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]),0x1b); /* EFGH */
+  abef = _mm_alignr_epi8(t,cdgh,8);
+  cdgh = _mm_blend_epi16(cdgh,t,0xf0);
+
+  while (inlen >= 64) {
+    abef_save = abef;
+    cdgh_save = cdgh;
+
+    for (i = 0;i < 4;++i)
+      w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + 16*i)),bswap);
+
+    for (i = 0;i < 16;++i) {
+      msg = _mm_add_epi32(w[i & 3],_mm_loadu_si128((const __m128i *)&K256[4*i]));
+      cdgh = _mm_sha256rnds2_epu32(cdgh,abef,msg);
+      abef = _mm_sha256rnds2_epu32(abef,cdgh,_mm_shuffle_epi32(msg,0x0e));
+      if (i < 12) {
+        /* words 4i+16..4i+19 replace 4i..4i+3 */
+        t = _mm_sha256msg1_epu32(w[i & 3],w[(i + 1) & 3]);
+        t = _mm_add_epi32(t,_mm_alignr_epi8(w[(i + 3) & 3],w[(i + 2) & 3],4));
+        w[i & 3] = _mm_sha256msg2_epu32(t,w[(i + 3) & 3]);
+      }
+    }
+
+    abef = _mm_add_epi32(abef,abef_save);
+    cdgh = _mm_add_epi32(cdgh,cdgh_save);
+
+    in += 64;
+    inlen -= 64;
+  }
+
+  t = _mm_shuffle_epi32(abef,0x1b);    /* FEBA */
+  cdgh = _mm_shuffle_epi32(cdgh,0xb1); /* DCHG */
+  _mm_storeu_si128((__m128i *)&state[0],_mm_blend_epi16(t,cdgh,0xf0));
+  _mm_storeu_si128((__m128i *)&state[4],_mm_alignr_epi8(cdgh,t,8));
 
   return inlen;
 }
+#endif
 
-#define blocks crypto_hashblocks_sha256
-
-static const uint8_t iv[32] = {
-  0x6a,0x09,0xe6,0x67,
-  0xbb,0x67,0xae,0x85,
-  0x3c,0x6e,0xf3,0x72,
-  0xa5,0x4f,0xf5,0x3a,
-  0x51,0x0e,0x52,0x7f,
-  0x9b,0x05,0x68,0x8c,
-  0x1f,0x83,0xd9,0xab,
-  0x5b,0xe0,0xcd,0x19,
+static size_t blocks(uint32_t state[8],const uint8_t *in,size_t inlen)
+{
+#if KYBER_X86_64
+  if (cpu_has_shani()) return crypto_hashblocks_sha256_shani(state,in,inlen);
+#endif
+  return crypto_hashblocks_sha256(state,in,inlen);
+}
+
+static const uint32_t iv[8] = {
+  0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,
+  0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19
 } ;
 
-void sha256(uint8_t out[32],const uint8_t *in,size_t inlen)
+/*************************************************
+* Name:        sha256_init
+*
+* Description: Starts an incremental SHA-256 computation
+*
+* Arguments:   - sha256ctx *ctx: pointer to (uninitialized) context
+**************************************************/
+void sha256_init(sha256ctx *ctx)
 {
-  uint8_t h[32];
-  uint8_t padded[128];
   unsigned int i;
-  uint64_t bits = inlen << 3;
 
-  for (i = 0;i < 32;++i) h[i] = iv[i];
+  for (i = 0;i < 8;++i) ctx->s[i] = iv[i];
+  ctx->bytes = 0;
+}
+
+/*************************************************
+* Name:        sha256_update
+*
+* Description: Hashes the next inlen bytes of the message. Whole
+*              64-byte blocks are compressed straight from in; only a
+*              partial block is kept in ctx->buf.
+*
+* Arguments:   - sha256ctx *ctx: pointer to context
+*              - const uint8_t *in: pointer to input
+*              - size_t inlen: length of input in bytes
+**************************************************/
+void sha256_update(sha256ctx *ctx,const uint8_t *in,size_t inlen)
+{
+  unsigned int pos = ctx->bytes & 63;
+  unsigned int i;
+
+  ctx->bytes += inlen;
+  if (pos) {
+    for (;pos < 64 && inlen > 0;++pos,--inlen) ctx->buf[pos] = *in++;
+    if (pos < 64) return;
+    blocks(ctx->s,ctx->buf,64);
+  }
 
-  blocks(h,in,inlen);
+  blocks(ctx->s,in,inlen);
   in += inlen;
   inlen &= 63;
   in -= inlen;
 
-  for (i = 0;i < inlen;++i) padded[i] = in[i];
-  padded[inlen] = 0x80;
-
-  if (inlen < 56) {
-    for (i = inlen + 1;i < 56;++i) padded[i] = 0;
-    padded[56] = bits >> 56;
-    padded[57] = bits >> 48;
-    padded[58] = bits >> 40;
-    padded[59] = bits >> 32;
-    padded[60] = bits >> 24;
-    padded[61] = bits >> 16;
-    padded[62] = bits >> 8;
-    padded[63] = bits;
-    blocks(h,padded,64);
-  } else {
-    for (i = inlen + 1;i < 120;++i) padded[i] = 0;
-    padded[120] = bits >> 56;
-    padded[121] = bits >> 48;
-    padded[122] = bits >> 40;
-    padded[123] = bits >> 32;
-    padded[124] = bits >> 24;
-    padded[125] = bits >> 16;
-    padded[126] = bits >> 8;
-    padded[127] = bits;
-    blocks(h,padded,128);
+  for (i = 0;i < inlen;++i) ctx->buf[i] = in[i];
+}
+
+/*************************************************
+* Name:        sha256_final
+*
+* Description: Pads the message and writes the digest
+*
+* Arguments:   - uint8_t *out: pointer to output (32 bytes)
+*              - sha256ctx *ctx: pointer to context, unusable afterwards
+**************************************************/
+void sha256_final(uint8_t out[32],sha256ctx *ctx)
+{
+  unsigned int pos = ctx->bytes & 63;
+  unsigned int i;
+  uint64_t bits = ctx->bytes << 3;
+
+  ctx->buf[pos++] = 0x80;
+  if (pos > 56) {
+    for (;pos < 64;++pos) ctx->buf[pos] = 0;
+    blocks(ctx->s,ctx->buf,64);
+    pos = 0;
   }
+  for (;pos < 56;++pos) ctx->buf[pos] = 0;
+  store_bigendian(ctx->buf + 56,bits >> 32);
+  store_bigendian(ctx->buf + 60,bits);
+  blocks(ctx->s,ctx->buf,64);
+
+  for (i = 0;i < 8;++i) store_bigendian(out + 4*i,ctx->s[i]);
+}
+
+/*************************************************
+* Name:        sha256_v
+*
+* Description: SHA-256 of the concatenation of iovcnt fragments,
+*              hashed in place
+*
+* Arguments:   - uint8_t *out: pointer to output (32 bytes)
+*              - const sha2_iovec *iov: fragments in message order
+*              - size_t iovcnt: number of fragments
+**************************************************/
+void sha256_v(uint8_t out[32],const sha2_iovec *iov,size_t iovcnt)
+{
+  sha256ctx ctx;
+  size_t i;
+
+  sha256_init(&ctx);
+  for (i = 0;i < iovcnt;++i) sha256_update(&ctx,iov[i].in,iov[i].inlen);
+  sha256_final(out,&ctx);
+}
+
+void sha256(uint8_t out[32],const uint8_t *in,size_t inlen)
+{
+  sha256ctx ctx;
 
-  for (i = 0;i < 32;++i) out[i] = h[i];
+  sha256_init(&ctx);
+  sha256_update(&ctx,in,inlen);
+  sha256_final(out,&ctx);
 }
@@ -0,0 +1,365 @@
+/* Multi-buffer SHA-256 and SHA-512. The AVX2 code runs the scalar
+ * compression function of sha256.c/sha512.c lane-wise on 8 (4) messages
+ * at once; the messages must have equal length, so they also share the
+ * padding layout. Hosts with the SHA extensions hash SHA-256 messages one
+ * at a time instead, which is faster than 8 AVX2 lanes; hosts without
+ * AVX2 (and all non-x86 targets) always do. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cpufeatures.h"
+#include "sha2.h"
+#include "sha2xn.h"
+
+#if KYBER_X86_64
+#include <immintrin.h>
+
+/* Partial groups of at least this many messages still take an AVX2 pass
+ * (the unused lanes rehash the first message); smaller ones are hashed
+ * one at a time */
+#define SHA256X8_MINLANES 3
+#define SHA512X4_MINLANES 3
+
+static uint32_t load_bigendian_32(const uint8_t *x)
+{
+  return
+      (uint32_t) (x[3]) \
+  | (((uint32_t) (x[2])) << 8) \
+  | (((uint32_t) (x[1])) << 16) \
+  | (((uint32_t) (x[0])) << 24)
+  ;
+}
+
+static uint64_t load_bigendian_64(const uint8_t *x)
+{
+  return ((uint64_t)load_bigendian_32(x) << 32) | load_bigendian_32(x + 4);
+}
+
+static void store_bigendian_32(uint8_t *x,uint32_t u)
+{
+  x[3] = u; u >>= 8;
+  x[2] = u; u >>= 8;
+  x[1] = u; u >>= 8;
+  x[0] = u;
+}
+
+static void store_bigendian_64(uint8_t *x,uint64_t u)
+{
+  store_bigendian_32(x,u >> 32);
+  store_bigendian_32(x + 4,u);
+}
+
+/*
+ * Copy the last inlen % blocksize bytes of in and append the padding;
+ * returns the number of padding blocks (1 or 2). Only the low 64 bits of
+ * the SHA-512 length field can be nonzero.
+ */
+static unsigned int pad_tail(uint8_t pad[256],const uint8_t *in,size_t inlen,unsigned int blocksize)
+{
+  unsigned int rem = inlen % blocksize;
+  unsigned int padlen = rem < blocksize - blocksize/8 ? blocksize : 2*blocksize;
+  unsigned int i;
+
+  in += inlen - rem;
+  for (i = 0;i < rem;++i) pad[i] = in[i];
+  pad[rem] = 0x80;
+  for (i = rem + 1;i < padlen - 8;++i) pad[i] = 0;
+  store_bigendian_64(pad + padlen - 8,(uint64_t)inlen << 3);
+  return padlen / blocksize;
+}
+
+/* SHA-256, 8 lanes of 32 bits */
+static const uint32_t K256[64] = {
+  0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+  0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+  0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+  0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+  0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+  0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+  0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+  0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
+};
+
+static const uint32_t iv256[8] = {
+  0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,
+  0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19
+};
+
+#define ADD32(x,y) _mm256_add_epi32(x,y)
+#define XOR(x,y) _mm256_xor_si256(x,y)
+#define AND(x,y) _mm256_and_si256(x,y)
+#define ANDNOT(x,y) _mm256_andnot_si256(x,y)
+#define ROTR32(x,c) _mm256_or_si256(_mm256_srli_epi32(x,c),_mm256_slli_epi32(x,32 - (c)))
+
+#define Ch(x,y,z) XOR(AND(x,y),ANDNOT(x,z))
+#define Maj(x,y,z) XOR(AND(x,y),AND(z,XOR(x,y)))
+#define Sigma0_256(x) XOR(XOR(ROTR32(x, 2),ROTR32(x,13)),ROTR32(x,22))
+#define Sigma1_256(x) XOR(XOR(ROTR32(x, 6),ROTR32(x,11)),ROTR32(x,25))
+#define sigma0_256(x) XOR(XOR(ROTR32(x, 7),ROTR32(x,18)),_mm256_srli_epi32(x, 3))
+#define sigma1_256(x) XOR(XOR(ROTR32(x,17),ROTR32(x,19)),_mm256_srli_epi32(x,10))
+
+#define R256(a,b,c,d,e,f,g,h,i,S) \
+  if (S) \
+    w[(i) & 15] = ADD32(ADD32(w[(i) & 15],sigma0_256(w[((i) + 1) & 15])), \
+                        ADD32(w[((i) + 9) & 15],sigma1_256(w[((i) + 14) & 15]))); \
+  T1 = ADD32(ADD32(h,_mm256_set1_epi32(K256[i])),ADD32(w[(i) & 15],Ch(e,f,g))); \
+  T1 = ADD32(T1,Sigma1_256(e)); \
+  d = ADD32(d,T1); \
+  h = ADD32(T1,ADD32(Sigma0_256(a),Maj(a,b,c)));
+
+/*************************************************
+* Name:        sha256x8_blocks
+*
+* Description: Compresses nblocks 64-byte blocks of each of 8 messages
+*              into the lane-wise state s; advances the input pointers
+*
+* Arguments:   - __m256i *s: state, word i of message j in lane j of s[i]
+*              - const uint8_t **in: the 8 input pointers
+*              - size_t nblocks: number of blocks per message
+**************************************************/
+TARGET_AVX2
+static void sha256x8_blocks(__m256i s[8],const uint8_t *in[8],size_t nblocks)
+{
+  __m256i a, b, c, d, e, f, g, h, T1;
+  __m256i w[16];
+  unsigned int i, j;
+
+  while (nblocks-- > 0) {
+    for (i = 0;i < 16;++i)
+      w[i] = _mm256_set_epi32(load_bigendian_32(in[7] + 4*i),load_bigendian_32(in[6] + 4*i),
+                              load_bigendian_32(in[5] + 4*i),load_bigendian_32(in[4] + 4*i),
+                              load_bigendian_32(in[3] + 4*i),load_bigendian_32(in[2] + 4*i),
+                              load_bigendian_32(in[1] + 4*i),load_bigendian_32(in[0] + 4*i));
+    for (j = 0;j < 8;++j) in[j] += 64;
+
+    a = s[0]; b = s[1]; c = s[2]; d = s[3];
+    e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+    for (i = 0;i < 64;i += 8) {
+      R256(a,b,c,d,e,f,g,h,i + 0,i >= 16)
+      R256(h,a,b,c,d,e,f,g,i + 1,i >= 16)
+      R256(g,h,a,b,c,d,e,f,i + 2,i >= 16)
+      R256(f,g,h,a,b,c,d,e,i + 3,i >= 16)
+      R256(e,f,g,h,a,b,c,d,i + 4,i >= 16)
+      R256(d,e,f,g,h,a,b,c,i + 5,i >= 16)
+      R256(c,d,e,f,g,h,a,b,i + 6,i >= 16)
+      R256(b,c,d,e,f,g,h,a,i + 7,i >= 16)
+    }
+
+    s[0] = ADD32(s[0],a); s[1] = ADD32(s[1],b);
+    s[2] = ADD32(s[2],c); s[3] = ADD32(s[3],d);
+    s[4] = ADD32(s[4],e); s[5] = ADD32(s[5],f);
+    s[6] = ADD32(s[6],g); s[7] = ADD32(s[7],h);
+  }
+}
+
+TARGET_AVX2
+static void sha256x8(uint8_t *out[8],const uint8_t *in[8],size_t inlen)
+{
+  __m256i s[8];
+  uint32_t t[8][8];
+  uint8_t pad[8][256];
+  const uint8_t *p[8];
+  unsigned int i, j, npad = 0;
+
+  for (i = 0;i < 8;++i) s[i] = _mm256_set1_epi32(iv256[i]);
+  for (j = 0;j < 8;++j) p[j] = in[j];
+  sha256x8_blocks(s,p,inlen / 64);
+
+  for (j = 0;j < 8;++j) {
+    npad = pad_tail(pad[j],in[j],inlen,64);
+    p[j] = pad[j];
+  }
+  sha256x8_blocks(s,p,npad);
+
+  for (i = 0;i < 8;++i) _mm256_storeu_si256((__m256i *)t[i],s[i]);
+  for (j = 0;j < 8;++j)
+    for (i = 0;i < 8;++i) store_bigendian_32(out[j] + 4*i,t[i][j]);
+}
+
+/* SHA-512, 4 lanes of 64 bits */
+static const uint64_t K512[80] = {
+  0x428a2f98d728ae22ULL,0x7137449123ef65cdULL,0xb5c0fbcfec4d3b2fULL,0xe9b5dba58189dbbcULL,
+  0x3956c25bf348b538ULL,0x59f111f1b605d019ULL,0x923f82a4af194f9bULL,0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL,0x12835b0145706fbeULL,0x243185be4ee4b28cULL,0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL,0x80deb1fe3b1696b1ULL,0x9bdc06a725c71235ULL,0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL,0xefbe4786384f25e3ULL,0x0fc19dc68b8cd5b5ULL,0x240ca1cc77ac9c65ULL,
+  0x2de92c6f592b0275ULL,0x4a7484aa6ea6e483ULL,0x5cb0a9dcbd41fbd4ULL,0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL,0xa831c66d2db43210ULL,0xb00327c898fb213fULL,0xbf597fc7beef0ee4ULL,
+  0xc6e00bf33da88fc2ULL,0xd5a79147930aa725ULL,0x06ca6351e003826fULL,0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL,0x2e1b21385c26c926ULL,0x4d2c6dfc5ac42aedULL,0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL,0x766a0abb3c77b2a8ULL,0x81c2c92e47edaee6ULL,0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL,0xa81a664bbc423001ULL,0xc24b8b70d0f89791ULL,0xc76c51a30654be30ULL,
+  0xd192e819d6ef5218ULL,0xd69906245565a910ULL,0xf40e35855771202aULL,0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL,0x1e376c085141ab53ULL,0x2748774cdf8eeb99ULL,0x34b0bcb5e19b48a8ULL,
+  0x391c0cb3c5c95a63ULL,0x4ed8aa4ae3418acbULL,0x5b9cca4f7763e373ULL,0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL,0x78a5636f43172f60ULL,0x84c87814a1f0ab72ULL,0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL,0xa4506cebde82bde9ULL,0xbef9a3f7b2c67915ULL,0xc67178f2e372532bULL,
+  0xca273eceea26619cULL,0xd186b8c721c0c207ULL,0xeada7dd6cde0eb1eULL,0xf57d4f7fee6ed178ULL,
+  0x06f067aa72176fbaULL,0x0a637dc5a2c898a6ULL,0x113f9804bef90daeULL,0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL,0x32caab7b40c72493ULL,0x3c9ebe0a15c9bebcULL,0x431d67c49c100d4cULL,
+  0x4cc5d4becb3e42b6ULL,0x597f299cfc657e2aULL,0x5fcb6fab3ad6faecULL,0x6c44198c4a475817ULL
+};
+
+static const uint64_t iv512[8] = {
+  0x6a09e667f3bcc908ULL,0xbb67ae8584caa73bULL,
+  0x3c6ef372fe94f82bULL,0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL,0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL,0x5be0cd19137e2179ULL
+};
+
+#define ADD64(x,y) _mm256_add_epi64(x,y)
+#define ROTR64(x,c) _mm256_or_si256(_mm256_srli_epi64(x,c),_mm256_slli_epi64(x,64 - (c)))
+
+#define Sigma0_512(x) XOR(XOR(ROTR64(x,28),ROTR64(x,34)),ROTR64(x,39))
+#define Sigma1_512(x) XOR(XOR(ROTR64(x,14),ROTR64(x,18)),ROTR64(x,41))
+#define sigma0_512(x) XOR(XOR(ROTR64(x, 1),ROTR64(x, 8)),_mm256_srli_epi64(x,7))
+#define sigma1_512(x) XOR(XOR(ROTR64(x,19),ROTR64(x,61)),_mm256_srli_epi64(x,6))
+
+#define R512(a,b,c,d,e,f,g,h,i,S) \
+  if (S) \
+    w[(i) & 15] = ADD64(ADD64(w[(i) & 15],sigma0_512(w[((i) + 1) & 15])), \
+                        ADD64(w[((i) + 9) & 15],sigma1_512(w[((i) + 14) & 15]))); \
+  T1 = ADD64(ADD64(h,_mm256_set1_epi64x(K512[i])),ADD64(w[(i) & 15],Ch(e,f,g))); \
+  T1 = ADD64(T1,Sigma1_512(e)); \
+  d = ADD64(d,T1); \
+  h = ADD64(T1,ADD64(Sigma0_512(a),Maj(a,b,c)));
+
+/*************************************************
+* Name:        sha512x4_blocks
+*
+* Description: Compresses nblocks 128-byte blocks of each of 4 messages
+*              into the lane-wise state s; advances the input pointers
+*
+* Arguments:   - __m256i *s: state, word i of message j in lane j of s[i]
+*              - const uint8_t **in: the 4 input pointers
+*              - size_t nblocks: number of blocks per message
+**************************************************/
+TARGET_AVX2
+static void sha512x4_blocks(__m256i s[8],const uint8_t *in[4],size_t nblocks)
+{
+  __m256i a, b, c, d, e, f, g, h, T1;
+  __m256i w[16];
+  unsigned int i, j;
+
+  while (nblocks-- > 0) {
+    for (i = 0;i < 16;++i)
+      w[i] = _mm256_set_epi64x(load_bigendian_64(in[3] + 8*i),load_bigendian_64(in[2] + 8*i),
+                               load_bigendian_64(in[1] + 8*i),load_bigendian_64(in[0] + 8*i));
+    for (j = 0;j < 4;++j) in[j] += 128;
+
+    a = s[0]; b = s[1]; c = s[2]; d = s[3];
+    e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+    for (i = 0;i < 80;i += 8) {
+      R512(a,b,c,d,e,f,g,h,i + 0,i >= 16)
+      R512(h,a,b,c,d,e,f,g,i + 1,i >= 16)
+      R512(g,h,a,b,c,d,e,f,i + 2,i >= 16)
+      R512(f,g,h,a,b,c,d,e,i + 3,i >= 16)
+      R512(e,f,g,h,a,b,c,d,i + 4,i >= 16)
+      R512(d,e,f,g,h,a,b,c,i + 5,i >= 16)
+      R512(c,d,e,f,g,h,a,b,i + 6,i >= 16)
+      R512(b,c,d,e,f,g,h,a,i + 7,i >= 16)
+    }
+
+    s[0] = ADD64(s[0],a); s[1] = ADD64(s[1],b);
+    s[2] = ADD64(s[2],c); s[3] = ADD64(s[3],d);
+    s[4] = ADD64(s[4],e); s[5] = ADD64(s[5],f);
+    s[6] = ADD64(s[6],g); s[7] = ADD64(s[7],h);
+  }
+}
+
+TARGET_AVX2
+static void sha512x4(uint8_t *out[4],const uint8_t *in[4],size_t inlen)
+{
+  __m256i s[8];
+  uint64_t t[8][4];
+  uint8_t pad[4][256];
+  const uint8_t *p[4];
+  unsigned int i, j, npad = 0;
+
+  for (i = 0;i < 8;++i) s[i] = _mm256_set1_epi64x(iv512[i]);
+  for (j = 0;j < 4;++j) p[j] = in[j];
+  sha512x4_blocks(s,p,inlen / 128);
+
+  for (j = 0;j < 4;++j) {
+    npad = pad_tail(pad[j],in[j],inlen,128);
+    p[j] = pad[j];
+  }
+  sha512x4_blocks(s,p,npad);
+
+  for (i = 0;i < 8;++i) _mm256_storeu_si256((__m256i *)t[i],s[i]);
+  for (j = 0;j < 4;++j)
+    for (i = 0;i < 8;++i) store_bigendian_64(out[j] + 8*i,t[i][j]);
+}
+#endif
+
+/*************************************************
+* Name:        sha256_xN
+*
+* Description: SHA-256 of n messages of inlen bytes each
+*
+* Arguments:   - uint8_t **out: n output pointers (32 bytes each)
+*              - const uint8_t **in: n input pointers
+*              - size_t inlen: length of each message in bytes
+*              - size_t n: number of messages
+**************************************************/
+void sha256_xN(uint8_t *out[],const uint8_t *in[],size_t inlen,size_t n)
+{
+  size_t i = 0;
+
+#if KYBER_X86_64
+  if (!cpu_has_shani() && cpu_has_avx2()) {
+    for (;i + SHA256_XN <= n;i += SHA256_XN) sha256x8(out + i,in + i,inlen);
+    if (n - i >= SHA256X8_MINLANES) {
+      uint8_t *o[SHA256_XN];
+      const uint8_t *p[SHA256_XN];
+      uint8_t scratch[32];
+      size_t j;
+
+      for (j = 0;j < SHA256_XN;++j) {
+        o[j] = i + j < n ? out[i + j] : scratch;
+        p[j] = i + j < n ? in[i + j] : in[i];
+      }
+      sha256x8(o,p,inlen);
+      return;
+    }
+  }
+#endif
+  for (;i < n;++i) sha256(out[i],in[i],inlen);
+}
+
+/*************************************************
+* Name:        sha512_xN
+*
+* Description: SHA-512 of n messages of inlen bytes each
+*
+* Arguments:   - uint8_t **out: n output pointers (64 bytes each)
+*              - const uint8_t **in: n input pointers
+*              - size_t inlen: length of each message in bytes
+*              - size_t n: number of messages
+**************************************************/
+void sha512_xN(uint8_t *out[],const uint8_t *in[],size_t inlen,size_t n)
+{
+  size_t i = 0;
+
+#if KYBER_X86_64
+  if (cpu_has_avx2()) {
+    for (;i + SHA512_XN <= n;i += SHA512_XN) sha512x4(out + i,in + i,inlen);
+    if (n - i >= SHA512X4_MINLANES) {
+      uint8_t *o[SHA512_XN];
+      const uint8_t *p[SHA512_XN];
+      uint8_t scratch[64];
+      size_t j;
+
+      for (j = 0;j < SHA512_XN;++j) {
+        o[j] = i + j < n ? out[i + j] : scratch;
+        p[j] = i + j < n ? in[i + j] : in[i];
+      }
+      sha512x4(o,p,inlen);
+      return;
+    }
+  }
+#endif
+  for (;i < n;++i) sha512(out[i],in[i],inlen);
+}
@@ -0,0 +1,22 @@
+#ifndef SHA2XN_H
+#define SHA2XN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha2.h"
+
+/*
+ * Multi-buffer SHA-2: n independent messages of the same length, e.g. a
+ * batch of public keys or ciphertexts. The AVX2 code hashes SHA256_XN
+ * (SHA512_XN) messages per pass, one per 32-bit (64-bit) vector lane.
+ * Output is identical to n calls of sha256 (sha512).
+ */
+#define SHA256_XN 8
+#define SHA512_XN 4
+
+#define sha256_xN SHA2_NAMESPACE(sha256_xN)
+void sha256_xN(uint8_t *out[], const uint8_t *in[], size_t inlen, size_t n);
+#define sha512_xN SHA2_NAMESPACE(sha512_xN)
+void sha512_xN(uint8_t *out[], const uint8_t *in[], size_t inlen, size_t n);
+
+#endif
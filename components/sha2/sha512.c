@@ -5,6 +5,10 @@ Adapted from public domain code by D. J. Bernstein.
 #include <stddef.h>
 #include <stdint.h>
 #include "sha2.h"
+#include "cpufeatures.h"
+#if KYBER_X86_64
+#include <immintrin.h>
+#endif
 
 static uint64_t load_bigendian(const uint8_t *x)
 {
@@ -74,9 +78,8 @@ static void store_bigendian(uint8_t *x,uint64_t u)
   b = a; \
   a = T1 + T2;
 
-static int crypto_hashblocks_sha512(uint8_t *statebytes,const uint8_t *in,size_t inlen)
+static size_t crypto_hashblocks_sha512(uint64_t state[8],const uint8_t *in,size_t inlen)
 {
-  uint64_t state[8];
   uint64_t a;
   uint64_t b;
   uint64_t c;
@@ -88,14 +91,14 @@ static int crypto_hashblocks_sha512(uint8_t *statebytes,const uint8_t *in,size_t
   uint64_t T1;
   uint64_t T2;
 
-  a = load_bigendian(statebytes +  0); state[0] = a;
-  b = load_bigendian(statebytes +  8); state[1] = b;
-  c = load_bigendian(statebytes + 16); state[2] = c;
-  d = load_bigendian(statebytes + 24); state[3] = d;
-  e = load_bigendian(statebytes + 32); state[4] = e;
-  f = load_bigendian(statebytes + 40); state[5] = f;
-  g = load_bigendian(statebytes + 48); state[6] = g;
-  h = load_bigendian(statebytes + 56); state[7] = h;
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
 
   while (inlen >= 128) {
     uint64_t w0  = load_bigendian(in +   0);
@@ -230,73 +233,246 @@ static int crypto_hashblocks_sha512(uint8_t *statebytes,const uint8_t *in,size_t
     inlen -= 128;
   }
 
-  store_bigendian(statebytes +  0,state[0]);
-  store_bigendian(statebytes +  8,state[1]);
-  store_bigendian(statebytes + 16,state[2]);
-  store_bigendian(statebytes + 24,state[3]);
-  store_bigendian(statebytes + 32,state[4]);
-  store_bigendian(statebytes + 40,state[5]);
-  store_bigendian(statebytes + 48,state[6]);
-  store_bigendian(statebytes + 56,state[7]);
+  return inlen;
+}
+
+#if KYBER_X86_64
+static const uint64_t K512[80] = {
+  0x428a2f98d728ae22ULL,0x7137449123ef65cdULL,0xb5c0fbcfec4d3b2fULL,0xe9b5dba58189dbbcULL,
+  0x3956c25bf348b538ULL,0x59f111f1b605d019ULL,0x923f82a4af194f9bULL,0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL,0x12835b0145706fbeULL,0x243185be4ee4b28cULL,0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL,0x80deb1fe3b1696b1ULL,0x9bdc06a725c71235ULL,0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL,0xefbe4786384f25e3ULL,0x0fc19dc68b8cd5b5ULL,0x240ca1cc77ac9c65ULL,
+  0x2de92c6f592b0275ULL,0x4a7484aa6ea6e483ULL,0x5cb0a9dcbd41fbd4ULL,0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL,0xa831c66d2db43210ULL,0xb00327c898fb213fULL,0xbf597fc7beef0ee4ULL,
+  0xc6e00bf33da88fc2ULL,0xd5a79147930aa725ULL,0x06ca6351e003826fULL,0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL,0x2e1b21385c26c926ULL,0x4d2c6dfc5ac42aedULL,0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL,0x766a0abb3c77b2a8ULL,0x81c2c92e47edaee6ULL,0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL,0xa81a664bbc423001ULL,0xc24b8b70d0f89791ULL,0xc76c51a30654be30ULL,
+  0xd192e819d6ef5218ULL,0xd69906245565a910ULL,0xf40e35855771202aULL,0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL,0x1e376c085141ab53ULL,0x2748774cdf8eeb99ULL,0x34b0bcb5e19b48a8ULL,
+  0x391c0cb3c5c95a63ULL,0x4ed8aa4ae3418acbULL,0x5b9cca4f7763e373ULL,0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL,0x78a5636f43172f60ULL,0x84c87814a1f0ab72ULL,0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL,0xa4506cebde82bde9ULL,0xbef9a3f7b2c67915ULL,0xc67178f2e372532bULL,
+  0xca273eceea26619cULL,0xd186b8c721c0c207ULL,0xeada7dd6cde0eb1eULL,0xf57d4f7fee6ed178ULL,
+  0x06f067aa72176fbaULL,0x0a637dc5a2c898a6ULL,0x113f9804bef90daeULL,0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL,0x32caab7b40c72493ULL,0x3c9ebe0a15c9bebcULL,0x431d67c49c100d4cULL,
+  0x4cc5d4becb3e42b6ULL,0x597f299cfc657e2aULL,0x5fcb6fab3ad6faecULL,0x6c44198c4a475817ULL
+};
+
+/* There is no 64-bit vector rotate before AVX-512 */
+#define ROTR4(x,c) _mm256_or_si256(_mm256_srli_epi64(x,c),_mm256_slli_epi64(x,64 - (c)))
+#define ROTR2(x,c) _mm_or_si128(_mm_srli_epi64(x,c),_mm_slli_epi64(x,64 - (c)))
+#define sigma0_4(x) _mm256_xor_si256(_mm256_xor_si256(ROTR4(x, 1),ROTR4(x, 8)),_mm256_srli_epi64(x,7))
+#define sigma1_2(x) _mm_xor_si128(_mm_xor_si128(ROTR2(x,19),ROTR2(x,61)),_mm_srli_epi64(x,6))
+
+/* w0..w3 hold W[t-16..t-1]; replace w0 by W[t..t+3] and store W + K.
+ * W[t+2], W[t+3] depend on W[t], W[t+1] through sigma1, so the sigma1
+ * term is added one 128-bit half at a time. */
+#define SCHEDULE4(w0,w1,w2,w3,t) \
+  s = _mm256_add_epi64(w0,sigma0_4(_mm256_alignr_epi8(_mm256_permute2x128_si256(w0,w1,0x21),w0,8))); \
+  s = _mm256_add_epi64(s,_mm256_alignr_epi8(_mm256_permute2x128_si256(w2,w3,0x21),w2,8)); \
+  lo = _mm_add_epi64(_mm256_castsi256_si128(s),sigma1_2(_mm256_extracti128_si256(w3,1))); \
+  hi = _mm_add_epi64(_mm256_extracti128_si256(s,1),sigma1_2(lo)); \
+  w0 = _mm256_inserti128_si256(_mm256_castsi128_si256(lo),hi,1); \
+  _mm256_storeu_si256((__m256i *)&wk[t],_mm256_add_epi64(w0,_mm256_loadu_si256((const __m256i *)&K512[t])));
+
+#define LOAD4(w,i) \
+  w = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + 8*(i))),bswap); \
+  _mm256_storeu_si256((__m256i *)&wk[i],_mm256_add_epi64(w,_mm256_loadu_si256((const __m256i *)&K512[i])));
+
+#define R(a,b,c,d,e,f,g,h,i) \
+  T1 = h + Sigma1(e) + Ch(e,f,g) + wk[i]; \
+  d += T1; \
+  h = T1 + Sigma0(a) + Maj(a,b,c);
+
+#define R4(a,b,c,d,e,f,g,h,i) \
+  R(a,b,c,d,e,f,g,h,(i) + 0) \
+  R(h,a,b,c,d,e,f,g,(i) + 1) \
+  R(g,h,a,b,c,d,e,f,(i) + 2) \
+  R(f,g,h,a,b,c,d,e,(i) + 3)
+
+/*************************************************
+* Name:        crypto_hashblocks_sha512_avx2
+*
+* Description: crypto_hashblocks_sha512 with the message schedule (and
+*              the round constants added to it) computed four words at
+*              a time in AVX2. Each group of four words is computed
+*              twelve rounds ahead of its use and interleaved with the
+*              scalar rounds, which are latency bound and leave the
+*              vector units idle; a separate schedule pass before the
+*              rounds is no faster than the portable code.
+**************************************************/
+TARGET_AVX2
+static size_t crypto_hashblocks_sha512_avx2(uint64_t state[8],const uint8_t *in,size_t inlen)
+{
+  const __m256i bswap = _mm256_set_epi64x(0x08090a0b0c0d0e0fULL,0x0001020304050607ULL,
+                                          0x08090a0b0c0d0e0fULL,0x0001020304050607ULL);
+  __m256i w0, w1, w2, w3, s;
+  __m128i lo, hi;
+  uint64_t wk[80];
+  uint64_t a = state[0];
+  uint64_t b = state[1];
+  uint64_t c = state[2];
+  uint64_t d = state[3];
+  uint64_t e = state[4];
+  uint64_t f = state[5];
+  uint64_t g = state[6];
+  uint64_t h = state[7];
+  uint64_t T1;
+  unsigned int i;
+
+  while (inlen >= 128) {
+    LOAD4(w0, 0)
+    LOAD4(w1, 4)
+    LOAD4(w2, 8)
+    LOAD4(w3,12)
+
+    for (i = 0;i < 64;i += 16) {
+      SCHEDULE4(w0,w1,w2,w3,i + 16)
+      R4(a,b,c,d,e,f,g,h,i)
+      SCHEDULE4(w1,w2,w3,w0,i + 20)
+      R4(e,f,g,h,a,b,c,d,i + 4)
+      SCHEDULE4(w2,w3,w0,w1,i + 24)
+      R4(a,b,c,d,e,f,g,h,i + 8)
+      SCHEDULE4(w3,w0,w1,w2,i + 28)
+      R4(e,f,g,h,a,b,c,d,i + 12)
+    }
+    R4(a,b,c,d,e,f,g,h,64)
+    R4(e,f,g,h,a,b,c,d,68)
+    R4(a,b,c,d,e,f,g,h,72)
+    R4(e,f,g,h,a,b,c,d,76)
+
+    a += state[0]; state[0] = a;
+    b += state[1]; state[1] = b;
+    c += state[2]; state[2] = c;
+    d += state[3]; state[3] = d;
+    e += state[4]; state[4] = e;
+    f += state[5]; state[5] = f;
+    g += state[6]; state[6] = g;
+    h += state[7]; state[7] = h;
+
+    in += 128;
+    inlen -= 128;
+  }
 
   return inlen;
 }
+#endif
 
-#define blocks crypto_hashblocks_sha512
-
-static const uint8_t iv[64] = {
-  0x6a,0x09,0xe6,0x67,0xf3,0xbc,0xc9,0x08,
-  0xbb,0x67,0xae,0x85,0x84,0xca,0xa7,0x3b,
-  0x3c,0x6e,0xf3,0x72,0xfe,0x94,0xf8,0x2b,
-  0xa5,0x4f,0xf5,0x3a,0x5f,0x1d,0x36,0xf1,
-  0x51,0x0e,0x52,0x7f,0xad,0xe6,0x82,0xd1,
-  0x9b,0x05,0x68,0x8c,0x2b,0x3e,0x6c,0x1f,
-  0x1f,0x83,0xd9,0xab,0xfb,0x41,0xbd,0x6b,
-  0x5b,0xe0,0xcd,0x19,0x13,0x7e,0x21,0x79
+static size_t blocks(uint64_t state[8],const uint8_t *in,size_t inlen)
+{
+#if KYBER_X86_64
+  if (cpu_has_avx2()) return crypto_hashblocks_sha512_avx2(state,in,inlen);
+#endif
+  return crypto_hashblocks_sha512(state,in,inlen);
+}
+
+static const uint64_t iv[8] = {
+  0x6a09e667f3bcc908ULL,0xbb67ae8584caa73bULL,
+  0x3c6ef372fe94f82bULL,0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL,0x9b05688c2b3e6c1fULL,
+  0x1f83d9abfb41bd6bULL,0x5be0cd19137e2179ULL
 } ;
 
-void sha512(uint8_t out[64],const uint8_t *in,size_t inlen)
+/*************************************************
+* Name:        sha512_init
+*
+* Description: Starts an incremental SHA-512 computation
+*
+* Arguments:   - sha512ctx *ctx: pointer to (uninitialized) context
+**************************************************/
+void sha512_init(sha512ctx *ctx)
+{
+  unsigned int i;
+
+  for (i = 0;i < 8;++i) ctx->s[i] = iv[i];
+  ctx->bytes = 0;
+}
+
+/*************************************************
+* Name:        sha512_update
+*
+* Description: Hashes the next inlen bytes of the message. Whole
+*              128-byte blocks are compressed straight from in; only a
+*              partial block is kept in ctx->buf.
+*
+* Arguments:   - sha512ctx *ctx: pointer to context
+*              - const uint8_t *in: pointer to input
+*              - size_t inlen: length of input in bytes
+**************************************************/
+void sha512_update(sha512ctx *ctx,const uint8_t *in,size_t inlen)
 {
-  uint8_t h[64];
-  uint8_t padded[256];
+  unsigned int pos = ctx->bytes & 127;
   unsigned int i;
-  uint64_t bytes = inlen;
 
-  for (i = 0;i < 64;++i) h[i] = iv[i];
+  ctx->bytes += inlen;
+  if (pos) {
+    for (;pos < 128 && inlen > 0;++pos,--inlen) ctx->buf[pos] = *in++;
+    if (pos < 128) return;
+    blocks(ctx->s,ctx->buf,128);
+  }
 
-  blocks(h,in,inlen);
+  blocks(ctx->s,in,inlen);
   in += inlen;
   inlen &= 127;
   in -= inlen;
 
-  for (i = 0;i < inlen;++i) padded[i] = in[i];
-  padded[inlen] = 0x80;
-
-  if (inlen < 112) {
-    for (i = inlen + 1;i < 119;++i) padded[i] = 0;
-    padded[119] = bytes >> 61;
-    padded[120] = bytes >> 53;
-    padded[121] = bytes >> 45;
-    padded[122] = bytes >> 37;
-    padded[123] = bytes >> 29;
-    padded[124] = bytes >> 21;
-    padded[125] = bytes >> 13;
-    padded[126] = bytes >> 5;
-    padded[127] = bytes << 3;
-    blocks(h,padded,128);
-  } else {
-    for (i = inlen + 1;i < 247;++i) padded[i] = 0;
-    padded[247] = bytes >> 61;
-    padded[248] = bytes >> 53;
-    padded[249] = bytes >> 45;
-    padded[250] = bytes >> 37;
-    padded[251] = bytes >> 29;
-    padded[252] = bytes >> 21;
-    padded[253] = bytes >> 13;
-    padded[254] = bytes >> 5;
-    padded[255] = bytes << 3;
-    blocks(h,padded,256);
+  for (i = 0;i < inlen;++i) ctx->buf[i] = in[i];
+}
+
+/*************************************************
+* Name:        sha512_final
+*
+* Description: Pads the message and writes the digest
+*
+* Arguments:   - uint8_t *out: pointer to output (64 bytes)
+*              - sha512ctx *ctx: pointer to context, unusable afterwards
+**************************************************/
+void sha512_final(uint8_t out[64],sha512ctx *ctx)
+{
+  unsigned int pos = ctx->bytes & 127;
+  unsigned int i;
+
+  ctx->buf[pos++] = 0x80;
+  if (pos > 112) {
+    for (;pos < 128;++pos) ctx->buf[pos] = 0;
+    blocks(ctx->s,ctx->buf,128);
+    pos = 0;
   }
+  for (;pos < 112;++pos) ctx->buf[pos] = 0;
+  store_bigendian(ctx->buf + 112,ctx->bytes >> 61);
+  store_bigendian(ctx->buf + 120,ctx->bytes << 3);
+  blocks(ctx->s,ctx->buf,128);
+
+  for (i = 0;i < 8;++i) store_bigendian(out + 8*i,ctx->s[i]);
+}
+
+/*************************************************
+* Name:        sha512_v
+*
+* Description: SHA-512 of the concatenation of iovcnt fragments,
+*              hashed in place
+*
+* Arguments:   - uint8_t *out: pointer to output (64 bytes)
+*              - const sha2_iovec *iov: fragments in message order
+*              - size_t iovcnt: number of fragments
+**************************************************/
+void sha512_v(uint8_t out[64],const sha2_iovec *iov,size_t iovcnt)
+{
+  sha512ctx ctx;
+  size_t i;
+
+  sha512_init(&ctx);
+  for (i = 0;i < iovcnt;++i) sha512_update(&ctx,iov[i].in,iov[i].inlen);
+  sha512_final(out,&ctx);
+}
+
+void sha512(uint8_t out[64],const uint8_t *in,size_t inlen)
+{
+  sha512ctx ctx;
 
-  for (i = 0;i < 64;++i) out[i] = h[i];
+  sha512_init(&ctx);
+  sha512_update(&ctx,in,inlen);
+  sha512_final(out,&ctx);
 }
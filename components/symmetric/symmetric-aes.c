@@ -1,34 +1,73 @@
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "params.h"
 #include "symmetric.h"
 #include "aes256ctr.h"
+#if (AES_XOF_VARTIME == 1)
+#include "aes256ctr_vt.h"
+#endif
 
 #if (AES_ACC == 1)
 #include "mbedtls/aes.h"
 #endif
 
-void kyber_aes256xof_absorb(aes256ctr_ctx *state, const uint8_t seed[32], uint8_t x, uint8_t y)
+#if (AES_XOF_VARTIME == 1)
+/* Public seed only: the XOF may use the variable-time AES */
+void kyber_aes256xof_setnonce(aes256ctr_vt_ctx *state, uint8_t x, uint8_t y)
 {
   uint8_t expnonce[12] = {0};
   expnonce[0] = x;
   expnonce[1] = y;
-  aes256ctr_init(state, seed, expnonce);
+  aes256ctr_vt_setnonce(state, expnonce);
 }
 
+void kyber_aes256xof_absorb(aes256ctr_vt_ctx *state, const uint8_t seed[32], uint8_t x, uint8_t y)
+{
+  aes256ctr_vt_setkey(state, seed);
+  kyber_aes256xof_setnonce(state, x, y);
+}
+#else
+void kyber_aes256xof_setnonce(aes256ctr_ctx *state, uint8_t x, uint8_t y)
+{
+  uint8_t expnonce[12] = {0};
+  expnonce[0] = x;
+  expnonce[1] = y;
+  aes256ctr_setnonce(state, expnonce);
+}
+
+void kyber_aes256xof_absorb(aes256ctr_ctx *state, const uint8_t seed[32], uint8_t x, uint8_t y)
+{
+  aes256ctr_setkey(state, seed);
+  kyber_aes256xof_setnonce(state, x, y);
+}
+#endif
+
 #if (AES_ACC == 1)
-void kyber_aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], uint8_t nonce)
-{ 
+void kyber_aes256ctr_prf_setkey(mbedtls_aes_context *ctx, const uint8_t key[32])
+{
+  mbedtls_aes_init(ctx);
+  mbedtls_aes_setkey_enc(ctx, key, 256);
+}
+
+/* CTR keystream = encryption of zeros; generated in place in out */
+void kyber_aes256ctr_prf_keyed(uint8_t *out, size_t outlen, mbedtls_aes_context *ctx, uint8_t nonce)
+{
   uint8_t expnonce[16] = {0};
+  uint8_t stream_block[16];
+  size_t nc_off = 0;
   expnonce[0] = nonce;
-  uint8_t stream_block[16] = {0};
+
+  memset(out, 0, outlen);
+  mbedtls_aes_crypt_ctr(ctx, outlen, &nc_off, expnonce, stream_block, out, out);
+}
+
+void kyber_aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], uint8_t nonce)
+{
   mbedtls_aes_context ctx;
-  uint8_t *in = alloca(outlen);
-  size_t nc_off = 0;
-  mbedtls_aes_init(&ctx);
-  mbedtls_aes_setkey_enc(&ctx, key, 256);
 
-  mbedtls_aes_crypt_ctr(&ctx, outlen, &nc_off, expnonce, stream_block, in, out);
+  kyber_aes256ctr_prf_setkey(&ctx, key);
+  kyber_aes256ctr_prf_keyed(out, outlen, &ctx, nonce);
   mbedtls_aes_free(&ctx);
 }
 #else
@@ -38,4 +77,54 @@ void kyber_aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], uin
   expnonce[0] = nonce;
   aes256ctr_prf(out, outlen, key, expnonce);
 }
+
+void kyber_aes256ctr_prf_setnonce(aes256ctr_ctx *state, uint8_t nonce)
+{
+  uint8_t expnonce[12] = {0};
+  expnonce[0] = nonce;
+  aes256ctr_setnonce(state, expnonce);
+}
 #endif //AES_ACC==1
+
+/* Two-fragment G and KDF: the KEM hashes its pieces in place */
+#if (KYBER_90S == 1)
+#if (SHA_ACC == 1)
+void kyber_hash_g2(uint8_t out[64], const uint8_t in0[KYBER_SYMBYTES], const uint8_t in1[KYBER_SYMBYTES])
+{
+  mbedtls_sha512_context ctx;
+
+  mbedtls_sha512_init(&ctx);
+  mbedtls_sha512_starts(&ctx, 0);
+  mbedtls_sha512_update(&ctx, in0, KYBER_SYMBYTES);
+  mbedtls_sha512_update(&ctx, in1, KYBER_SYMBYTES);
+  mbedtls_sha512_finish(&ctx, out);
+  mbedtls_sha512_free(&ctx);
+}
+
+void kyber_kdf2(uint8_t out[KYBER_SSBYTES], const uint8_t *in0, size_t inlen0, const uint8_t *in1, size_t inlen1)
+{
+  mbedtls_sha256_context ctx;
+
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, in0, inlen0);
+  mbedtls_sha256_update(&ctx, in1, inlen1);
+  mbedtls_sha256_finish(&ctx, out);
+  mbedtls_sha256_free(&ctx);
+}
+#else
+void kyber_hash_g2(uint8_t out[64], const uint8_t in0[KYBER_SYMBYTES], const uint8_t in1[KYBER_SYMBYTES])
+{
+  const sha2_iovec iov[2] = {{in0, KYBER_SYMBYTES}, {in1, KYBER_SYMBYTES}};
+
+  sha512_v(out, iov, 2);
+}
+
+void kyber_kdf2(uint8_t out[KYBER_SSBYTES], const uint8_t *in0, size_t inlen0, const uint8_t *in1, size_t inlen1)
+{
+  const sha2_iovec iov[2] = {{in0, inlen0}, {in1, inlen1}};
+
+  sha256_v(out, iov, 2);
+}
+#endif //SHA_ACC==1
+#endif //KYBER_90S==1
@@ -4,6 +4,7 @@
 #include "params.h"
 #include "symmetric.h"
 #include "fips202.h"
+#include "fips202x4.h"
 
 /*************************************************
 * Name:        kyber_shake128_absorb
@@ -49,3 +50,151 @@ void kyber_shake256_prf(uint8_t *out, size_t outlen, const uint8_t key[KYBER_SYM
 
   shake256(out, outlen, extkey, sizeof(extkey));
 }
+
+/*************************************************
+* Name:        kyber_shake256_prf_init
+*
+* Description: Absorb key || nonce into SHAKE256 for lane-wise squeezing;
+*              the output stream is that of kyber_shake256_prf
+*
+* Arguments:   - keccak_state *state: pointer to (uninitialized) output Keccak state
+*              - const uint8_t *key: pointer to the key (of length KYBER_SYMBYTES)
+*              - uint8_t nonce: single-byte nonce (public PRF input)
+**************************************************/
+void kyber_shake256_prf_init(keccak_state *state, const uint8_t key[KYBER_SYMBYTES], uint8_t nonce)
+{
+  uint8_t extkey[KYBER_SYMBYTES+1];
+
+  memcpy(extkey, key, KYBER_SYMBYTES);
+  extkey[KYBER_SYMBYTES] = nonce;
+
+  shake256_absorb_once(state, extkey, sizeof(extkey));
+}
+
+/*************************************************
+* Name:        kyber_shake128x4_absorb
+*
+* Description: Absorb step of four SHAKE128 instances specialized for the
+*              Kyber context; instance k absorbs seed || x[k] || y[k].
+*
+* Arguments:   - keccakx4_state *state: pointer to (uninitialized) output Keccak states
+*              - const uint8_t *seed: pointer to KYBER_SYMBYTES input to be absorbed into state
+*              - const uint8_t *x: first additional input byte of each instance
+*              - const uint8_t *y: second additional input byte of each instance
+**************************************************/
+void kyber_shake128x4_absorb(keccakx4_state *state,
+                             const uint8_t seed[KYBER_SYMBYTES],
+                             const uint8_t x[4],
+                             const uint8_t y[4])
+{
+  unsigned int k;
+  uint8_t extseed[4][KYBER_SYMBYTES+2];
+
+  for(k=0;k<4;k++) {
+    memcpy(extseed[k], seed, KYBER_SYMBYTES);
+    extseed[k][KYBER_SYMBYTES+0] = x[k];
+    extseed[k][KYBER_SYMBYTES+1] = y[k];
+  }
+
+  shake128x4_absorb_once(state, extseed[0], extseed[1], extseed[2], extseed[3], KYBER_SYMBYTES+2);
+}
+
+/*************************************************
+* Name:        kyber_shake256x4_prf
+*
+* Description: Four evaluations of the SHAKE256 PRF under the same key and
+*              different nonces; output k equals
+*              kyber_shake256_prf(out, outlen, key, nonce[k])
+*
+* Arguments:   - uint8_t *out0..out3: pointers to the four outputs
+*              - size_t outlen: number of requested output bytes per instance
+*              - const uint8_t *key: pointer to the key (of length KYBER_SYMBYTES)
+*              - const uint8_t *nonce: the four single-byte nonces
+**************************************************/
+void kyber_shake256x4_prf(uint8_t *out0,
+                          uint8_t *out1,
+                          uint8_t *out2,
+                          uint8_t *out3,
+                          size_t outlen,
+                          const uint8_t key[KYBER_SYMBYTES],
+                          const uint8_t nonce[4])
+{
+  unsigned int k;
+  uint8_t extkey[4][KYBER_SYMBYTES+1];
+
+  for(k=0;k<4;k++) {
+    memcpy(extkey[k], key, KYBER_SYMBYTES);
+    extkey[k][KYBER_SYMBYTES] = nonce[k];
+  }
+
+  shake256x4(out0, out1, out2, out3, outlen, extkey[0], extkey[1], extkey[2], extkey[3], KYBER_SYMBYTES+1);
+}
+
+/*************************************************
+* Name:        kyber_shake256x4_prf_init
+*
+* Description: Absorb key || nonce[k] into four SHAKE256 instances for
+*              lane-wise squeezing; see kyber_shake256x4_prf
+*
+* Arguments:   - keccakx4_state *state: pointer to (uninitialized) output Keccak states
+*              - const uint8_t *key: pointer to the key (of length KYBER_SYMBYTES)
+*              - const uint8_t *nonce: the four single-byte nonces
+**************************************************/
+void kyber_shake256x4_prf_init(keccakx4_state *state,
+                               const uint8_t key[KYBER_SYMBYTES],
+                               const uint8_t nonce[4])
+{
+  unsigned int k;
+  uint8_t extkey[4][KYBER_SYMBYTES+1];
+
+  for(k=0;k<4;k++) {
+    memcpy(extkey[k], key, KYBER_SYMBYTES);
+    extkey[k][KYBER_SYMBYTES] = nonce[k];
+  }
+
+  shake256x4_absorb_once(state, extkey[0], extkey[1], extkey[2], extkey[3], KYBER_SYMBYTES+1);
+}
+
+#ifndef KYBER_90S
+/*************************************************
+* Name:        kyber_hash_g2
+*
+* Description: SHA3-512 of in0 || in1. Both halves fit in the one
+*              SHA3-512 input block, so the copy here is the block load
+*              sha3_512_64 would do anyway.
+*
+* Arguments:   - uint8_t *out: pointer to output (64 bytes)
+*              - const uint8_t *in0: first KYBER_SYMBYTES of input
+*              - const uint8_t *in1: last KYBER_SYMBYTES of input
+**************************************************/
+void kyber_hash_g2(uint8_t out[64], const uint8_t in0[KYBER_SYMBYTES], const uint8_t in1[KYBER_SYMBYTES])
+{
+  uint8_t buf[2*KYBER_SYMBYTES];
+
+  memcpy(buf, in0, KYBER_SYMBYTES);
+  memcpy(buf+KYBER_SYMBYTES, in1, KYBER_SYMBYTES);
+  sha3_512_64(out, buf);
+}
+
+/*************************************************
+* Name:        kyber_kdf2
+*
+* Description: SHAKE256 KDF of in0 || in1, absorbed in place
+*
+* Arguments:   - uint8_t *out: pointer to output (KYBER_SSBYTES bytes)
+*              - const uint8_t *in0: pointer to first fragment
+*              - size_t inlen0: length of first fragment
+*              - const uint8_t *in1: pointer to second fragment
+*              - size_t inlen1: length of second fragment
+**************************************************/
+void kyber_kdf2(uint8_t out[KYBER_SSBYTES], const uint8_t *in0, size_t inlen0, const uint8_t *in1, size_t inlen1)
+{
+  keccak_state state;
+
+  shake256_init(&state);
+  shake256_absorb(&state, in0, inlen0);
+  shake256_absorb(&state, in1, inlen1);
+  shake256_finalize(&state);
+  shake256_squeeze(out, KYBER_SSBYTES, &state);
+}
+#endif
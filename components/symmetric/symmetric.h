@@ -13,33 +13,88 @@
 #if (KYBER_90S == 1)
 #include "aes256ctr.h"
 #include "sha2.h"
+#if (AES_ACC == 1)
+#include "mbedtls/aes.h"
+#endif
 
 #if (KYBER_SSBYTES != 32)
 #error "90s variant of Kyber can only generate keys of length 256 bits"
 #endif
 
+/* The XOF is only ever keyed with the public seed, so with
+ * AES_XOF_VARTIME=1 it may run on the faster table-based AES; the PRF
+ * below always uses the constant-time code. */
+#if (AES_XOF_VARTIME == 1)
+#include "aes256ctr_vt.h"
+typedef aes256ctr_vt_ctx xof_state;
+#else
 typedef aes256ctr_ctx xof_state;
+#endif
 
 #define kyber_aes256xof_absorb KYBER_NAMESPACE(kyber_aes256xof_absorb)
-void kyber_aes256xof_absorb(aes256ctr_ctx *state, const uint8_t seed[32], uint8_t x, uint8_t y);
+void kyber_aes256xof_absorb(xof_state *state, const uint8_t seed[32], uint8_t x, uint8_t y);
+
+#define kyber_aes256xof_setnonce KYBER_NAMESPACE(kyber_aes256xof_setnonce)
+void kyber_aes256xof_setnonce(xof_state *state, uint8_t x, uint8_t y);
 
 #define kyber_aes256ctr_prf KYBER_NAMESPACE(kyber_aes256ctr_prf)
 void kyber_aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], uint8_t nonce);
 
+/* Expanded-key PRF: the noise seed is expanded once into a prf_key,
+ * after which each noise polynomial only restarts the stream under its
+ * nonce (prf_key_setnonce + prf_squeezelane, or prf_keyed with AES_ACC) */
+#if (AES_ACC == 1)
+typedef mbedtls_aes_context prf_key;
+
+#define kyber_aes256ctr_prf_setkey KYBER_NAMESPACE(kyber_aes256ctr_prf_setkey)
+void kyber_aes256ctr_prf_setkey(mbedtls_aes_context *ctx, const uint8_t key[32]);
+
+#define kyber_aes256ctr_prf_keyed KYBER_NAMESPACE(kyber_aes256ctr_prf_keyed)
+void kyber_aes256ctr_prf_keyed(uint8_t *out, size_t outlen, mbedtls_aes_context *ctx, uint8_t nonce);
+#else
+typedef aes256ctr_ctx prf_key;
+
+#define kyber_aes256ctr_prf_setnonce KYBER_NAMESPACE(kyber_aes256ctr_prf_setnonce)
+void kyber_aes256ctr_prf_setnonce(aes256ctr_ctx *state, uint8_t nonce);
+#endif
+
 #define XOF_BLOCKBYTES AES256CTR_BLOCKBYTES
 
+/* Lane-wise output (next 8 bytes, little endian) for the samplers. The
+ * mbedtls AES driver only exposes a byte stream, so with AES_ACC=1 the
+ * noise sampler keeps using prf_keyed into a buffer. */
+#if (AES_ACC == 1)
+#define prf_key_init(KEY, SEED) kyber_aes256ctr_prf_setkey(KEY, SEED)
+#define prf_key_free(KEY) mbedtls_aes_free(KEY)
+#define prf_keyed(OUT, OUTBYTES, KEY, NONCE) kyber_aes256ctr_prf_keyed(OUT, OUTBYTES, KEY, NONCE)
+#else
+#define prf_key_init(KEY, SEED) aes256ctr_setkey(KEY, SEED)
+#define prf_key_free(KEY) ((void)(KEY))
+#define prf_key_setnonce(KEY, NONCE) kyber_aes256ctr_prf_setnonce(KEY, NONCE)
+#define prf_squeezelane(STATE) aes256ctr_squeezelane(STATE)
+#endif
+
+/* The matrix is sampled under one key (the public seed) and K*K nonces */
+#define xof_absorb(STATE, SEED, X, Y) kyber_aes256xof_absorb(STATE, SEED, X, Y)
+#define xof_setnonce(STATE, X, Y) kyber_aes256xof_setnonce(STATE, X, Y)
+#if (AES_XOF_VARTIME == 1)
+#define xof_setkey(STATE, SEED) aes256ctr_vt_setkey(STATE, SEED)
+#define xof_squeezeblocks(OUT, OUTBLOCKS, STATE) aes256ctr_vt_squeezeblocks(OUT, OUTBLOCKS, STATE)
+#define xof_squeezelane(STATE) aes256ctr_vt_squeezelane(STATE)
+#else
+#define xof_setkey(STATE, SEED) aes256ctr_setkey(STATE, SEED)
+#define xof_squeezeblocks(OUT, OUTBLOCKS, STATE) aes256ctr_squeezeblocks(OUT, OUTBLOCKS, STATE)
+#define xof_squeezelane(STATE) aes256ctr_squeezelane(STATE)
+#endif
+
 #if (SHA_ACC == 1)
 #define hash_h(OUT, IN, INBYTES) mbedtls_sha256(IN, INBYTES, OUT, 0);
 #define hash_g(OUT, IN, INBYTES) mbedtls_sha512(IN, INBYTES, OUT, 0);
-#define xof_absorb(STATE, SEED, X, Y) kyber_aes256xof_absorb(STATE, SEED, X, Y)
-#define xof_squeezeblocks(OUT, OUTBLOCKS, STATE) aes256ctr_squeezeblocks(OUT, OUTBLOCKS, STATE)
 #define prf(OUT, OUTBYTES, KEY, NONCE) kyber_aes256ctr_prf(OUT, OUTBYTES, KEY, NONCE)
 #define kdf(OUT, IN, INBYTES) mbedtls_sha256(IN, INBYTES, OUT, 0);
 #else
 #define hash_h(OUT, IN, INBYTES) sha256(OUT, IN, INBYTES)
 #define hash_g(OUT, IN, INBYTES) sha512(OUT, IN, INBYTES)
-#define xof_absorb(STATE, SEED, X, Y) kyber_aes256xof_absorb(STATE, SEED, X, Y)
-#define xof_squeezeblocks(OUT, OUTBLOCKS, STATE) aes256ctr_squeezeblocks(OUT, OUTBLOCKS, STATE)
 #define prf(OUT, OUTBYTES, KEY, NONCE) kyber_aes256ctr_prf(OUT, OUTBYTES, KEY, NONCE)
 #define kdf(OUT, IN, INBYTES) sha256(OUT, IN, INBYTES)
 #endif //(SHA_ACC == 1)
@@ -47,8 +102,12 @@ void kyber_aes256ctr_prf(uint8_t *out, size_t outlen, const uint8_t key[32], uin
 #else
 
 #include "fips202.h"
+#include "fips202x4.h"
 
 typedef keccak_state xof_state;
+typedef keccakx4_state xof4x_state;
+typedef keccak_state prf_state;
+typedef keccakx4_state prf4x_state;
 
 #define kyber_shake128_absorb KYBER_NAMESPACE(kyber_shake128_absorb)
 void kyber_shake128_absorb(keccak_state *s,
@@ -59,15 +118,70 @@ void kyber_shake128_absorb(keccak_state *s,
 #define kyber_shake256_prf KYBER_NAMESPACE(kyber_shake256_prf)
 void kyber_shake256_prf(uint8_t *out, size_t outlen, const uint8_t key[KYBER_SYMBYTES], uint8_t nonce);
 
+#define kyber_shake256_prf_init KYBER_NAMESPACE(kyber_shake256_prf_init)
+void kyber_shake256_prf_init(keccak_state *s, const uint8_t key[KYBER_SYMBYTES], uint8_t nonce);
+
+#define kyber_shake128x4_absorb KYBER_NAMESPACE(kyber_shake128x4_absorb)
+void kyber_shake128x4_absorb(keccakx4_state *s,
+                             const uint8_t seed[KYBER_SYMBYTES],
+                             const uint8_t x[4],
+                             const uint8_t y[4]);
+
+#define kyber_shake256x4_prf KYBER_NAMESPACE(kyber_shake256x4_prf)
+void kyber_shake256x4_prf(uint8_t *out0,
+                          uint8_t *out1,
+                          uint8_t *out2,
+                          uint8_t *out3,
+                          size_t outlen,
+                          const uint8_t key[KYBER_SYMBYTES],
+                          const uint8_t nonce[4]);
+
+#define kyber_shake256x4_prf_init KYBER_NAMESPACE(kyber_shake256x4_prf_init)
+void kyber_shake256x4_prf_init(keccakx4_state *s,
+                               const uint8_t key[KYBER_SYMBYTES],
+                               const uint8_t nonce[4]);
+
 #define XOF_BLOCKBYTES SHAKE128_RATE
 
-#define hash_h(OUT, IN, INBYTES) sha3_256(OUT, IN, INBYTES)
-#define hash_g(OUT, IN, INBYTES) sha3_512(OUT, IN, INBYTES)
+/* The KEM hashes fixed-size inputs; dispatch on the (constant) length */
+#define hash_h(OUT, IN, INBYTES) \
+        ((INBYTES) == KYBER_SYMBYTES ? sha3_256_32(OUT, IN) : \
+         sha3_256(OUT, IN, INBYTES))
+#define hash_g(OUT, IN, INBYTES) \
+        ((INBYTES) == 2*KYBER_SYMBYTES ? sha3_512_64(OUT, IN) : \
+         sha3_512(OUT, IN, INBYTES))
 #define xof_absorb(STATE, SEED, X, Y) kyber_shake128_absorb(STATE, SEED, X, Y)
 #define xof_squeezeblocks(OUT, OUTBLOCKS, STATE) shake128_squeezeblocks(OUT, OUTBLOCKS, STATE)
 #define prf(OUT, OUTBYTES, KEY, NONCE) kyber_shake256_prf(OUT, OUTBYTES, KEY, NONCE)
 #define kdf(OUT, IN, INBYTES) shake256(OUT, KYBER_SSBYTES, IN, INBYTES)
 
+/* Lane-wise output (next 8 bytes, little endian) for the samplers */
+#define xof_squeezelane(STATE) shake128_squeezelane(STATE)
+#define prf_init(STATE, KEY, NONCE) kyber_shake256_prf_init(STATE, KEY, NONCE)
+#define prf_squeezelane(STATE) shake256_squeezelane(STATE)
+
+/* Four independent XOF/PRF instances sharing each Keccak permutation */
+#define xof4x_absorb(STATE, SEED, X, Y) kyber_shake128x4_absorb(STATE, SEED, X, Y)
+#define xof4x_squeezeblocks(OUT0, OUT1, OUT2, OUT3, OUTBLOCKS, STATE) \
+        shake128x4_squeezeblocks(OUT0, OUT1, OUT2, OUT3, OUTBLOCKS, STATE)
+#define prf4x(OUT0, OUT1, OUT2, OUT3, OUTBYTES, KEY, NONCE) \
+        kyber_shake256x4_prf(OUT0, OUT1, OUT2, OUT3, OUTBYTES, KEY, NONCE)
+#define xof4x_squeezelane(LANES, STATE) shake128x4_squeezelane(LANES, STATE)
+#define prf4x_init(STATE, KEY, NONCE) kyber_shake256x4_prf_init(STATE, KEY, NONCE)
+#define prf4x_squeezelane(LANES, STATE) shake256x4_squeezelane(LANES, STATE)
+
 #endif /* KYBER_90S */
 
+/* G and KDF over two fragments, hashed in place instead of being copied
+ * into one buffer: hash_g2(OUT, IN0, IN1) = G(IN0 || IN1) for two
+ * KYBER_SYMBYTES inputs, kdf2(OUT, IN0, INBYTES0, IN1, INBYTES1) =
+ * KDF(IN0 || IN1) */
+#define kyber_hash_g2 KYBER_NAMESPACE(kyber_hash_g2)
+void kyber_hash_g2(uint8_t out[64], const uint8_t in0[KYBER_SYMBYTES], const uint8_t in1[KYBER_SYMBYTES]);
+#define kyber_kdf2 KYBER_NAMESPACE(kyber_kdf2)
+void kyber_kdf2(uint8_t out[KYBER_SSBYTES], const uint8_t *in0, size_t inlen0, const uint8_t *in1, size_t inlen1);
+
+#define hash_g2(OUT, IN0, IN1) kyber_hash_g2(OUT, IN0, IN1)
+#define kdf2(OUT, IN0, INBYTES0, IN1, INBYTES1) kyber_kdf2(OUT, IN0, INBYTES0, IN1, INBYTES1)
+
 #endif /* SYMMETRIC_H */
@@ -2,8 +2,11 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "fips202.h"
 #include "indcpa.h"
 #include "kem.h"
+#include "ntt.h"
+#include "poly.h"
 #include "taskpriorities.h"
 
 TaskFunction_t test_kyber_kem(void *pvParameters) {
@@ -17,7 +20,11 @@ TaskFunction_t test_kyber_kem(void *pvParameters) {
         uint8_t key_a[CRYPTO_BYTES];
         uint8_t key_b[CRYPTO_BYTES];
 
-        esp_cpu_cycle_count_t tmp[4];
+        uint64_t keccak[25] = {0};
+        int16_t r[256] = {0};
+        poly p = {{0}};
+
+        esp_cpu_cycle_count_t tmp[9];
 
         tmp[0] = esp_cpu_get_cycle_count();
         //Alice generates a public key
@@ -32,10 +39,38 @@ TaskFunction_t test_kyber_kem(void *pvParameters) {
         crypto_kem_dec(key_a, ct, sk);
         tmp[3] = esp_cpu_get_cycle_count();
 
+        //One Keccak-f1600 permutation; compare builds with and without KECCAK_INTERLEAVED
+        KeccakF1600_StatePermute(keccak);
+        tmp[4] = esp_cpu_get_cycle_count();
+
+        //Forward and inverse NTT; compare builds with and without NTT_PLANTARD
+        ntt(r);
+        tmp[5] = esp_cpu_get_cycle_count();
+        invntt(r);
+        tmp[6] = esp_cpu_get_cycle_count();
+
+        //Coefficient-wise arithmetic; compare builds with and without POLY_SWAR
+        poly_add(&p, &p, &p);
+        tmp[7] = esp_cpu_get_cycle_count();
+        poly_reduce(&p);
+        tmp[8] = esp_cpu_get_cycle_count();
+
         //printf("Clock cycle count \"Reference\": %u \n", tmp[0]);
         printf("Clock cycle count \"crypto_kem_keypair\": %lu \n", tmp[1]-tmp[0]);
         printf("Clock cycle count \"crypto_kem_enc\": %lu \n", tmp[2]-tmp[1]);
         printf("Clock cycle count \"crypto_kem_dec\": %lu \n", tmp[3]-tmp[2]);
+        printf("Clock cycle count \"KeccakF1600_StatePermute\": %lu \n", tmp[4]-tmp[3]);
+        printf("Clock cycle count \"ntt\": %lu \n", tmp[5]-tmp[4]);
+        printf("Clock cycle count \"invntt\": %lu \n", tmp[6]-tmp[5]);
+        printf("Clock cycle count \"poly_add\": %lu \n", tmp[7]-tmp[6]);
+        printf("Clock cycle count \"poly_reduce\": %lu \n", tmp[8]-tmp[7]);
+
+        //Least free stack of this task (MAIN_TASK_STACK_SIZE) and of the indcpa subtasks
+        printf("Stack high-water mark \"main task\": %lu \n", (unsigned long)uxTaskGetStackHighWaterMark(NULL));
+#if ((INDCPA_KEYPAIR_DUAL == 1) || (INDCPA_ENC_DUAL == 1) || (INDCPA_DEC_DUAL == 1)) && (INDCPA_STACK_WATERMARK == 1)
+        printf("Stack high-water mark \"indcpa subtasks\": %lu %lu \n",
+               (unsigned long)indcpa_stack_watermark[0], (unsigned long)indcpa_stack_watermark[1]);
+#endif
 
         //Wait 5 seconds
         // fflush(stdout);
@@ -57,7 +92,7 @@ void app_main(void)
     xReturned = xTaskCreatePinnedToCore(
                     test_kyber_kem,       /* Function that implements the task. */
                     "NAME",          /* Text name for the task. */
-                    20000,      /* Stack size in words, not bytes. */
+                    MAIN_TASK_STACK_SIZE, /* Stack size in words, not bytes. */
                     ( void * ) 1,    /* Parameter passed into the task. */
                     MAIN_TASK_PRIORITY, /* Priority at which the task is created. */
                     &xHandle, /* Used to pass out the created task's handle. */